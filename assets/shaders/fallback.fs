@@ -0,0 +1,8 @@
+#version 330 core
+
+out vec4 fragColor;
+
+// Flat grey while the real shader compiles.
+void main() {
+	fragColor = vec4(0.5f, 0.5f, 0.5f, 1.0f);
+}
@@ -0,0 +1,10 @@
+#version 330 core
+
+#include "include/frame.glsl"
+#include "include/draw.glsl"
+
+layout (location = 0) in vec3 aPos;
+
+void main() {
+	gl_Position = viewProj * model * vec4(aPos, 1.0f);
+}
@@ -0,0 +1,10 @@
+#ifndef DRAW_GLSL
+#define DRAW_GLSL
+
+// Mirrors DrawData in shader/uniform_buffer.hpp.
+layout (std140) uniform DrawData {
+	mat4 model;
+	vec4 color;
+};
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef FRAME_GLSL
+#define FRAME_GLSL
+
+// Mirrors FrameData in shader/uniform_buffer.hpp.
+struct Light {
+	vec4 position;
+	vec4 color;
+};
+
+layout (std140) uniform FrameData {
+	mat4  view;
+	mat4  projection;
+	mat4  viewProj;
+	vec4  cameraPosition;
+	vec4  time;
+	Light lights[4];
+	ivec4 lightCount;
+};
+
+#endif
@@ -0,0 +1,15 @@
+#version 330 core
+
+in vec4 tint;
+
+out vec4 fragColor;
+
+uniform sampler2D text2d;
+layout (std140) uniform MaterialData {
+	float alpha;
+};
+
+void main() {
+	
+	fragColor = vec4(texture(text2d, gl_FragCoord.xy/1000.0f).rgb, alpha) * tint;
+}
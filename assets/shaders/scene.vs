@@ -0,0 +1,25 @@
+#version 330 core
+
+#include "include/frame.glsl"
+
+layout (location = 0) in vec3 aPos;
+
+#ifdef INSTANCED
+layout (location = 3) in mat4 iModel;
+layout (location = 7) in vec4 iColor;
+layout (location = 8) in uint iMaterial;
+#else
+#include "include/draw.glsl"
+#endif
+
+out vec4 tint;
+
+void main() {
+#ifdef INSTANCED
+	tint		= iColor;
+	gl_Position = viewProj * iModel * vec4(aPos, 1.0f);
+#else
+	tint		= color;
+	gl_Position = viewProj * model * vec4(aPos, 1.0f);
+#endif
+}
@@ -0,0 +1,27 @@
+
+#ifndef _BENCH_HPP
+#define _BENCH_HPP
+
+#include <chrono>
+#include <cstdio>
+
+/*
+ * Benchmark helpers
+ * Shared by the programs built with `scons bench`. Numbers only mean
+ * something in a `release=1` build.
+ */
+
+// Average milliseconds of one call, over repeat calls after a warm up one.
+template <typename Func>
+double Milliseconds(int repeat, const Func& func) {
+
+	func();
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < repeat; i++) {
+		func();
+	}
+	auto stop = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::milli>(stop - start).count() / repeat;
+}
+
+#endif /* _BENCH_HPP */
@@ -0,0 +1,39 @@
+#include "bench.hpp"
+#include <model/bounds.hpp>
+#include <cmath>
+#include <random>
+#include <vector>
+
+static std::vector<glm::vec3> RandomPositions(size_t count, std::mt19937& random) {
+
+	std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+	std::vector<glm::vec3>				  positions(count);
+	for (glm::vec3& p : positions) {
+		p = glm::vec3(coordinate(random), coordinate(random), coordinate(random));
+	}
+	return positions;
+}
+
+// ComputeBounds against the plain glm reference, over tail sizes and a large mesh.
+int main() {
+
+	std::mt19937 random(1);
+
+	int mismatches = 0;
+	for (size_t count : { 1, 3, 4, 5, 7, 8, 9, 17, 1000003 }) {
+		std::vector<glm::vec3> positions = RandomPositions(count, random);
+		Bounds				   simd		 = ComputeBounds(positions.data(), count);
+		Bounds				   scalar	 = ComputeBoundsScalar(positions.data(), count);
+		if (simd.min != scalar.min || simd.max != scalar.max || std::abs(simd.radius - scalar.radius) > 1e-3f) {
+			printf("Mismatch at %zu positions\n", count);
+			mismatches++;
+		}
+	}
+
+	std::vector<glm::vec3> positions = RandomPositions(1 << 22, random);
+	volatile float		   sink		 = 0.0f;
+	double				   simd		 = Milliseconds(10, [&]() { sink = sink + ComputeBounds(positions.data(), positions.size()).radius; });
+	double				   scalar	 = Milliseconds(10, [&]() { sink = sink + ComputeBoundsScalar(positions.data(), positions.size()).radius; });
+	printf("ComputeBounds, %zu positions: simd %.2f ms, scalar %.2f ms, %.1fx\n", positions.size(), simd, scalar, scalar / simd);
+	return mismatches ? 1 : 0;
+}
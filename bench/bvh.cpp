@@ -0,0 +1,99 @@
+#include "bench.hpp"
+#include <jobs/job_system.hpp>
+#include <spatial/bvh.hpp>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// BVH build, refit and ray queries over a million small random triangles, with
+// closest hits and box queries checked against brute force. The build's thread
+// count is the first argument, all cores by default.
+int main(int argc, char** argv) {
+
+	JobSystem::Init(argc > 1 ? (uint32_t)atoi(argv[1]) : 0);
+
+	std::mt19937						  random(1);
+	std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f), offset(-1.0f, 1.0f);
+
+	const uint32_t		   TRIANGLES = 1000000;
+	std::vector<glm::vec3> vertices(TRIANGLES * 3);
+	std::vector<Bounds>	   bounds(TRIANGLES);
+	for (uint32_t i = 0; i < TRIANGLES; i++) {
+		glm::vec3  center(coordinate(random), coordinate(random), coordinate(random));
+		glm::vec3* triangle = &vertices[i * 3];
+		for (int k = 0; k < 3; k++) {
+			triangle[k] = center + glm::vec3(offset(random), offset(random), offset(random));
+		}
+		bounds[i].min = glm::min(triangle[0], glm::min(triangle[1], triangle[2]));
+		bounds[i].max = glm::max(triangle[0], glm::max(triangle[1], triangle[2]));
+	}
+	auto test = [&](uint32_t primitive, const glm::vec3& origin, const glm::vec3& dir, float) {
+		float t;
+		return IntersectTriangle(origin, dir, &vertices[primitive * 3], t) ? t : -1.0f;
+	};
+
+	BVH	   bvh;
+	double build = Milliseconds(3, [&]() { bvh.Build(bounds.data(), TRIANGLES); });
+	double refit = Milliseconds(10, [&]() { bvh.Refit(bounds.data()); });
+	printf("%u triangles on %u threads: build %.1f ms, refit %.1f ms, %u nodes, %u leaves\n",
+		   TRIANGLES, JobSystem::GetThreadCount(), build, refit, bvh.GetStats().nodes, bvh.GetStats().leaves);
+
+	const uint32_t		   RAYS = 200000;
+	std::vector<glm::vec3> origins(RAYS), dirs(RAYS);
+	for (uint32_t i = 0; i < RAYS; i++) {
+		origins[i] = glm::vec3(coordinate(random), coordinate(random), coordinate(random));
+		dirs[i]	   = glm::normalize(glm::vec3(offset(random), offset(random), offset(random)));
+	}
+
+	std::vector<float> hits(RAYS);
+	uint32_t		   occluded = 0;
+
+	double closest = Milliseconds(1, [&]() {
+		for (uint32_t i = 0; i < RAYS; i++) {
+			uint32_t primitive;
+			hits[i] = 1e30f;
+			bvh.Intersect(origins[i], dirs[i], hits[i], primitive, test);
+		}
+	});
+	double shadow = Milliseconds(1, [&]() {
+		occluded = 0;
+		for (uint32_t i = 0; i < RAYS; i++) {
+			occluded += bvh.Occluded(origins[i], dirs[i], 50.0f, test);
+		}
+	});
+	printf("%u rays: closest hit %.2f Mrays/s, occluded within 50 %.2f Mrays/s (%u)\n", RAYS, RAYS / closest / 1000.0, RAYS / shadow / 1000.0, occluded);
+
+	int mismatches = 0;
+	for (uint32_t i = 0; i < 200; i++) {
+		float best = 1e30f;
+		for (uint32_t p = 0; p < TRIANGLES; p++) {
+			float t = test(p, origins[i], dirs[i], best);
+			if (t >= 0.0f && t < best) {
+				best = t;
+			}
+		}
+		mismatches += best != hits[i];
+	}
+
+	Bounds query;
+	query.min = glm::vec3(-10.0f);
+	query.max = glm::vec3(10.0f);
+	// Whole leaves come back, so candidates only need to cover the overlapping boxes.
+	std::vector<uint32_t> candidates;
+	bvh.Query(query, candidates);
+	std::vector<bool> found(TRIANGLES, false);
+	for (uint32_t primitive : candidates) {
+		found[primitive] = true;
+	}
+	uint32_t overlapping = 0;
+	for (uint32_t p = 0; p < TRIANGLES; p++) {
+		if (glm::all(glm::lessThanEqual(bounds[p].min, query.max)) && glm::all(glm::greaterThanEqual(bounds[p].max, query.min))) {
+			mismatches += !found[p];
+			overlapping++;
+		}
+	}
+	printf("Brute force: %d mismatches over 200 rays and a box query, %zu candidates for %u boxes\n", mismatches, candidates.size(), overlapping);
+
+	JobSystem::Shutdown();
+	return mismatches ? 1 : 0;
+}
@@ -0,0 +1,48 @@
+
+#ifndef _BENCH_CONTEXT_HPP
+#define _BENCH_CONTEXT_HPP
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glstate/glstate.hpp>
+#include <stdexcept>
+
+/*
+ * Benchmark context
+ * Hidden window with the app's GL 3.3 core context, current on the
+ * calling thread, for the benchmarks that need a driver. They are run
+ * from the repository root so assets/ resolves.
+ */
+
+inline GLFWwindow* CreateContext(int width = 640, int height = 480) {
+
+	if (!glfwInit()) {
+		throw std::runtime_error("GLFW::INIT_ERR");
+	}
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	GLFWwindow* window = glfwCreateWindow(width, height, "Bench", nullptr, nullptr);
+	if (!window) {
+		throw std::runtime_error("GLFW::WINDOW_INIT_ERR");
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+		throw std::runtime_error("GLAD::FAILED_OPENGL_LOAD");
+	}
+	GLState::Invalidate();
+	GLState::Viewport(0, 0, width, height);
+	GLState::Enable(GL_DEPTH_TEST);
+	return window;
+}
+
+inline void DestroyContext(GLFWwindow* window) {
+
+	glfwDestroyWindow(window);
+	glfwTerminate();
+}
+
+#endif /* _BENCH_CONTEXT_HPP */
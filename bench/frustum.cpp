@@ -0,0 +1,58 @@
+#include "bench.hpp"
+#include <culling/frustum.hpp>
+#include <jobs/job_system.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// CullFrustum and FrustumCuller against Frustum::Intersects one box at a time.
+// The thread count for FrustumCuller is the first argument, all cores by default.
+int main(int argc, char** argv) {
+
+	JobSystem::Init(argc > 1 ? (uint32_t)atoi(argv[1]) : 0);
+
+	glm::mat4 viewProjection = glm::perspective(1.0f, 1.33f, 0.1f, 300.0f) * glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	Frustum	  frustum		 = Frustum::FromMatrix(viewProjection);
+
+	std::mt19937						  random(1);
+	std::uniform_real_distribution<float> coordinate(-500.0f, 500.0f);
+
+	int mismatches = 0;
+	for (uint32_t count : { 10000u, 100000u, 1000000u }) {
+		BoundsTable			table;
+		std::vector<Bounds> bounds;
+		for (uint32_t i = 0; i < count; i++) {
+			glm::vec3 center(coordinate(random), coordinate(random), coordinate(random));
+			bounds.push_back({ center - 1.0f, center + 1.0f, center, 1.74f });
+			table.Add(bounds.back());
+		}
+
+		std::vector<uint32_t> scalarVisible, simdVisible, culledVisible;
+		FrustumCuller		  culler;
+
+		double scalar = Milliseconds(20, [&]() {
+			scalarVisible.clear();
+			for (uint32_t i = 0; i < count; i++) {
+				if (frustum.Intersects(bounds[i])) {
+					scalarVisible.push_back(i);
+				}
+			}
+		});
+		double simd = Milliseconds(20, [&]() {
+			simdVisible.clear();
+			CullFrustum(table, frustum, 0, count, simdVisible);
+		});
+		double threaded = Milliseconds(20, [&]() { culler.Cull(table, frustum, culledVisible); });
+
+		if (simdVisible != scalarVisible || culledVisible != scalarVisible) {
+			printf("Mismatch at %u boxes\n", count);
+			mismatches++;
+		}
+		printf("%u boxes, %zu visible: scalar %.3f ms, CullFrustum %.3f ms, FrustumCuller on %u threads %.3f ms\n",
+			   count, scalarVisible.size(), scalar, simd, JobSystem::GetThreadCount(), threaded);
+	}
+
+	JobSystem::Shutdown();
+	return mismatches ? 1 : 0;
+}
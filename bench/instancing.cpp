@@ -0,0 +1,89 @@
+#include "bench.hpp"
+#include "context.hpp"
+#include <jobs/job_system.hpp>
+#include <material/material.hpp>
+#include <model/mesh.hpp>
+#include <render/render_queue.hpp>
+#include <shader/generated/shader_reflection.hpp>
+#include <shader/shader.hpp>
+#include <shader/uniform_buffer.hpp>
+#include <vector>
+
+static constexpr UniformId VIEW_PROJ("viewProj");
+
+// Feature bits of the scene shader.
+static const uint64_t SCENE_INSTANCED = 1 << 0;
+
+// 10k copies of the app's mesh and material through the render queue, with
+// instancing on and off. A frame is submit, sort and Execute, then glFinish so
+// the driver's share is counted too.
+static void Run() {
+
+	ShaderLoader loader;
+	MeshLoader	 meshes;
+	RenderQueue	 queue;
+	queue.SetFallback(loader.Load("fallback", "assets/shaders/fallback.vs", "assets/shaders/fallback.fs"));
+	loader.Register("scene", "assets/shaders/scene.vs", "assets/shaders/scene.fs", { "INSTANCED" });
+	Shader* shader	  = loader.GetVariant("scene", 0);
+	Shader* instanced = loader.GetVariant("scene", SCENE_INSTANCED);
+	loader.Finish();
+
+	Mesh*	 mesh = meshes.Load("tet");
+	Material material(shader);
+	material.SetInstancedShader(instanced);
+	material.Set(ShaderReflection::scene::alpha, 1.0f);
+
+	const int			   GRID = 100;
+	std::vector<glm::mat4> transforms;
+	std::vector<glm::vec3> centers;
+	for (int x = 0; x < GRID; x++) {
+		for (int z = 0; z < GRID; z++) {
+			transforms.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(x - GRID / 2, 0.0f, -z) * 2.0f));
+			centers.push_back(glm::vec3(transforms.back()[3]));
+		}
+	}
+
+	FrameData data		= {};
+	glm::vec3 eye		= glm::vec3(0.0f, 20.0f, 10.0f);
+	data.view			= glm::lookAt(eye, glm::vec3(0.0f, 0.0f, -GRID), glm::vec3(0.0f, 1.0f, 0.0f));
+	data.projection		= glm::perspective(glm::radians(60.0f), 640.0f / 480.0f, 0.1f, 500.0f);
+	data.viewProj		= data.projection * data.view;
+	data.cameraPosition = glm::vec4(eye, 1.0f);
+	UniformBuffer frameData;
+	frameData.Upload(&data, sizeof(data));
+	frameData.Bind(UniformBlocks::FRAME);
+
+	auto setup = [&](Shader* s) {
+		if (!s->UsesBlock(UniformBlocks::FRAME)) {
+			s->SetMatrix(VIEW_PROJ, data.viewProj);
+		}
+	};
+	auto frame = [&]() {
+		glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+		queue.Begin(eye, 500.0f);
+		for (uint32_t i = 0; i < transforms.size(); i++) {
+			queue.Submit(RenderQueue::PASS_OPAQUE, mesh, &material, &transforms[i], centers[i], i);
+		}
+		queue.Sort();
+		queue.Execute(setup);
+		glFinish();
+	};
+
+	for (bool instancing : { false, true }) {
+		queue.SetInstancing(instancing);
+		double					  ms	= Milliseconds(50, frame);
+		const RenderQueue::Stats& stats = queue.GetStats();
+		printf("%zu objects, instancing %s: %.2f ms per frame, %u draws, %u fallback\n",
+			   transforms.size(), instancing ? "on" : "off", ms, stats.draws, stats.fallbackDraws);
+	}
+}
+
+int main() {
+
+	JobSystem::Init();
+	GLFWwindow* window = CreateContext();
+	Run();
+	DestroyContext(window);
+	JobSystem::Shutdown();
+	return 0;
+}
@@ -0,0 +1,53 @@
+#include "bench.hpp"
+#include <jobs/job_system.hpp>
+#include <jobs/parallel.hpp>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+// Job system scaling, from one thread doubling up to the first argument, all
+// cores by default: empty jobs, a compute bound ParallelFor and tiny ParallelFor
+// calls for the per call overhead.
+int main(int argc, char** argv) {
+
+	uint32_t maxThreads = argc > 1 ? (uint32_t)atoi(argv[1]) : std::thread::hardware_concurrency();
+	maxThreads			= maxThreads ? maxThreads : 1;
+
+	std::vector<uint32_t> counts;
+	for (uint32_t threads = 1; threads < maxThreads; threads *= 2) {
+		counts.push_back(threads);
+	}
+	counts.push_back(maxThreads);
+
+	std::vector<float> data(1 << 22, 1.5f);
+	for (uint32_t threads : counts) {
+		JobSystem::Init(threads);
+
+		const int JOBS = 200000;
+
+		double empty = Milliseconds(1, [&]() {
+			JobCounter counter;
+			for (int i = 0; i < JOBS; i++) {
+				JobSystem::Run([] {}, &counter);
+			}
+			JobSystem::Wait(counter);
+		});
+		double compute = Milliseconds(5, [&]() {
+			ParallelFor((uint32_t)data.size(), 4096, [&](uint32_t begin, uint32_t end, uint32_t) {
+				for (uint32_t i = begin; i < end; i++) {
+					data[i] = std::sqrt(data[i] * data[i] + 1.0f);
+				}
+			});
+		});
+		double calls = Milliseconds(20000, [&]() {
+			ParallelFor(threads * 16, 1, [](uint32_t, uint32_t, uint32_t) {});
+		});
+
+		printf("%u threads: empty job %.0f ns, %zu sqrt ParallelFor %.2f ms, empty ParallelFor %.3f us\n",
+			   threads, empty * 1e6 / JOBS, data.size(), compute, calls * 1e3);
+	}
+
+	JobSystem::Shutdown();
+	return 0;
+}
@@ -0,0 +1,134 @@
+#include "bench.hpp"
+#include "context.hpp"
+#include <material/material.hpp>
+#include <shader/shader.hpp>
+#include <cstring>
+#include <map>
+#include <string>
+
+// The material before the flat blob: values in a map by name, each one
+// looked up in the shader's uniforms by string on every Attach.
+class MapMaterial {
+	struct Value {
+		uint32_t type;
+		float	 data[16];
+	};
+
+	Shader*						 m_Shader;
+	std::map<std::string, Value> m_Uniforms;
+
+public:
+	template <typename T>
+	void Set(const std::string& name, uint32_t type, const T& value) {
+		Value& v = m_Uniforms[name];
+		v.type	 = type;
+		memcpy(v.data, &value, sizeof(T));
+	}
+
+	void Attach() {
+
+		m_Shader->Use();
+		for (const auto& p : m_Uniforms) {
+			GLint location = -1;
+			for (const ShaderUniforms& uniform : m_Shader->GetUniforms()) {
+				if (uniform.name == p.first) {
+					location = uniform.location;
+					break;
+				}
+			}
+			const Value& v = p.second;
+			switch (v.type) {
+				case GL_BOOL:
+				case GL_INT: glUniform1iv(location, 1, (const GLint*)v.data); break;
+				case GL_FLOAT: glUniform1fv(location, 1, v.data); break;
+				case GL_FLOAT_VEC2: glUniform2fv(location, 1, v.data); break;
+				case GL_FLOAT_VEC3: glUniform3fv(location, 1, v.data); break;
+				case GL_FLOAT_VEC4: glUniform4fv(location, 1, v.data); break;
+				case GL_FLOAT_MAT3: glUniformMatrix3fv(location, 1, GL_FALSE, v.data); break;
+				case GL_FLOAT_MAT4: glUniformMatrix4fv(location, 1, GL_FALSE, v.data); break;
+			}
+		}
+	}
+
+	MapMaterial(Shader* shader) :
+			m_Shader(shader) {
+	}
+};
+
+// Same values on both, set by name, the way materials are filled in at load.
+template <typename M>
+static void Fill(M& material, float seed) {
+
+	material.SetMatrix("model", glm::mat4(seed));
+	material.SetMatrix("viewProj", glm::mat4(1.0f));
+	material.SetMatrix("uvTransform", glm::mat3(1.0f));
+	material.SetVector("tint", glm::vec4(seed));
+	material.SetVector("emissive", glm::vec3(seed));
+	material.SetVector("tiling", glm::vec2(2.0f));
+	material.SetFloat("roughness", 0.5f);
+	material.SetFloat("metallic", seed);
+	material.SetInt("mode", 1);
+	material.SetBool("useEmissive", true);
+}
+
+// Adapts MapMaterial to Fill.
+struct MapFiller {
+	MapMaterial& material;
+
+	void SetMatrix(const char* name, const glm::mat4& value) { material.Set(name, GL_FLOAT_MAT4, value); }
+	void SetMatrix(const char* name, const glm::mat3& value) { material.Set(name, GL_FLOAT_MAT3, value); }
+	void SetVector(const char* name, const glm::vec4& value) { material.Set(name, GL_FLOAT_VEC4, value); }
+	void SetVector(const char* name, const glm::vec3& value) { material.Set(name, GL_FLOAT_VEC3, value); }
+	void SetVector(const char* name, const glm::vec2& value) { material.Set(name, GL_FLOAT_VEC2, value); }
+	void SetFloat(const char* name, float value) { material.Set(name, GL_FLOAT, value); }
+	void SetInt(const char* name, int value) { material.Set(name, GL_INT, value); }
+	void SetBool(const char* name, bool value) { material.Set(name, GL_BOOL, (int)value); }
+};
+
+// Material::Attach against the old map material, on a shader with ten loose
+// uniforms. Two materials alternate on the shader so every Attach uploads
+// everything; a material reattached to a shader it still owns uploads nothing.
+static void Run() {
+
+	ShaderLoader loader;
+	Shader*		 shader = loader.Load("material", "bench/shaders/material.vs", "bench/shaders/material.fs");
+
+	Material blobA(shader), blobB(shader);
+	Fill(blobA, 1.0f);
+	Fill(blobB, 2.0f);
+
+	MapMaterial mapA(shader), mapB(shader);
+	MapFiller	fillA{ mapA }, fillB{ mapB };
+	Fill(fillA, 1.0f);
+	Fill(fillB, 2.0f);
+
+	const int CALLS = 200000;
+
+	double map = Milliseconds(1, [&]() {
+		for (int i = 0; i < CALLS; i++) {
+			(i & 1 ? mapB : mapA).Attach();
+		}
+	});
+	double blob = Milliseconds(1, [&]() {
+		for (int i = 0; i < CALLS; i++) {
+			(i & 1 ? blobB : blobA).Attach();
+		}
+	});
+	double clean = Milliseconds(1, [&]() {
+		for (int i = 0; i < CALLS; i++) {
+			blobA.Attach();
+		}
+	});
+	glFinish();
+
+	printf("%zu uniforms, ns per Attach: map %.0f, flat blob %.0f, flat blob reattached %.0f\n",
+		   shader->GetUniforms().size(), map * 1e6 / CALLS, blob * 1e6 / CALLS, clean * 1e6 / CALLS);
+}
+
+int main() {
+
+	GLFWwindow* window = CreateContext();
+	Run();
+	DestroyContext(window);
+	return 0;
+}
@@ -0,0 +1,21 @@
+#version 330 core
+
+// Loose uniforms only, so every Attach goes through glUniform.
+uniform vec4  tint;
+uniform vec3  emissive;
+uniform vec2  tiling;
+uniform float roughness;
+uniform float metallic;
+uniform int	  mode;
+uniform bool  useEmissive;
+
+in vec2	 uv;
+out vec4 fragColor;
+
+void main() {
+	vec3 color = tint.rgb * (1.0f - metallic) * roughness * fract(uv * tiling).x;
+	if (useEmissive && mode > 0) {
+		color += emissive;
+	}
+	fragColor = vec4(color, tint.a);
+}
@@ -0,0 +1,14 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+uniform mat4 viewProj;
+uniform mat3 uvTransform;
+
+out vec2 uv;
+
+void main() {
+	uv			= (uvTransform * vec3(aPos.xy, 1.0f)).xy;
+	gl_Position = viewProj * model * vec4(aPos, 1.0f);
+}
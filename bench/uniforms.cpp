@@ -0,0 +1,66 @@
+#include "bench.hpp"
+#include "context.hpp"
+#include <shader/shader.hpp>
+#include <string>
+#include <vector>
+
+// The lookup before UniformId: a string compare against each active uniform.
+static const ShaderUniforms* FindLinear(const std::vector<ShaderUniforms>& uniforms, const std::string& name) {
+
+	for (const ShaderUniforms& uniform : uniforms) {
+		if (uniform.name == name) {
+			return &uniform;
+		}
+	}
+	return nullptr;
+}
+
+// Uniform lookup in the app's shaders: the old linear scan, the string overloads
+// and precomputed UniformIds, over every active uniform and one missing name.
+static void Run() {
+
+	ShaderLoader loader;
+
+	const int CALLS = 1000000;
+	for (const char* name : { "bbox", "fallback", "scene" }) {
+		Shader* shader = loader.Load(name, std::string("assets/shaders/") + name + ".vs", std::string("assets/shaders/") + name + ".fs");
+
+		std::vector<std::string> names;
+		for (const ShaderUniforms& uniform : shader->GetUniforms()) {
+			names.push_back(uniform.name);
+		}
+		names.push_back("missing");
+		std::vector<UniformId> ids;
+		for (const std::string& n : names) {
+			ids.push_back(UniformId(n));
+		}
+
+		volatile size_t found = 0;
+
+		double linear = Milliseconds(1, [&]() {
+			for (int i = 0; i < CALLS; i++) {
+				found = found + (FindLinear(shader->GetUniforms(), names[i % names.size()]) != nullptr);
+			}
+		});
+		double byString = Milliseconds(1, [&]() {
+			for (int i = 0; i < CALLS; i++) {
+				found = found + shader->HasUniform(names[i % names.size()]);
+			}
+		});
+		double byId = Milliseconds(1, [&]() {
+			for (int i = 0; i < CALLS; i++) {
+				found = found + (shader->FindUniform(ids[i % ids.size()]) != nullptr);
+			}
+		});
+		printf("%s, %zu uniforms: linear %.1f ns, string %.1f ns, UniformId %.1f ns per lookup\n",
+			   name, names.size() - 1, linear * 1e6 / CALLS, byString * 1e6 / CALLS, byId * 1e6 / CALLS);
+	}
+}
+
+int main() {
+
+	GLFWwindow* window = CreateContext();
+	Run();
+	DestroyContext(window);
+	return 0;
+}
@@ -0,0 +1,61 @@
+#include "camera.hpp"
+
+#include <cmath>
+
+void Camera::SetPosition(const glm::vec3& position) {
+	m_Position = position;
+	m_Dirty	= true;
+}
+
+void Camera::SetRotation(float yaw, float pitch) {
+	m_Yaw   = yaw;
+	m_Pitch = glm::clamp(pitch, -glm::radians(89.0f), glm::radians(89.0f));
+	m_Dirty = true;
+}
+
+void Camera::SetPerspective(float fov, float aspect, float zNear, float zFar) {
+	m_FOV	= fov;
+	m_Aspect = aspect;
+	m_Near   = zNear;
+	m_Far	= zFar;
+	m_Dirty  = true;
+}
+
+void Camera::LookAt(const glm::vec3& target) {
+	glm::vec3 dir = glm::normalize(target - m_Position);
+	SetRotation(std::atan2(dir.x, -dir.z), std::asin(dir.y));
+}
+
+glm::vec3 Camera::GetForward() const {
+	return glm::vec3(
+			std::cos(m_Pitch) * std::sin(m_Yaw),
+			std::sin(m_Pitch),
+			-std::cos(m_Pitch) * std::cos(m_Yaw));
+}
+
+void Camera::UpdateMatrices() const {
+
+	if (!m_Dirty) {
+		return;
+	}
+
+	m_View			 = glm::lookAt(m_Position, m_Position + GetForward(), glm::vec3(0.0f, 1.0f, 0.0f));
+	m_Projection	 = glm::perspective(m_FOV, m_Aspect, m_Near, m_Far);
+	m_ViewProjection = m_Projection * m_View;
+	m_Dirty			 = false;
+}
+
+const glm::mat4& Camera::GetView() const {
+	UpdateMatrices();
+	return m_View;
+}
+
+const glm::mat4& Camera::GetProjection() const {
+	UpdateMatrices();
+	return m_Projection;
+}
+
+const glm::mat4& Camera::GetViewProjection() const {
+	UpdateMatrices();
+	return m_ViewProjection;
+}
@@ -0,0 +1,46 @@
+
+#ifndef _CAMERA_HPP
+#define _CAMERA_HPP
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+/*
+ * Camera class
+ * Perspective camera described by a position and yaw/pitch angles.
+ * Matrices are rebuilt lazily whenever a parameter changes.
+ */
+
+class Camera {
+	glm::vec3 m_Position = glm::vec3(0.0f);
+	float	 m_Yaw		 = 0.0f; // Radians, 0 looks down -Z
+	float	 m_Pitch	 = 0.0f;
+	float	 m_FOV		 = glm::radians(60.0f);
+	float	 m_Aspect	= 4.0f / 3.0f;
+	float	 m_Near		 = 0.1f;
+	float	 m_Far		 = 1000.0f;
+
+	mutable bool	  m_Dirty = true;
+	mutable glm::mat4 m_View;
+	mutable glm::mat4 m_Projection;
+	mutable glm::mat4 m_ViewProjection;
+
+	void UpdateMatrices() const;
+
+public:
+	void SetPosition(const glm::vec3& position);
+	void SetRotation(float yaw, float pitch);
+	void SetPerspective(float fov, float aspect, float zNear, float zFar);
+	void LookAt(const glm::vec3& target);
+
+	const glm::vec3& GetPosition() const { return m_Position; }
+	glm::vec3		 GetForward() const;
+	float			 GetNear() const { return m_Near; }
+	float			 GetFar() const { return m_Far; }
+
+	const glm::mat4& GetView() const;
+	const glm::mat4& GetProjection() const;
+	const glm::mat4& GetViewProjection() const;
+};
+
+#endif /* _CAMERA_HPP */
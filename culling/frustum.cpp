@@ -0,0 +1,181 @@
+#include "frustum.hpp"
+#include <jobs/parallel.hpp>
+
+#include <algorithm>
+#include <chrono>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+Frustum Frustum::FromMatrix(const glm::mat4& m) {
+
+	glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+	glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+	glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+	glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+	Frustum frustum;
+	frustum.planes[0] = row3 + row0;
+	frustum.planes[1] = row3 - row0;
+	frustum.planes[2] = row3 + row1;
+	frustum.planes[3] = row3 - row1;
+	frustum.planes[4] = row3 + row2;
+	frustum.planes[5] = row3 - row2;
+
+	for (glm::vec4& plane : frustum.planes) {
+		plane /= glm::length(glm::vec3(plane));
+	}
+	return frustum;
+}
+
+bool Frustum::Intersects(const Bounds& bounds) const {
+
+	for (const glm::vec4& plane : planes) {
+		// Corner furthest along the plane normal.
+		glm::vec3 p(
+				plane.x > 0.0f ? bounds.max.x : bounds.min.x,
+				plane.y > 0.0f ? bounds.max.y : bounds.min.y,
+				plane.z > 0.0f ? bounds.max.z : bounds.min.z);
+		if (glm::dot(glm::vec3(plane), p) + plane.w < 0.0f) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void CullFrustum(const BoundsTable& table, const Frustum& frustum, uint32_t begin, uint32_t end, std::vector<uint32_t>& visible) {
+
+	// The furthest corner only depends on the plane, so pick the
+	// min or max array per plane once instead of per box.
+	const float* px[6];
+	const float* py[6];
+	const float* pz[6];
+	for (int p = 0; p < 6; p++) {
+		const glm::vec4& plane = frustum.planes[p];
+		px[p]				   = plane.x > 0.0f ? table.MaxX() : table.MinX();
+		py[p]				   = plane.y > 0.0f ? table.MaxY() : table.MinY();
+		pz[p]				   = plane.z > 0.0f ? table.MaxZ() : table.MinZ();
+	}
+
+	uint32_t i = begin;
+
+#if defined(__AVX__)
+	__m256 nx[6], ny[6], nz[6], nw[6];
+	for (int p = 0; p < 6; p++) {
+		nx[p] = _mm256_set1_ps(frustum.planes[p].x);
+		ny[p] = _mm256_set1_ps(frustum.planes[p].y);
+		nz[p] = _mm256_set1_ps(frustum.planes[p].z);
+		nw[p] = _mm256_set1_ps(frustum.planes[p].w);
+	}
+
+	// Tables are padded to a multiple of 8, padding boxes never pass.
+	for (; i + 8 <= end || (i < end && i + 8 <= table.GetPaddedCount()); i += 8) {
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; p++) {
+			__m256 d = _mm256_add_ps(_mm256_mul_ps(nx[p], _mm256_loadu_ps(px[p] + i)), nw[p]);
+			d		 = _mm256_add_ps(_mm256_mul_ps(ny[p], _mm256_loadu_ps(py[p] + i)), d);
+			d		 = _mm256_add_ps(_mm256_mul_ps(nz[p], _mm256_loadu_ps(pz[p] + i)), d);
+			inside   = _mm256_and_ps(inside, _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+
+		uint32_t mask = (uint32_t)_mm256_movemask_ps(inside);
+		if (end - i < 8) {
+			mask &= (1u << (end - i)) - 1;
+		}
+		while (mask) {
+			visible.push_back(i + __builtin_ctz(mask));
+			mask &= mask - 1;
+		}
+	}
+#elif defined(__SSE2__)
+	__m128 nx[6], ny[6], nz[6], nw[6];
+	for (int p = 0; p < 6; p++) {
+		nx[p] = _mm_set1_ps(frustum.planes[p].x);
+		ny[p] = _mm_set1_ps(frustum.planes[p].y);
+		nz[p] = _mm_set1_ps(frustum.planes[p].z);
+		nw[p] = _mm_set1_ps(frustum.planes[p].w);
+	}
+
+	for (; i + 4 <= end || (i < end && i + 4 <= table.GetPaddedCount()); i += 4) {
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; p++) {
+			__m128 d = _mm_add_ps(_mm_mul_ps(nx[p], _mm_loadu_ps(px[p] + i)), nw[p]);
+			d		 = _mm_add_ps(_mm_mul_ps(ny[p], _mm_loadu_ps(py[p] + i)), d);
+			d		 = _mm_add_ps(_mm_mul_ps(nz[p], _mm_loadu_ps(pz[p] + i)), d);
+			inside   = _mm_and_ps(inside, _mm_cmpge_ps(d, _mm_setzero_ps()));
+		}
+
+		uint32_t mask = (uint32_t)_mm_movemask_ps(inside);
+		if (end - i < 4) {
+			mask &= (1u << (end - i)) - 1;
+		}
+		while (mask) {
+			visible.push_back(i + __builtin_ctz(mask));
+			mask &= mask - 1;
+		}
+	}
+#endif
+
+	for (; i < end; i++) {
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; p++) {
+			const glm::vec4& plane = frustum.planes[p];
+			inside				   = plane.x * px[p][i] + plane.y * py[p][i] + plane.z * pz[p][i] + plane.w >= 0.0f;
+		}
+		if (inside) {
+			visible.push_back(i);
+		}
+	}
+}
+
+void FrustumCuller::Cull(const BoundsTable& table, const Frustum& frustum, std::vector<uint32_t>& visible) {
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// Ranges are split on SIMD width so only the last one has a tail.
+	const uint32_t count  = table.GetCount();
+	const uint32_t blocks = (count + BoundsTable::WIDTH - 1) / BoundsTable::WIDTH;
+	const uint32_t batch  = MIN_PER_WORKER / BoundsTable::WIDTH;
+	const uint32_t ranges = GetRangeCount(blocks, batch);
+
+	visible.clear();
+	if (ranges == 1) {
+		CullFrustum(table, frustum, 0, count, visible);
+	} else {
+		m_Partials.resize(ranges);
+		ParallelFor(blocks, batch, [&](uint32_t begin, uint32_t end, uint32_t range) {
+			std::vector<uint32_t>& partial = m_Partials[range];
+			partial.clear();
+			CullFrustum(table, frustum, begin * BoundsTable::WIDTH, std::min(end * BoundsTable::WIDTH, count), partial);
+		});
+
+		for (uint32_t r = 0; r < ranges; r++) {
+			visible.insert(visible.end(), m_Partials[r].begin(), m_Partials[r].end());
+		}
+	}
+
+	auto stop = std::chrono::high_resolution_clock::now();
+
+	m_Stats.tested		 = count;
+	m_Stats.visible		 = (uint32_t)visible.size();
+	m_Stats.milliseconds = std::chrono::duration<float, std::milli>(stop - start).count();
+}
+
+void FrustumCuller::Cull(const BoundsTable& table, const Frustum& frustum, const std::vector<uint32_t>& candidates, std::vector<uint32_t>& visible) {
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	visible.clear();
+	for (uint32_t index : candidates) {
+		if (frustum.Intersects(table.Get(index))) {
+			visible.push_back(index);
+		}
+	}
+
+	auto stop = std::chrono::high_resolution_clock::now();
+
+	m_Stats.tested		 = (uint32_t)candidates.size();
+	m_Stats.visible		 = (uint32_t)visible.size();
+	m_Stats.milliseconds = std::chrono::duration<float, std::milli>(stop - start).count();
+}
@@ -0,0 +1,58 @@
+
+#ifndef _FRUSTUM_HPP
+#define _FRUSTUM_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <model/bounds.hpp>
+
+/*
+ * Frustum struct
+ * Six normalized planes (left, right, bottom, top, near, far) pointing
+ * inwards, so a point p is inside when dot(plane.xyz, p) + plane.w >= 0.
+ */
+
+struct Frustum {
+	glm::vec4 planes[6];
+
+	// Gribb/Hartmann extraction from a view projection matrix.
+	static Frustum FromMatrix(const glm::mat4& viewProjection);
+
+	bool Intersects(const Bounds& bounds) const;
+};
+
+// Tests boxes [begin, end) of the table, appending the visible indices in order.
+void CullFrustum(const BoundsTable& table, const Frustum& frustum, uint32_t begin, uint32_t end, std::vector<uint32_t>& visible);
+
+/*
+ * Frustum Culler class
+ * Culls a bounds table against a frustum, splitting large tables
+ * across the worker threads and merging into a compact index list.
+ */
+
+class FrustumCuller {
+public:
+	struct Stats {
+		uint32_t tested;
+		uint32_t visible;
+		float	milliseconds;
+	};
+
+	// Tables smaller than this per worker are culled on the calling thread.
+	static const uint32_t MIN_PER_WORKER = 4096;
+
+private:
+	std::vector<std::vector<uint32_t>> m_Partials;
+	Stats							   m_Stats = {};
+
+public:
+	void Cull(const BoundsTable& table, const Frustum& frustum, std::vector<uint32_t>& visible);
+	// Tests only the candidates, for sets already narrowed down (e.g. by a PVS).
+	void Cull(const BoundsTable& table, const Frustum& frustum, const std::vector<uint32_t>& candidates, std::vector<uint32_t>& visible);
+
+	const Stats& GetStats() const { return m_Stats; }
+};
+
+#endif /* _FRUSTUM_HPP */
@@ -0,0 +1,300 @@
+#include "occlusion.hpp"
+#include <jobs/parallel.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Triangles per setup range before it is worth splitting across workers.
+static const uint32_t MIN_TRIANGLES_PER_WORKER = 256;
+
+OcclusionCuller::OcclusionCuller() {
+
+	int w = WIDTH;
+	int h = HEIGHT;
+	while (true) {
+		m_LevelSizes.push_back(glm::ivec2(w, h));
+		m_Levels.push_back(std::vector<float>((size_t)w * h, 1.0f));
+		if (w == 1 && h == 1) {
+			break;
+		}
+		w = std::max(1, (w + 1) / 2);
+		h = std::max(1, (h + 1) / 2);
+	}
+}
+
+void OcclusionCuller::AddOccluder(const glm::vec3* positions, const uint32_t* indices, uint32_t indexCount, const glm::mat4& model) {
+
+	for (uint32_t i = 0; i < indexCount; i++) {
+		m_Occluders.push_back(glm::vec3(model * glm::vec4(positions[indices[i]], 1.0f)));
+	}
+}
+
+void OcclusionCuller::ClearOccluders() {
+	m_Occluders.clear();
+}
+
+void OcclusionCuller::SetupTriangles(const glm::mat4& viewProjection, uint32_t begin, uint32_t end, uint32_t range) {
+
+	std::vector<ScreenTriangle>& triangles = m_Triangles[range];
+	triangles.clear();
+	for (int t = 0; t < TILES_X * TILES_Y; t++) {
+		m_Bins[range * TILES_X * TILES_Y + t].clear();
+	}
+
+	for (uint32_t tri = begin; tri < end; tri++) {
+
+		glm::vec3 v[3];
+		bool	  clipped = false;
+		for (int i = 0; i < 3; i++) {
+			glm::vec4 clip = viewProjection * glm::vec4(m_Occluders[tri * 3 + i], 1.0f);
+			// Triangles crossing the near plane are dropped rather than clipped. The GPU
+			// would cut that part off, here it would become the nearest depth and hide
+			// what is visible. Dropping only removes occlusion, the test stays conservative.
+			if (clip.z < -clip.w || clip.w <= 0.0f) {
+				clipped = true;
+				break;
+			}
+			float invW = 1.0f / clip.w;
+			v[i]	   = glm::vec3(
+					  (clip.x * invW * 0.5f + 0.5f) * WIDTH,
+					  (clip.y * invW * 0.5f + 0.5f) * HEIGHT,
+					  clip.z * invW);
+		}
+		if (clipped) {
+			continue;
+		}
+
+		// Both windings occlude, make them all counter clockwise.
+		float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+		if (std::abs(area) < 1e-6f) {
+			continue;
+		}
+		if (area < 0.0f) {
+			std::swap(v[1], v[2]);
+			area = -area;
+		}
+
+		ScreenTriangle st;
+		st.minX = std::max(0, (int)std::floor(std::min(v[0].x, std::min(v[1].x, v[2].x))));
+		st.minY = std::max(0, (int)std::floor(std::min(v[0].y, std::min(v[1].y, v[2].y))));
+		st.maxX = std::min(WIDTH - 1, (int)std::ceil(std::max(v[0].x, std::max(v[1].x, v[2].x))));
+		st.maxY = std::min(HEIGHT - 1, (int)std::ceil(std::max(v[0].y, std::max(v[1].y, v[2].y))));
+		if (st.minX > st.maxX || st.minY > st.maxY) {
+			continue;
+		}
+
+		for (int e = 0; e < 3; e++) {
+			const glm::vec3& a = v[e];
+			const glm::vec3& b = v[(e + 1) % 3];
+			st.edgeA[e]		   = a.y - b.y;
+			st.edgeB[e]		   = b.x - a.x;
+			st.edgeC[e]		   = -st.edgeA[e] * a.x - st.edgeB[e] * a.y;
+		}
+
+		st.dzdx = ((v[1].z - v[0].z) * (v[2].y - v[0].y) - (v[2].z - v[0].z) * (v[1].y - v[0].y)) / area;
+		st.dzdy = ((v[2].z - v[0].z) * (v[1].x - v[0].x) - (v[1].z - v[0].z) * (v[2].x - v[0].x)) / area;
+		st.z0	= v[0].z - st.dzdx * v[0].x - st.dzdy * v[0].y;
+
+		// Bin into every tile the screen bounds touch.
+		uint32_t index = (uint32_t)triangles.size();
+		triangles.push_back(st);
+		for (int ty = st.minY / TILE_HEIGHT; ty <= st.maxY / TILE_HEIGHT; ty++) {
+			for (int tx = st.minX / TILE_WIDTH; tx <= st.maxX / TILE_WIDTH; tx++) {
+				m_Bins[range * TILES_X * TILES_Y + ty * TILES_X + tx].push_back(index);
+			}
+		}
+	}
+}
+
+void OcclusionCuller::RasterizeTile(int tile) {
+
+	const int tileX0 = (tile % TILES_X) * TILE_WIDTH;
+	const int tileY0 = (tile / TILES_X) * TILE_HEIGHT;
+	float*	depth  = m_Levels[0].data();
+
+	for (int y = tileY0; y < tileY0 + TILE_HEIGHT; y++) {
+		std::fill(depth + y * WIDTH + tileX0, depth + y * WIDTH + tileX0 + TILE_WIDTH, 1.0f);
+	}
+
+	for (size_t range = 0; range < m_Triangles.size(); range++) {
+		for (uint32_t index : m_Bins[range * TILES_X * TILES_Y + tile]) {
+			const ScreenTriangle& st = m_Triangles[range][index];
+
+			// Clip the triangle bounds to the tile, x aligned to SIMD width.
+			const int x0 = std::max(st.minX, tileX0) & ~3;
+			const int x1 = std::min(st.maxX, tileX0 + TILE_WIDTH - 1);
+			const int y0 = std::max(st.minY, tileY0);
+			const int y1 = std::min(st.maxY, tileY0 + TILE_HEIGHT - 1);
+
+			for (int y = y0; y <= y1; y++) {
+				const float py  = y + 0.5f;
+				float*		row = depth + y * WIDTH;
+				int			x   = x0;
+
+#if defined(__SSE2__)
+				const __m128 step = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+				const __m128 a0   = _mm_set1_ps(st.edgeA[0]);
+				const __m128 a1   = _mm_set1_ps(st.edgeA[1]);
+				const __m128 a2   = _mm_set1_ps(st.edgeA[2]);
+				const __m128 r0   = _mm_set1_ps(st.edgeB[0] * py + st.edgeC[0]);
+				const __m128 r1   = _mm_set1_ps(st.edgeB[1] * py + st.edgeC[1]);
+				const __m128 r2   = _mm_set1_ps(st.edgeB[2] * py + st.edgeC[2]);
+				const __m128 dzdx = _mm_set1_ps(st.dzdx);
+				const __m128 rz   = _mm_set1_ps(st.z0 + st.dzdy * py);
+				const __m128 zero = _mm_setzero_ps();
+
+				for (; x <= x1; x += 4) {
+					__m128 px	= _mm_add_ps(_mm_set1_ps((float)x), step);
+					__m128 e0	= _mm_add_ps(_mm_mul_ps(a0, px), r0);
+					__m128 e1	= _mm_add_ps(_mm_mul_ps(a1, px), r1);
+					__m128 e2	= _mm_add_ps(_mm_mul_ps(a2, px), r2);
+					__m128 inside = _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_and_ps(_mm_cmpge_ps(e1, zero), _mm_cmpge_ps(e2, zero)));
+					if (!_mm_movemask_ps(inside)) {
+						continue;
+					}
+
+					__m128 z	   = _mm_add_ps(_mm_mul_ps(dzdx, px), rz);
+					__m128 old	 = _mm_load_ps(row + x);
+					__m128 nearest = _mm_min_ps(old, z);
+					_mm_store_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, old)));
+				}
+#endif
+
+				for (; x <= x1; x++) {
+					const float px = x + 0.5f;
+					if (st.edgeA[0] * px + st.edgeB[0] * py + st.edgeC[0] >= 0.0f &&
+							st.edgeA[1] * px + st.edgeB[1] * py + st.edgeC[1] >= 0.0f &&
+							st.edgeA[2] * px + st.edgeB[2] * py + st.edgeC[2] >= 0.0f) {
+						row[x] = std::min(row[x], st.z0 + st.dzdx * px + st.dzdy * py);
+					}
+				}
+			}
+		}
+	}
+}
+
+void OcclusionCuller::BuildHiZ() {
+
+	for (size_t level = 1; level < m_Levels.size(); level++) {
+		const std::vector<float>& src  = m_Levels[level - 1];
+		std::vector<float>&		  dst  = m_Levels[level];
+		const glm::ivec2&		  srcS = m_LevelSizes[level - 1];
+		const glm::ivec2&		  dstS = m_LevelSizes[level];
+
+		for (int y = 0; y < dstS.y; y++) {
+			const int sy0 = 2 * y;
+			const int sy1 = std::min(2 * y + 1, srcS.y - 1);
+			for (int x = 0; x < dstS.x; x++) {
+				const int sx0 = 2 * x;
+				const int sx1 = std::min(2 * x + 1, srcS.x - 1);
+				dst[y * dstS.x + x] = std::max(
+						std::max(src[sy0 * srcS.x + sx0], src[sy0 * srcS.x + sx1]),
+						std::max(src[sy1 * srcS.x + sx0], src[sy1 * srcS.x + sx1]));
+			}
+		}
+	}
+}
+
+void OcclusionCuller::Render(const glm::mat4& viewProjection) {
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	const uint32_t triangleCount = (uint32_t)(m_Occluders.size() / 3);
+	const uint32_t ranges		 = GetRangeCount(triangleCount, MIN_TRIANGLES_PER_WORKER);
+
+	m_Triangles.resize(ranges);
+	m_Bins.resize(ranges * TILES_X * TILES_Y);
+
+	ParallelFor(triangleCount, MIN_TRIANGLES_PER_WORKER, [&](uint32_t begin, uint32_t end, uint32_t range) {
+		SetupTriangles(viewProjection, begin, end, range);
+	});
+	ParallelFor(TILES_X * TILES_Y, 1, [&](uint32_t begin, uint32_t end, uint32_t) {
+		for (uint32_t tile = begin; tile < end; tile++) {
+			RasterizeTile(tile);
+		}
+	});
+	BuildHiZ();
+
+	auto stop = std::chrono::high_resolution_clock::now();
+
+	m_Stats.occluderTriangles = 0;
+	for (uint32_t r = 0; r < ranges; r++) {
+		m_Stats.occluderTriangles += (uint32_t)m_Triangles[r].size();
+	}
+	m_Stats.rasterMilliseconds = std::chrono::duration<float, std::milli>(stop - start).count();
+}
+
+bool OcclusionCuller::IsVisible(const Bounds& bounds, const glm::mat4& viewProjection) const {
+
+	glm::vec2 lo(1e30f);
+	glm::vec2 hi(-1e30f);
+	float	 minZ = 1.0f;
+
+	for (int c = 0; c < 8; c++) {
+		glm::vec4 corner(
+				c & 1 ? bounds.max.x : bounds.min.x,
+				c & 2 ? bounds.max.y : bounds.min.y,
+				c & 4 ? bounds.max.z : bounds.min.z,
+				1.0f);
+		glm::vec4 clip = viewProjection * corner;
+		if (clip.z < -clip.w || clip.w <= 0.0f) {
+			return true; // Crosses the near plane
+		}
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		lo			  = glm::min(lo, glm::vec2(ndc));
+		hi			  = glm::max(hi, glm::vec2(ndc));
+		minZ		  = std::min(minZ, ndc.z);
+	}
+
+	int x0 = std::max(0, (int)std::floor((lo.x * 0.5f + 0.5f) * WIDTH));
+	int y0 = std::max(0, (int)std::floor((lo.y * 0.5f + 0.5f) * HEIGHT));
+	int x1 = std::min(WIDTH - 1, (int)std::floor((hi.x * 0.5f + 0.5f) * WIDTH));
+	int y1 = std::min(HEIGHT - 1, (int)std::floor((hi.y * 0.5f + 0.5f) * HEIGHT));
+	if (x0 > x1 || y0 > y1) {
+		return true; // Off screen is left to the frustum culler
+	}
+
+	// Pick the level where the rectangle spans at most about two texels.
+	int size  = std::max(x1 - x0, y1 - y0) + 1;
+	int level = 0;
+	while (size > 2 && level + 1 < (int)m_Levels.size()) {
+		size = (size + 1) / 2;
+		level++;
+	}
+
+	const std::vector<float>& depth = m_Levels[level];
+	const glm::ivec2&		  dim   = m_LevelSizes[level];
+	float					  maxZ  = -1.0f;
+	for (int y = y0 >> level; y <= std::min(y1 >> level, dim.y - 1); y++) {
+		for (int x = x0 >> level; x <= std::min(x1 >> level, dim.x - 1); x++) {
+			maxZ = std::max(maxZ, depth[y * dim.x + x]);
+		}
+	}
+
+	return minZ <= maxZ;
+}
+
+void OcclusionCuller::Cull(const BoundsTable& table, const glm::mat4& viewProjection, std::vector<uint32_t>& visible) {
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	size_t kept = 0;
+	for (uint32_t index : visible) {
+		if (IsVisible(table.Get(index), viewProjection)) {
+			visible[kept++] = index;
+		}
+	}
+
+	m_Stats.tested   = (uint32_t)visible.size();
+	m_Stats.rejected = (uint32_t)(visible.size() - kept);
+	visible.resize(kept);
+
+	auto stop = std::chrono::high_resolution_clock::now();
+
+	m_Stats.testMilliseconds = std::chrono::duration<float, std::milli>(stop - start).count();
+}
@@ -0,0 +1,80 @@
+
+#ifndef _OCCLUSION_HPP
+#define _OCCLUSION_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <model/bounds.hpp>
+
+/*
+ * Occlusion Culler class
+ * Software rasterizes a small set of occluder triangles into a low
+ * resolution depth buffer and tests bounds against a hierarchical-Z
+ * pyramid built from it, before any draw is submitted.
+ * Triangles are set up and binned into screen tiles in parallel, then each
+ * tile is rasterized by a single worker, so no locking is needed.
+ * Depth is NDC z in [-1, 1], nearest occluder per pixel, Hi-Z levels keep
+ * the farthest depth of the texels below them.
+ */
+
+class OcclusionCuller {
+public:
+	static const int WIDTH		 = 256;
+	static const int HEIGHT		 = 192;
+	static const int TILE_WIDTH  = 64;
+	static const int TILE_HEIGHT = 32;
+	static const int TILES_X	 = WIDTH / TILE_WIDTH;
+	static const int TILES_Y	 = HEIGHT / TILE_HEIGHT;
+
+	struct Stats {
+		uint32_t occluderTriangles; // Triangles that reached the rasterizer
+		uint32_t tested;
+		uint32_t rejected;
+		float	rasterMilliseconds;
+		float	testMilliseconds;
+	};
+
+private:
+	struct ScreenTriangle {
+		float edgeA[3], edgeB[3], edgeC[3]; // Edge functions A * x + B * y + C
+		float z0, dzdx, dzdy;				 // Depth plane at pixel (0, 0)
+		int   minX, minY, maxX, maxY;
+	};
+
+	std::vector<glm::vec3> m_Occluders; // World space triangle soup
+
+	std::vector<std::vector<ScreenTriangle>> m_Triangles; // Per setup range
+	std::vector<std::vector<uint32_t>>		 m_Bins;	  // [range * tiles + tile]
+
+	std::vector<std::vector<float>> m_Levels; // Level 0 is the depth buffer
+	std::vector<glm::ivec2>			m_LevelSizes;
+
+	Stats m_Stats = {};
+
+	void SetupTriangles(const glm::mat4& viewProjection, uint32_t begin, uint32_t end, uint32_t range);
+	void RasterizeTile(int tile);
+	void BuildHiZ();
+
+public:
+	// Adds triangles of a mesh, transformed to world space, as occluders.
+	void AddOccluder(const glm::vec3* positions, const uint32_t* indices, uint32_t indexCount, const glm::mat4& model);
+	void ClearOccluders();
+
+	// Rasterizes the occluders for this view and rebuilds the pyramid.
+	void Render(const glm::mat4& viewProjection);
+
+	// Conservative test, true unless the bounds are certainly hidden.
+	bool IsVisible(const Bounds& bounds, const glm::mat4& viewProjection) const;
+
+	// Removes occluded indices from a visible list, keeping order.
+	void Cull(const BoundsTable& table, const glm::mat4& viewProjection, std::vector<uint32_t>& visible);
+
+	const Stats&			  GetStats() const { return m_Stats; }
+	const std::vector<float>& GetDepthBuffer() const { return m_Levels[0]; }
+
+	OcclusionCuller();
+};
+
+#endif /* _OCCLUSION_HPP */
@@ -0,0 +1,159 @@
+#include "occlusion_query.hpp"
+#include <glstate/glstate.hpp>
+#include <shader/shader.hpp>
+
+static constexpr UniformId VIEW_PROJ("viewProj");
+static constexpr UniformId BOX_MIN("boxMin");
+static constexpr UniformId BOX_MAX("boxMax");
+
+// Boxes are queried grown by this much of their size plus a little, so a
+// visible object's own faces, drawn just before, do not hide its box.
+static const float BOX_GROWTH  = 0.01f;
+static const float BOX_EPSILON = 0.001f;
+
+MeshData OcclusionQueries::UnitCube() {
+
+	MeshData data;
+	for (int c = 0; c < 8; c++) {
+		data.positions.push_back(glm::vec3(c & 1, (c >> 1) & 1, (c >> 2) & 1));
+	}
+	data.indices = {
+		0, 2, 1, 1, 2, 3, // -z
+		4, 5, 6, 5, 7, 6, // +z
+		0, 1, 4, 1, 5, 4, // -y
+		2, 6, 3, 3, 6, 7, // +y
+		0, 4, 2, 2, 4, 6, // -x
+		1, 3, 5, 3, 7, 5  // +x
+	};
+	return data;
+}
+
+void OcclusionQueries::Init(Shader* boxShader, Mesh* unitCube) {
+	m_BoxShader = boxShader;
+	m_UnitCube  = unitCube;
+}
+
+void OcclusionQueries::Issue(ObjectState& state) {
+
+	if (!state.query) {
+		glGenQueries(1, &state.query);
+	}
+	state.pending	 = true;
+	state.issuedFrame = m_Frame;
+	m_Stats.issued++;
+}
+
+bool OcclusionQueries::ContainsEye(const BoundsTable& table, uint32_t object) const {
+
+	Bounds bounds = table.Get(object);
+	return glm::all(glm::greaterThanEqual(m_Eye, bounds.min - m_Margin)) && glm::all(glm::lessThanEqual(m_Eye, bounds.max + m_Margin));
+}
+
+void OcclusionQueries::ReadResults(const BoundsTable& table, const std::vector<uint32_t>& candidates) {
+
+	uint32_t latency = 0;
+	for (uint32_t object : candidates) {
+		ObjectState& state = m_Objects[object];
+		if (!state.pending) {
+			continue;
+		}
+
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(state.query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) {
+			continue;
+		}
+
+		GLuint passed;
+		glGetQueryObjectuiv(state.query, GL_QUERY_RESULT, &passed);
+		state.visible = passed != GL_FALSE || ContainsEye(table, object);
+		state.pending = false;
+		if (!state.visible) {
+			m_Stats.culled++;
+		}
+
+		latency += m_Frame - state.issuedFrame;
+		m_Stats.resultsRead++;
+	}
+	m_Stats.averageLatency = m_Stats.resultsRead ? (float)latency / m_Stats.resultsRead : 0.0f;
+}
+
+void OcclusionQueries::Begin(const BoundsTable& table, const std::vector<uint32_t>& candidates, const glm::vec3& eye, float nearPlane) {
+
+	m_Frame++;
+	m_Eye = eye;
+	// The near plane's corners sit further out than nearPlane, up to
+	// about sqrt(3) times at a 90 degree field of view.
+	m_Margin		   = nearPlane * 2.0f;
+	m_Stats			   = {};
+	m_Stats.candidates = (uint32_t)candidates.size();
+	m_Candidates	   = candidates;
+
+	if (m_Objects.size() < table.GetCount()) {
+		m_Objects.resize(table.GetCount(), { 0, 0, false, true });
+	}
+
+	ReadResults(table, candidates);
+
+	// A hidden object the eye moved into has a stale result, don't trust it.
+	m_Previous.clear();
+	m_Hidden.clear();
+	for (uint32_t object : candidates) {
+		ObjectState& state = m_Objects[object];
+		if (!state.visible && ContainsEye(table, object)) {
+			state.visible = true;
+		}
+		(state.visible ? m_Previous : m_Hidden).push_back(object);
+	}
+	m_Stats.drawn = (uint32_t)m_Previous.size();
+}
+
+void OcclusionQueries::Render(const BoundsTable& table, const glm::mat4& viewProjection, const BindFunc& bind, const DrawFunc& draw) {
+
+	// Every box against the depth so far, the visible set's own surfaces included.
+	GLState::ColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	GLState::DepthMask(GL_FALSE);
+
+	m_BoxShader->Use();
+	m_BoxShader->SetMatrix(VIEW_PROJ, viewProjection);
+	for (uint32_t object : m_Candidates) {
+		ObjectState& state = m_Objects[object];
+		if (state.pending) {
+			continue;
+		}
+		Bounds	  bounds = table.Get(object);
+		glm::vec3 grow	 = (bounds.max - bounds.min) * BOX_GROWTH + BOX_EPSILON;
+		m_BoxShader->SetVector(BOX_MIN, bounds.min - grow);
+		m_BoxShader->SetVector(BOX_MAX, bounds.max + grow);
+
+		Issue(state);
+		glBeginQuery(GL_ANY_SAMPLES_PASSED, state.query);
+		m_UnitCube->Draw(true);
+		glEndQuery(GL_ANY_SAMPLES_PASSED);
+	}
+
+	GLState::ColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	GLState::DepthMask(GL_TRUE);
+
+	if (m_Hidden.empty()) {
+		return;
+	}
+
+	// Newly disoccluded objects draw in this frame, the GPU decides.
+	bind();
+	for (uint32_t object : m_Hidden) {
+		glBeginConditionalRender(m_Objects[object].query, GL_QUERY_NO_WAIT);
+		draw(object);
+		glEndConditionalRender();
+	}
+	m_Stats.conditional = (uint32_t)m_Hidden.size();
+}
+
+OcclusionQueries::~OcclusionQueries() {
+
+	for (ObjectState& state : m_Objects) {
+		if (state.query) {
+			glDeleteQueries(1, &state.query);
+		}
+	}
+}
@@ -0,0 +1,96 @@
+
+#ifndef _OCCLUSION_QUERY_HPP
+#define _OCCLUSION_QUERY_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <memory/function_ref.hpp>
+#include <model/bounds.hpp>
+#include <model/mesh.hpp>
+
+class Shader;
+
+/*
+ * Occlusion Queries class
+ * GPU side occlusion culling with GL_ANY_SAMPLES_PASSED queries.
+ * Results are only read once available, so the CPU never waits on them;
+ * last frame's results decide what is drawn in this one.
+ * Begin reads them and splits the candidates. The caller then draws the
+ * objects visible last frame the usual way, batched and instanced, and
+ * Render queries every candidate's bounding box against that depth.
+ * Boxes are grown a little so an object's own surface does not hide its
+ * box. Objects hidden last frame are drawn under conditional rendering on
+ * their query, so disoccluded objects appear in the same frame without a
+ * readback.
+ * With the eye inside a box (grown by the near plane), the box and often
+ * the object itself are clipped or back face culled, so a query on it
+ * reads 0. Such objects are always drawn and never queried as hidden.
+ */
+
+class OcclusionQueries {
+public:
+	// Only called during Render, so they refer to the callables rather than copy them.
+	using BindFunc = FunctionRef<void()>;
+	using DrawFunc = FunctionRef<void(uint32_t object)>;
+
+	struct Stats {
+		uint32_t candidates;  // Objects handed in this frame
+		uint32_t drawn;		  // Drawn unconditionally, visible last frame
+		uint32_t conditional; // Drawn under conditional rendering
+		uint32_t culled;	  // Results read this frame that were occluded
+		uint32_t issued;
+		uint32_t resultsRead;
+		float	averageLatency; // Frames between issue and availability
+	};
+
+private:
+	struct ObjectState {
+		GLuint   query;
+		uint32_t issuedFrame;
+		bool	 pending;
+		bool	 visible;
+	};
+
+	Shader* m_BoxShader = nullptr;
+	Mesh*   m_UnitCube  = nullptr;
+
+	std::vector<ObjectState> m_Objects;
+	std::vector<uint32_t>	m_Previous; // Visible last frame
+	std::vector<uint32_t>	m_Hidden;   // Hidden last frame
+	std::vector<uint32_t>	m_Candidates;
+	uint32_t				 m_Frame = 0;
+	Stats					 m_Stats = {};
+
+	glm::vec3 m_Eye;
+	float	  m_Margin = 0.0f;
+
+	bool ContainsEye(const BoundsTable& table, uint32_t object) const;
+	void ReadResults(const BoundsTable& table, const std::vector<uint32_t>& candidates);
+	void Issue(ObjectState& state);
+
+public:
+	// Geometry for the unit cube the bounding boxes are drawn with.
+	static MeshData UnitCube();
+
+	void Init(Shader* boxShader, Mesh* unitCube);
+
+	// Reads the results that are in and splits candidates by them. eye and nearPlane
+	// are the camera's, for the inside box test.
+	void Begin(const BoundsTable& table, const std::vector<uint32_t>& candidates, const glm::vec3& eye, float nearPlane);
+
+	// Whether the caller draws the object before Render, as it was visible last frame.
+	bool WasVisible(uint32_t object) const { return m_Objects[object].visible; }
+
+	// Queries the candidates' boxes against the depth drawn since Begin, then draws the
+	// hidden ones under conditional rendering. bind sets up the object shader again.
+	void Render(const BoundsTable& table, const glm::mat4& viewProjection, const BindFunc& bind, const DrawFunc& draw);
+
+	const Stats& GetStats() const { return m_Stats; }
+
+	~OcclusionQueries();
+};
+
+#endif /* _OCCLUSION_QUERY_HPP */
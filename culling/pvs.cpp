@@ -0,0 +1,315 @@
+#include "pvs.hpp"
+#include <jobs/parallel.hpp>
+#include <spatial/bvh.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+
+static const uint32_t PVS_MAGIC   = 0x53565056; // "VPVS"
+static const uint32_t PVS_VERSION = 2;
+
+// Keeps segments from hitting the surfaces they start or end on.
+static const float SEGMENT_EPSILON = 1e-4f;
+
+// Zero bytes are stored as a zero followed by the run length.
+static void Compress(const std::vector<uint8_t>& bits, std::vector<uint8_t>& out) {
+
+	for (size_t i = 0; i < bits.size(); i++) {
+		out.push_back(bits[i]);
+		if (bits[i]) {
+			continue;
+		}
+		uint8_t run = 1;
+		while (i + 1 < bits.size() && !bits[i + 1] && run < 255) {
+			run++;
+			i++;
+		}
+		out.push_back(run);
+	}
+}
+
+uint64_t PVS::HashScene(const BoundsTable& objects) {
+
+	// FNV-1a over the object bounds.
+	uint64_t hash = 14695981039346656037ull;
+	for (uint32_t i = 0; i < objects.GetCount(); i++) {
+		Bounds		   b		= objects.Get(i);
+		const uint8_t* bytes	= reinterpret_cast<const uint8_t*>(&b);
+		const size_t   boxBytes = sizeof(glm::vec3) * 2;
+		for (size_t k = 0; k < boxBytes; k++) {
+			hash ^= bytes[k];
+			hash *= 1099511628211ull;
+		}
+	}
+	return hash ^ objects.GetCount();
+}
+
+int32_t PVS::GetCell(const glm::vec3& position) const {
+
+	glm::ivec3 c = glm::ivec3(glm::floor((position - m_Origin) / m_CellSize));
+	if (glm::any(glm::lessThan(c, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(c, m_Dims))) {
+		return -1;
+	}
+	return (c.z * m_Dims.y + c.y) * m_Dims.x + c.x;
+}
+
+void PVS::BakeCell(uint32_t cell, const BoundsTable& objects, const Occluders& occluders, const BVH& tree, const BakeParams& params, std::vector<uint8_t>& bits, uint64_t& rays) const {
+
+	glm::ivec3 c(cell % m_Dims.x, (cell / m_Dims.x) % m_Dims.y, cell / (m_Dims.x * m_Dims.y));
+	glm::vec3  cellMin = m_Origin + glm::vec3(c) * m_CellSize;
+	glm::vec3  cellMax = cellMin + glm::vec3(m_CellSize);
+
+	// Center first, the likeliest to see through, then the grid.
+	const uint32_t n	   = std::max(2u, params.samplesPerAxis);
+	auto		   samples = [&](const glm::vec3& lo, const glm::vec3& hi, std::vector<glm::vec3>& points) {
+		  points.clear();
+		  points.push_back((lo + hi) * 0.5f);
+		  for (uint32_t z = 0; z < n; z++) {
+			  for (uint32_t y = 0; y < n; y++) {
+				  for (uint32_t x = 0; x < n; x++) {
+					  points.push_back(lo + (hi - lo) * glm::vec3(x, y, z) / float(n - 1));
+				  }
+			  }
+		  }
+	};
+
+	std::vector<glm::vec3> froms;
+	std::vector<glm::vec3> tos;
+	samples(cellMin, cellMax, froms);
+
+	for (uint32_t object = 0; object < m_ObjectCount; object++) {
+		Bounds box = objects.Get(object);
+		samples(box.min, box.max, tos);
+
+		bool visible = glm::all(glm::lessThanEqual(box.min, cellMax)) && glm::all(glm::greaterThanEqual(box.max, cellMin));
+		for (uint32_t r = 0; r < froms.size() * tos.size() && !visible; r++) {
+			glm::vec3 from = froms[r / tos.size()];
+			glm::vec3 to   = tos[r % tos.size()];
+			glm::vec3 dir  = to - from;
+			rays++;
+
+			visible = !tree.Occluded(from, dir, 1.0f - SEGMENT_EPSILON, [&](uint32_t t, const glm::vec3& o, const glm::vec3& d, float) {
+				float hit;
+				if (occluders.owners[t] == object || !IntersectTriangle(o, d, &occluders.triangles[t * 3], hit)) {
+					return -1.0f;
+				}
+				return hit > SEGMENT_EPSILON ? hit : -1.0f;
+			});
+		}
+
+		if (visible) {
+			bits[object >> 3] |= 1 << (object & 7);
+		}
+	}
+}
+
+void PVS::Bake(const BoundsTable& objects, const Occluders& occluders, const BakeParams& params) {
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	m_ObjectCount = objects.GetCount();
+	m_SceneHash   = HashScene(objects);
+	m_CellSize	= params.cellSize;
+
+	glm::vec3 lo(1e30f);
+	glm::vec3 hi(-1e30f);
+	for (uint32_t i = 0; i < m_ObjectCount; i++) {
+		Bounds b = objects.Get(i);
+		lo		 = glm::min(lo, b.min);
+		hi		 = glm::max(hi, b.max);
+	}
+	if (!m_ObjectCount) {
+		lo = hi = glm::vec3(0.0f);
+	}
+
+	m_Origin = lo;
+	m_Dims   = glm::max(glm::ivec3(glm::ceil((hi - lo) / m_CellSize)), glm::ivec3(1));
+
+	const uint32_t cellCount = m_Dims.x * m_Dims.y * m_Dims.z;
+	const size_t   setBytes  = (m_ObjectCount + 7) / 8;
+
+	// Segments are traced against a BVH over the occluder triangles.
+	const uint32_t		triangleCount = (uint32_t)occluders.owners.size();
+	std::vector<Bounds> triangleBounds(triangleCount);
+	for (uint32_t t = 0; t < triangleCount; t++) {
+		const glm::vec3* v = &occluders.triangles[t * 3];
+		triangleBounds[t].min = glm::min(v[0], glm::min(v[1], v[2]));
+		triangleBounds[t].max = glm::max(v[0], glm::max(v[1], v[2]));
+	}
+	BVH tree;
+	tree.Build(triangleBounds.data(), triangleCount);
+
+	std::vector<std::vector<uint8_t>> cells(cellCount, std::vector<uint8_t>(setBytes, 0));
+	std::vector<uint64_t>			  rays(GetRangeCount(cellCount, 1), 0);
+
+	ParallelFor(cellCount, 1, [&](uint32_t begin, uint32_t end, uint32_t range) {
+		for (uint32_t cell = begin; cell < end; cell++) {
+			BakeCell(cell, objects, occluders, tree, params, cells[cell], rays[range]);
+		}
+	});
+
+	m_Offsets.clear();
+	m_Data.clear();
+	for (uint32_t cell = 0; cell < cellCount; cell++) {
+		m_Offsets.push_back((uint32_t)m_Data.size());
+		Compress(cells[cell], m_Data);
+	}
+	m_Offsets.push_back((uint32_t)m_Data.size());
+	m_CachedCell = -1;
+
+	auto stop = std::chrono::high_resolution_clock::now();
+
+	m_Stats.bakeMilliseconds = std::chrono::duration<float, std::milli>(stop - start).count();
+	m_Stats.raysCast		 = 0;
+	for (uint64_t r : rays) {
+		m_Stats.raysCast += r;
+	}
+	m_Stats.cells			= cellCount;
+	m_Stats.rawBytes		= setBytes * cellCount;
+	m_Stats.compressedBytes = m_Data.size();
+}
+
+const std::vector<uint32_t>* PVS::Lookup(const glm::vec3& position) {
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	int32_t cell = IsBaked() ? GetCell(position) : -1;
+	if (cell < 0) {
+		return nullptr;
+	}
+
+	if (cell != m_CachedCell) {
+		m_CachedSet.clear();
+		uint32_t object = 0;
+		for (uint32_t i = m_Offsets[cell]; i < m_Offsets[cell + 1]; i++) {
+			uint8_t byte = m_Data[i];
+			if (!byte) {
+				object += 8 * m_Data[++i];
+				continue;
+			}
+			for (int bit = 0; bit < 8; bit++, object++) {
+				if (byte & (1 << bit)) {
+					m_CachedSet.push_back(object);
+				}
+			}
+		}
+		m_CachedCell = cell;
+	}
+
+	auto stop = std::chrono::high_resolution_clock::now();
+
+	m_Stats.lookupMicroseconds = std::chrono::duration<float, std::micro>(stop - start).count();
+	return &m_CachedSet;
+}
+
+bool PVS::Save(const std::string& path) const {
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+
+	uint32_t offsetCount = (uint32_t)m_Offsets.size();
+	uint32_t dataSize	= (uint32_t)m_Data.size();
+
+	file.write((const char*)&PVS_MAGIC, sizeof(PVS_MAGIC));
+	file.write((const char*)&PVS_VERSION, sizeof(PVS_VERSION));
+	file.write((const char*)&m_SceneHash, sizeof(m_SceneHash));
+	file.write((const char*)&m_ObjectCount, sizeof(m_ObjectCount));
+	file.write((const char*)&m_Origin, sizeof(m_Origin));
+	file.write((const char*)&m_CellSize, sizeof(m_CellSize));
+	file.write((const char*)&m_Dims, sizeof(m_Dims));
+	file.write((const char*)&offsetCount, sizeof(offsetCount));
+	file.write((const char*)m_Offsets.data(), offsetCount * sizeof(uint32_t));
+	file.write((const char*)&dataSize, sizeof(dataSize));
+	file.write((const char*)m_Data.data(), dataSize);
+
+	return (bool)file;
+}
+
+bool PVS::Load(const std::string& path, const BoundsTable& objects) {
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+
+	uint32_t magic;
+	uint32_t version;
+	uint64_t hash;
+	file.read((char*)&magic, sizeof(magic));
+	file.read((char*)&version, sizeof(version));
+	file.read((char*)&hash, sizeof(hash));
+	if (!file || magic != PVS_MAGIC || version != PVS_VERSION || hash != HashScene(objects)) {
+		return false;
+	}
+
+	// Nothing in the file is trusted, Lookup indexes straight into what is read here.
+	auto reject = [&]() {
+		m_Offsets.clear();
+		m_Data.clear();
+		return false;
+	};
+
+	uint32_t offsetCount;
+	uint32_t dataSize;
+	file.read((char*)&m_ObjectCount, sizeof(m_ObjectCount));
+	file.read((char*)&m_Origin, sizeof(m_Origin));
+	file.read((char*)&m_CellSize, sizeof(m_CellSize));
+	file.read((char*)&m_Dims, sizeof(m_Dims));
+	file.read((char*)&offsetCount, sizeof(offsetCount));
+	if (!file || m_ObjectCount != objects.GetCount() || !(m_CellSize > 0.0f) || glm::any(glm::lessThan(m_Dims, glm::ivec3(1)))) {
+		return reject();
+	}
+	const uint64_t cellCount = (uint64_t)m_Dims.x * m_Dims.y * m_Dims.z;
+	const auto	   position	 = file.tellg();
+	file.seekg(0, std::ios::end);
+	const uint64_t remaining = (uint64_t)(file.tellg() - position);
+	file.seekg(position);
+	if (cellCount + 1 != offsetCount || (uint64_t)offsetCount * sizeof(uint32_t) + sizeof(dataSize) > remaining) {
+		return reject();
+	}
+
+	m_Offsets.resize(offsetCount);
+	file.read((char*)m_Offsets.data(), offsetCount * sizeof(uint32_t));
+	file.read((char*)&dataSize, sizeof(dataSize));
+	if (!file || m_Offsets.front() != 0 || m_Offsets.back() != dataSize) {
+		return reject();
+	}
+	m_Data.resize(dataSize);
+	file.read((char*)m_Data.data(), dataSize);
+	if (!file) {
+		return reject();
+	}
+
+	// Offsets ascend to dataSize, and every cell has to decode to exactly one set, runs included.
+	if (!std::is_sorted(m_Offsets.begin(), m_Offsets.end())) {
+		return reject();
+	}
+	const size_t setBytes = (m_ObjectCount + 7) / 8;
+	for (uint32_t cell = 0; cell < cellCount; cell++) {
+		size_t bytes = 0;
+		for (uint32_t i = m_Offsets[cell]; i < m_Offsets[cell + 1]; i++) {
+			if (m_Data[i]) {
+				bytes++;
+			} else if (++i < m_Offsets[cell + 1] && m_Data[i]) {
+				bytes += m_Data[i];
+			} else {
+				return reject();
+			}
+		}
+		if (bytes != setBytes) {
+			return reject();
+		}
+	}
+
+	m_SceneHash  = hash;
+	m_CachedCell = -1;
+
+	m_Stats.cells			= offsetCount - 1;
+	m_Stats.rawBytes		= (size_t)(m_ObjectCount + 7) / 8 * m_Stats.cells;
+	m_Stats.compressedBytes = dataSize;
+	return true;
+}
@@ -0,0 +1,87 @@
+
+#ifndef _PVS_HPP
+#define _PVS_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <model/bounds.hpp>
+
+class BVH;
+
+/*
+ * Potentially Visible Set class
+ * Splits the scene bounds into a grid of view cells and bakes, by ray
+ * casting from each cell towards every object, which objects can be seen
+ * from anywhere inside it. Segments run between fixed sample points, a
+ * grid over the cell and one over the object's box, each with its
+ * center, and an object is hidden only when every one of them is
+ * blocked. Openings narrower than the sample spacing, the box extent
+ * over samplesPerAxis - 1, can still be missed. Each cell keeps a bitset over the objects,
+ * compressed with zero byte run lengths.
+ * At runtime the camera position maps straight to a cell, whose set is
+ * decompressed once when the camera enters it.
+ */
+
+class PVS {
+public:
+	struct BakeParams {
+		float	cellSize	  = 8.0f;
+		uint32_t samplesPerAxis = 2; // Grid points per axis on the cell and the box, 2 for the corners
+	};
+
+	// Occluding geometry, owner is the object a triangle belongs to or NO_OWNER.
+	struct Occluders {
+		std::vector<glm::vec3> triangles; // 3 vertices per triangle, world space
+		std::vector<uint32_t>  owners;	// One per triangle
+	};
+
+	static const uint32_t NO_OWNER = ~0u;
+
+	struct Stats {
+		float	bakeMilliseconds;
+		uint64_t raysCast;
+		uint32_t cells;
+		size_t   rawBytes;
+		size_t   compressedBytes;
+		float	lookupMicroseconds; // Last lookup, including decompression
+	};
+
+private:
+	glm::vec3  m_Origin;
+	float	  m_CellSize;
+	glm::ivec3 m_Dims;
+	uint32_t   m_ObjectCount = 0;
+	uint64_t   m_SceneHash   = 0;
+
+	std::vector<uint32_t> m_Offsets; // Start of each cell in m_Data, cells + 1 entries
+	std::vector<uint8_t>  m_Data;
+
+	int32_t				  m_CachedCell = -1;
+	std::vector<uint32_t> m_CachedSet;
+	Stats				  m_Stats = {};
+
+	static uint64_t HashScene(const BoundsTable& objects);
+
+	int32_t GetCell(const glm::vec3& position) const;
+	void	BakeCell(uint32_t cell, const BoundsTable& objects, const Occluders& occluders, const BVH& tree, const BakeParams& params, std::vector<uint8_t>& bits, uint64_t& rays) const;
+
+public:
+	void Bake(const BoundsTable& objects, const Occluders& occluders, const BakeParams& params);
+
+	// The baked set is tied to the object bounds it was built from,
+	// Load fails if they have changed since.
+	bool Load(const std::string& path, const BoundsTable& objects);
+	bool Save(const std::string& path) const;
+
+	bool IsBaked() const { return !m_Offsets.empty(); }
+
+	// Objects potentially visible from the position, nullptr outside the grid.
+	const std::vector<uint32_t>* Lookup(const glm::vec3& position);
+
+	const Stats& GetStats() const { return m_Stats; }
+};
+
+#endif /* _PVS_HPP */
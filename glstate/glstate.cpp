@@ -0,0 +1,333 @@
+#include "glstate.hpp"
+
+#include <stdexcept>
+
+static const GLuint UNKNOWN = ~0u;
+
+enum BufferSlot {
+	SLOT_ARRAY,
+	SLOT_ELEMENT_ARRAY, // Part of the bound VAO
+	SLOT_COPY_READ,
+	SLOT_COPY_WRITE,
+	SLOT_UNIFORM,
+	SLOT_PIXEL_UNPACK,
+	SLOT_COUNT
+};
+
+enum CapabilitySlot {
+	CAP_BLEND,
+	CAP_DEPTH_TEST,
+	CAP_CULL_FACE,
+	CAP_SCISSOR_TEST,
+	CAP_STENCIL_TEST,
+	CAP_COUNT
+};
+
+struct Shadow {
+	GLuint program;
+	GLuint vao;
+	GLuint buffers[SLOT_COUNT];
+	struct {
+		GLuint	   buffer;
+		GLintptr   offset;
+		GLsizeiptr size; // -1 for the whole buffer
+	} uniformBindings[GLState::MAX_UNIFORM_BINDINGS];
+	GLuint activeUnit;
+	GLuint textures[GLState::MAX_TEXTURE_UNITS];
+	GLenum targets[GLState::MAX_TEXTURE_UNITS];
+	GLuint samplers[GLState::MAX_TEXTURE_UNITS];
+	int8_t capabilities[CAP_COUNT]; // -1 unknown
+	GLenum blendSource;
+	GLenum blendDestination;
+	GLenum depthFunc;
+	int8_t depthMask;
+	int8_t colorMask; // Packed rgba bits, -1 unknown
+	GLint  viewport[4];
+	bool   viewportKnown;
+
+	Shadow() { Reset(); }
+
+	void Reset() {
+		program = vao = activeUnit = UNKNOWN;
+		for (GLuint& b : buffers) {
+			b = UNKNOWN;
+		}
+		for (auto& u : uniformBindings) {
+			u = { UNKNOWN, 0, 0 };
+		}
+		for (uint32_t u = 0; u < GLState::MAX_TEXTURE_UNITS; u++) {
+			textures[u] = samplers[u] = UNKNOWN;
+			targets[u]				  = 0;
+		}
+		for (int8_t& c : capabilities) {
+			c = -1;
+		}
+		blendSource = blendDestination = depthFunc = UNKNOWN;
+		depthMask = colorMask = -1;
+		viewportKnown		  = false;
+	}
+};
+
+static thread_local Shadow			s_Shadow;
+static thread_local GLState::Stats s_Stats = {};
+
+static int GetBufferSlot(GLenum target) {
+	switch (target) {
+		case GL_ARRAY_BUFFER: return SLOT_ARRAY;
+		case GL_ELEMENT_ARRAY_BUFFER: return SLOT_ELEMENT_ARRAY;
+		case GL_COPY_READ_BUFFER: return SLOT_COPY_READ;
+		case GL_COPY_WRITE_BUFFER: return SLOT_COPY_WRITE;
+		case GL_UNIFORM_BUFFER: return SLOT_UNIFORM;
+		case GL_PIXEL_UNPACK_BUFFER: return SLOT_PIXEL_UNPACK;
+		default: return -1;
+	}
+}
+
+static int GetCapabilitySlot(GLenum capability) {
+	switch (capability) {
+		case GL_BLEND: return CAP_BLEND;
+		case GL_DEPTH_TEST: return CAP_DEPTH_TEST;
+		case GL_CULL_FACE: return CAP_CULL_FACE;
+		case GL_SCISSOR_TEST: return CAP_SCISSOR_TEST;
+		case GL_STENCIL_TEST: return CAP_STENCIL_TEST;
+		default: return -1;
+	}
+}
+
+// Counts the call and returns true when it has to reach GL.
+static bool Changed(GLState::Counter& counter, bool changed) {
+	if (changed) {
+		counter.issued++;
+	} else {
+		counter.elided++;
+	}
+	return changed;
+}
+
+void GLState::UseProgram(GLuint program) {
+
+	if (Changed(s_Stats.programs, s_Shadow.program != program)) {
+		glUseProgram(program);
+		s_Shadow.program = program;
+	}
+}
+
+void GLState::BindVertexArray(GLuint vao) {
+
+	if (Changed(s_Stats.vertexArrays, s_Shadow.vao != vao)) {
+		glBindVertexArray(vao);
+		s_Shadow.vao							= vao;
+		s_Shadow.buffers[SLOT_ELEMENT_ARRAY] = UNKNOWN;
+	}
+}
+
+void GLState::BindBuffer(GLenum target, GLuint buffer) {
+
+	int slot = GetBufferSlot(target);
+	if (Changed(s_Stats.buffers, slot < 0 || s_Shadow.buffers[slot] != buffer)) {
+		glBindBuffer(target, buffer);
+		if (slot >= 0) {
+			s_Shadow.buffers[slot] = buffer;
+		}
+	}
+}
+
+void GLState::BindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+
+	if (target != GL_UNIFORM_BUFFER || index >= MAX_UNIFORM_BINDINGS) {
+		s_Stats.uniformBuffers.issued++;
+		glBindBufferBase(target, index, buffer);
+		return;
+	}
+
+	auto& binding = s_Shadow.uniformBindings[index];
+	if (Changed(s_Stats.uniformBuffers, binding.buffer != buffer || binding.size != -1)) {
+		glBindBufferBase(target, index, buffer);
+		binding						  = { buffer, 0, -1 };
+		s_Shadow.buffers[SLOT_UNIFORM] = buffer;
+	}
+}
+
+void GLState::BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+
+	if (target != GL_UNIFORM_BUFFER || index >= MAX_UNIFORM_BINDINGS) {
+		s_Stats.uniformBuffers.issued++;
+		glBindBufferRange(target, index, buffer, offset, size);
+		return;
+	}
+
+	auto& binding = s_Shadow.uniformBindings[index];
+	if (Changed(s_Stats.uniformBuffers, binding.buffer != buffer || binding.offset != offset || binding.size != size)) {
+		glBindBufferRange(target, index, buffer, offset, size);
+		binding						  = { buffer, offset, size };
+		s_Shadow.buffers[SLOT_UNIFORM] = buffer;
+	}
+}
+
+void GLState::BindTexture(uint32_t unit, GLenum target, GLuint texture) {
+
+#ifndef NDEBUG
+	if (unit >= MAX_TEXTURE_UNITS) {
+		throw std::runtime_error("GLST::UNIT_OUT_OF_RANGE");
+	}
+#endif
+
+	if (!Changed(s_Stats.textures, s_Shadow.textures[unit] != texture || s_Shadow.targets[unit] != target)) {
+		return;
+	}
+	if (s_Shadow.activeUnit != unit) {
+		glActiveTexture(GL_TEXTURE0 + unit);
+		s_Shadow.activeUnit = unit;
+	}
+	glBindTexture(target, texture);
+	s_Shadow.textures[unit] = texture;
+	s_Shadow.targets[unit]	= target;
+}
+
+void GLState::BindSampler(uint32_t unit, GLuint sampler) {
+
+#ifndef NDEBUG
+	if (unit >= MAX_TEXTURE_UNITS) {
+		throw std::runtime_error("GLST::UNIT_OUT_OF_RANGE");
+	}
+#endif
+
+	if (Changed(s_Stats.samplers, s_Shadow.samplers[unit] != sampler)) {
+		glBindSampler(unit, sampler);
+		s_Shadow.samplers[unit] = sampler;
+	}
+}
+
+void GLState::Enable(GLenum capability) {
+
+	int slot = GetCapabilitySlot(capability);
+	if (Changed(s_Stats.capabilities, slot < 0 || s_Shadow.capabilities[slot] != 1)) {
+		glEnable(capability);
+		if (slot >= 0) {
+			s_Shadow.capabilities[slot] = 1;
+		}
+	}
+}
+
+void GLState::Disable(GLenum capability) {
+
+	int slot = GetCapabilitySlot(capability);
+	if (Changed(s_Stats.capabilities, slot < 0 || s_Shadow.capabilities[slot] != 0)) {
+		glDisable(capability);
+		if (slot >= 0) {
+			s_Shadow.capabilities[slot] = 0;
+		}
+	}
+}
+
+void GLState::BlendFunc(GLenum source, GLenum destination) {
+
+	if (Changed(s_Stats.blend, s_Shadow.blendSource != source || s_Shadow.blendDestination != destination)) {
+		glBlendFunc(source, destination);
+		s_Shadow.blendSource	  = source;
+		s_Shadow.blendDestination = destination;
+	}
+}
+
+void GLState::DepthFunc(GLenum func) {
+
+	if (Changed(s_Stats.depth, s_Shadow.depthFunc != func)) {
+		glDepthFunc(func);
+		s_Shadow.depthFunc = func;
+	}
+}
+
+void GLState::DepthMask(GLboolean write) {
+
+	if (Changed(s_Stats.depth, s_Shadow.depthMask != (int8_t)write)) {
+		glDepthMask(write);
+		s_Shadow.depthMask = (int8_t)write;
+	}
+}
+
+void GLState::ColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) {
+
+	int8_t mask = (int8_t)((red ? 1 : 0) | (green ? 2 : 0) | (blue ? 4 : 0) | (alpha ? 8 : 0));
+	if (Changed(s_Stats.colorMask, s_Shadow.colorMask != mask)) {
+		glColorMask(red, green, blue, alpha);
+		s_Shadow.colorMask = mask;
+	}
+}
+
+void GLState::Viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+
+	GLint* v	   = s_Shadow.viewport;
+	bool   changed = !s_Shadow.viewportKnown || v[0] != x || v[1] != y || v[2] != width || v[3] != height;
+	if (Changed(s_Stats.viewport, changed)) {
+		glViewport(x, y, width, height);
+		v[0]				   = x;
+		v[1]				   = y;
+		v[2]				   = width;
+		v[3]				   = height;
+		s_Shadow.viewportKnown = true;
+	}
+}
+
+// Deleting a bound object reverts its binding points to zero.
+void GLState::DeleteProgram(GLuint program) {
+
+	glDeleteProgram(program);
+	if (s_Shadow.program == program) {
+		s_Shadow.program = UNKNOWN;
+	}
+}
+
+void GLState::DeleteVertexArrays(GLsizei count, const GLuint* vaos) {
+
+	glDeleteVertexArrays(count, vaos);
+	for (GLsizei i = 0; i < count; i++) {
+		if (s_Shadow.vao == vaos[i]) {
+			s_Shadow.vao						 = 0;
+			s_Shadow.buffers[SLOT_ELEMENT_ARRAY] = UNKNOWN;
+		}
+	}
+}
+
+void GLState::DeleteBuffers(GLsizei count, const GLuint* buffers) {
+
+	glDeleteBuffers(count, buffers);
+	for (GLsizei i = 0; i < count; i++) {
+		for (GLuint& bound : s_Shadow.buffers) {
+			if (bound == buffers[i]) {
+				bound = 0;
+			}
+		}
+		for (auto& binding : s_Shadow.uniformBindings) {
+			if (binding.buffer == buffers[i]) {
+				binding = { 0, 0, -1 };
+			}
+		}
+	}
+}
+
+void GLState::DeleteTextures(GLsizei count, const GLuint* textures) {
+
+	glDeleteTextures(count, textures);
+	for (GLsizei i = 0; i < count; i++) {
+		for (GLuint& bound : s_Shadow.textures) {
+			if (bound == textures[i]) {
+				bound = 0;
+			}
+		}
+	}
+}
+
+void GLState::Invalidate() {
+
+	s_Shadow.Reset();
+}
+
+const GLState::Stats& GLState::GetStats() {
+
+	return s_Stats;
+}
+
+void GLState::ResetStats() {
+
+	s_Stats = {};
+}
@@ -0,0 +1,73 @@
+
+#ifndef _GLSTATE_HPP
+#define _GLSTATE_HPP
+
+#include <cstdint>
+
+#include <glad/glad.h>
+
+/*
+ * GL State class
+ * Shadows the bindings and fixed function state the engine touches and
+ * only forwards calls that change something. Every module binds through
+ * here, so the shadow copy stays in sync with the context; anything that
+ * goes around it must call Invalidate afterwards.
+ * The shadow is per thread, matching the one context current on it.
+ * Deleting objects goes through here too, GL reuses names.
+ */
+
+class GLState {
+public:
+	static const uint32_t MAX_TEXTURE_UNITS	= 32;
+	static const uint32_t MAX_UNIFORM_BINDINGS = 16;
+
+	struct Counter {
+		uint32_t issued;
+		uint32_t elided;
+	};
+
+	struct Stats {
+		Counter programs;
+		Counter vertexArrays;
+		Counter buffers;
+		Counter uniformBuffers; // Indexed binds
+		Counter textures; // Binds, active unit switches are folded in
+		Counter samplers;
+		Counter capabilities;
+		Counter blend;
+		Counter depth;
+		Counter colorMask;
+		Counter viewport;
+	};
+
+	static void UseProgram(GLuint program);
+	static void BindVertexArray(GLuint vao);
+	static void BindBuffer(GLenum target, GLuint buffer);
+	// Indexed uniform buffer bindings, these also set the generic binding.
+	static void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+	static void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+	static void BindTexture(uint32_t unit, GLenum target, GLuint texture);
+	static void BindSampler(uint32_t unit, GLuint sampler);
+
+	static void Enable(GLenum capability);
+	static void Disable(GLenum capability);
+	static void BlendFunc(GLenum source, GLenum destination);
+	static void DepthFunc(GLenum func);
+	static void DepthMask(GLboolean write);
+	static void ColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha);
+	static void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+	static void DeleteProgram(GLuint program);
+	static void DeleteVertexArrays(GLsizei count, const GLuint* vaos);
+	static void DeleteBuffers(GLsizei count, const GLuint* buffers);
+	static void DeleteTextures(GLsizei count, const GLuint* textures);
+
+	// Forget everything, the next call of each kind goes through.
+	static void Invalidate();
+
+	// Counters since the last reset, reset once per frame.
+	static const Stats& GetStats();
+	static void			ResetStats();
+};
+
+#endif /* _GLSTATE_HPP */
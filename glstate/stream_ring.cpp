@@ -0,0 +1,70 @@
+#include "stream_ring.hpp"
+#include "glstate.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+void StreamRing::WaitAll() {
+
+	for (GLsync& fence : m_Fences) {
+		if (fence) {
+			glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+			glDeleteSync(fence);
+			fence = 0;
+		}
+	}
+}
+
+void StreamRing::Next() {
+
+	if (!m_Buffer) {
+		return;
+	}
+	m_Fences[m_Segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_Segment			= (m_Segment + 1) % FRAMES;
+
+	GLsync& fence = m_Fences[m_Segment];
+	if (fence) {
+		glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		glDeleteSync(fence);
+		fence = 0;
+	}
+}
+
+void StreamRing::Upload(const void* data, GLsizeiptr size) {
+
+	if (!size) {
+		return;
+	}
+
+	// Regrow all segments at once, after the GPU is done with every one of them.
+	if (size > m_SegmentSize) {
+		WaitAll();
+		if (m_Buffer) {
+			GLState::DeleteBuffers(1, &m_Buffer);
+		}
+		m_SegmentSize = std::max(m_SegmentSize * 2, m_MinSegmentSize);
+		m_SegmentSize = std::max(m_SegmentSize, (size + m_MinSegmentSize - 1) / m_MinSegmentSize * m_MinSegmentSize);
+
+		glGenBuffers(1, &m_Buffer);
+		GLState::BindBuffer(m_Target, m_Buffer);
+		glBufferData(m_Target, m_SegmentSize * FRAMES, nullptr, m_Usage);
+	}
+
+	GLState::BindBuffer(m_Target, m_Buffer);
+	void* dst = glMapBufferRange(m_Target, GetBase(), size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	std::memcpy(dst, data, size);
+	glUnmapBuffer(m_Target);
+}
+
+StreamRing::~StreamRing() {
+
+	for (GLsync& fence : m_Fences) {
+		if (fence) {
+			glDeleteSync(fence);
+		}
+	}
+	if (m_Buffer) {
+		GLState::DeleteBuffers(1, &m_Buffer);
+	}
+}
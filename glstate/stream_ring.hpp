@@ -0,0 +1,52 @@
+
+#ifndef _STREAM_RING_HPP
+#define _STREAM_RING_HPP
+
+#include <cstdint>
+
+#include <glad/glad.h>
+
+/*
+ * Stream Ring class
+ * A buffer refilled every frame, split into a segment per frame in
+ * flight. Next fences the segment the last frame used and waits for the
+ * GPU to be done with the following one, so uploads into it are written
+ * unsynchronized. Every segment is regrown at once, in multiples of the
+ * minimum size, and only when an upload does not fit. With a power of
+ * two minimum every segment starts aligned for binding ranges of it.
+ */
+
+class StreamRing {
+public:
+	static const uint32_t FRAMES = 3;
+
+private:
+	const GLenum	 m_Target;
+	const GLenum	 m_Usage;
+	const GLsizeiptr m_MinSegmentSize;
+
+	GLuint	   m_Buffer		 = 0;
+	GLsizeiptr m_SegmentSize = 0;
+	uint32_t   m_Segment	 = 0;
+	GLsync	   m_Fences[FRAMES] = {};
+
+	void WaitAll();
+
+public:
+	// Moves on to the next segment, once the GPU is done with it.
+	void Next();
+	// Writes size bytes at the start of the current segment.
+	void Upload(const void* data, GLsizeiptr size);
+
+	GLuint	 GetBuffer() const { return m_Buffer; }
+	GLintptr GetBase() const { return m_Segment * m_SegmentSize; }
+
+	StreamRing(GLenum target, GLenum usage, GLsizeiptr minSegmentSize) :
+			m_Target(target), m_Usage(usage), m_MinSegmentSize(minSegmentSize) {
+	}
+	StreamRing(const StreamRing&) = delete;
+	StreamRing& operator=(const StreamRing&) = delete;
+	~StreamRing();
+};
+
+#endif /* _STREAM_RING_HPP */
@@ -0,0 +1,380 @@
+#include "job_system.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+static const uint32_t QUEUE_SIZE	  = 4096; // Jobs per thread, in the ring and the deque alike
+static const uint32_t IDLE_SPINS	  = 64;	  // Failed steal rounds before a worker sleeps
+static const uint32_t MAX_ATTACHED = 2;	  // Slots for threads Init did not start
+
+struct Job {
+	JobFunc			  func;
+	JobCounter*		  counter;
+	std::atomic<bool> busy{ false }; // Handed out and not finished
+};
+
+/*
+ * Job Deque class
+ * Fixed size Chase-Lev deque, with the memory orders of Le, Pop, Cohen
+ * and Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak
+ * Memory Models", except that Push releases with the store to bottom
+ * rather than a fence. Push and Pop are for the owning thread only.
+ */
+
+class JobDeque {
+	// Padded apart, stealers hammer the top while the owner works the bottom.
+	// C++14 has no over-aligned new, so no alignas.
+	std::atomic<int64_t> m_Top{ 0 };
+	uint8_t				 m_TopPad[64];
+	std::atomic<int64_t> m_Bottom{ 0 };
+	uint8_t				 m_BottomPad[64];
+	std::atomic<Job*>	 m_Jobs[QUEUE_SIZE];
+
+public:
+	// False when full.
+	bool Push(Job* job) {
+		int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+		int64_t top	   = m_Top.load(std::memory_order_acquire);
+		if (bottom - top >= (int64_t)QUEUE_SIZE) {
+			return false;
+		}
+		m_Jobs[bottom & (QUEUE_SIZE - 1)].store(job, std::memory_order_relaxed);
+		m_Bottom.store(bottom + 1, std::memory_order_release);
+		return true;
+	}
+
+	Job* Pop() {
+		int64_t bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+		m_Bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = m_Top.load(std::memory_order_relaxed);
+
+		if (top > bottom) {
+			m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+		Job* job = m_Jobs[bottom & (QUEUE_SIZE - 1)].load(std::memory_order_relaxed);
+		if (top == bottom) {
+			// Last one, race the stealers for it.
+			if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+				job = nullptr;
+			}
+			m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return job;
+	}
+
+	Job* Steal() {
+		int64_t top = m_Top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t bottom = m_Bottom.load(std::memory_order_acquire);
+
+		if (top >= bottom) {
+			return nullptr;
+		}
+		Job* job = m_Jobs[top & (QUEUE_SIZE - 1)].load(std::memory_order_relaxed);
+		if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			return nullptr;
+		}
+		return job;
+	}
+};
+
+struct Worker {
+	JobDeque		  deque;
+	Job				  ring[QUEUE_SIZE];
+	uint32_t		  next = 0; // Ring slot handed out next
+	std::thread		  thread;
+	std::atomic<bool> attached{ false }; // Attach slots only, claimed by a thread
+
+	std::atomic<uint64_t> executed{ 0 };
+	std::atomic<uint64_t> stolen{ 0 };
+	std::atomic<uint64_t> sleeps{ 0 };
+};
+
+struct Scheduler {
+	std::vector<std::unique_ptr<Worker>> workers; // Started by Init, then the attach slots
+	uint32_t							 threads;
+
+	// Sleeping workers wait for queued to go positive. Both are seq_cst, so a push
+	// either sees the sleeper and notifies, or the sleeper sees the job.
+	std::atomic<int64_t>	queued{ 0 };
+	std::atomic<uint32_t>	sleeping{ 0 };
+	std::atomic<bool>		quit{ false };
+	std::mutex				mutex;
+	std::condition_variable wake;
+};
+
+static Scheduler*			  s_Scheduler = nullptr;
+static thread_local int32_t s_Index	  = -1; // Into workers, -1 for threads not taking part
+
+// Not started lazily, two threads getting here first would both start one.
+static Scheduler& GetScheduler() {
+
+	if (!s_Scheduler) {
+		throw std::runtime_error("JOBS::NOT_INITIALIZED");
+	}
+	return *s_Scheduler;
+}
+
+// Checked in release too, a foreign thread would index the workers with -1.
+static Worker& GetSelf(Scheduler& scheduler) {
+
+	if (s_Index < 0) {
+		throw std::runtime_error("JOBS::NOT_ATTACHED");
+	}
+	return *scheduler.workers[s_Index];
+}
+
+// The last release happens under the counter's mutex, which Wait takes before returning,
+// so a counter on the waiter's stack is not touched once it is gone.
+void JobSystem::Release(JobCounter& counter, std::vector<Job*>& ready) {
+
+	uint32_t count = counter.m_Pending.load(std::memory_order_relaxed);
+	while (count > 1) {
+		if (counter.m_Pending.compare_exchange_weak(count, count - 1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+			return;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(counter.m_Mutex);
+	if (counter.m_Pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		ready.swap(counter.m_Waiting);
+	}
+}
+
+void JobSystem::Execute(Job* job) {
+
+	job->func();
+	job->func = nullptr;
+
+	// The slot may be handed out again as soon as it is not busy.
+	JobCounter* counter = job->counter;
+	job->busy.store(false, std::memory_order_release);
+
+	if (counter) {
+		std::vector<Job*> ready;
+		Release(*counter, ready);
+		for (Job* dependent : ready) {
+			Enqueue(dependent);
+		}
+	}
+}
+
+void JobSystem::Enqueue(Job* job) {
+
+	Scheduler& scheduler = *s_Scheduler;
+	if (!GetSelf(scheduler).deque.Push(job)) {
+		// Full, run it here rather than wait for room.
+		Execute(job);
+		GetSelf(scheduler).executed.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	scheduler.queued.fetch_add(1);
+	if (scheduler.sleeping.load()) {
+		std::lock_guard<std::mutex> lock(scheduler.mutex);
+		scheduler.wake.notify_one();
+	}
+}
+
+// Own jobs newest first, then the oldest job of the next worker that has any.
+bool JobSystem::RunOne(uint32_t self) {
+
+	Scheduler&	   scheduler = *s_Scheduler;
+	const uint32_t count	 = (uint32_t)scheduler.workers.size();
+	Worker&		   worker	 = *scheduler.workers[self];
+
+	Job* job = worker.deque.Pop();
+	for (uint32_t i = 1; !job && i < count; i++) {
+		job = scheduler.workers[(self + i) % count]->deque.Steal();
+		if (job) {
+			worker.stolen.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	if (!job) {
+		return false;
+	}
+
+	scheduler.queued.fetch_sub(1, std::memory_order_relaxed);
+	Execute(job);
+	worker.executed.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+void JobSystem::WorkerMain(uint32_t index) {
+
+	Scheduler* scheduler = s_Scheduler;
+	s_Index				 = (int32_t)index;
+
+	uint32_t idle = 0;
+	while (!scheduler->quit.load(std::memory_order_relaxed)) {
+		if (RunOne(index)) {
+			idle = 0;
+			continue;
+		}
+		if (++idle < IDLE_SPINS) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		idle = 0;
+		scheduler->workers[index]->sleeps.fetch_add(1, std::memory_order_relaxed);
+
+		std::unique_lock<std::mutex> lock(scheduler->mutex);
+		scheduler->sleeping.fetch_add(1);
+		scheduler->wake.wait(lock, [&] { return scheduler->queued.load() > 0 || scheduler->quit.load(); });
+		scheduler->sleeping.fetch_sub(1);
+	}
+}
+
+void JobSystem::Init(uint32_t threads) {
+
+	Shutdown();
+
+	if (!threads) {
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	s_Scheduler			 = new Scheduler();
+	s_Scheduler->threads = threads;
+	for (uint32_t i = 0; i < threads + MAX_ATTACHED; i++) {
+		s_Scheduler->workers.emplace_back(new Worker());
+	}
+
+	// The calling thread is worker 0.
+	s_Index = 0;
+	for (uint32_t i = 1; i < threads; i++) {
+		s_Scheduler->workers[i]->thread = std::thread(WorkerMain, i);
+	}
+}
+
+// Queued jobs are dropped, so shut down once idle.
+void JobSystem::Shutdown() {
+
+	if (!s_Scheduler) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(s_Scheduler->mutex);
+		s_Scheduler->quit.store(true);
+	}
+	s_Scheduler->wake.notify_all();
+	for (auto& worker : s_Scheduler->workers) {
+		if (worker->thread.joinable()) {
+			worker->thread.join();
+		}
+	}
+
+	delete s_Scheduler;
+	s_Scheduler = nullptr;
+	s_Index		= -1;
+}
+
+uint32_t JobSystem::GetThreadCount() {
+
+	return GetScheduler().threads;
+}
+
+// An empty slot is still stolen from, so claiming one needs no more than the flag.
+void JobSystem::Attach() {
+
+	Scheduler& scheduler = GetScheduler();
+	if (s_Index >= 0) {
+		return;
+	}
+	for (uint32_t i = scheduler.threads; i < scheduler.workers.size(); i++) {
+		bool free = false;
+		if (scheduler.workers[i]->attached.compare_exchange_strong(free, true, std::memory_order_acq_rel)) {
+			s_Index = (int32_t)i;
+			return;
+		}
+	}
+	throw std::runtime_error("JOBS::NO_ATTACH_SLOT");
+}
+
+void JobSystem::Detach() {
+
+	if (!s_Scheduler || s_Index < (int32_t)s_Scheduler->threads) {
+		return;
+	}
+	s_Scheduler->workers[s_Index]->attached.store(false, std::memory_order_release);
+	s_Index = -1;
+}
+
+void JobSystem::Run(JobFunc func, JobCounter* counter, JobCounter* dependency) {
+
+	Scheduler& scheduler = GetScheduler();
+	Worker&	   self		 = GetSelf(scheduler);
+
+	// A slot still busy means QUEUE_SIZE jobs are in flight from here, help until it frees.
+	Job* job = &self.ring[self.next++ & (QUEUE_SIZE - 1)];
+	while (job->busy.load(std::memory_order_acquire)) {
+		if (!RunOne((uint32_t)s_Index)) {
+			std::this_thread::yield();
+		}
+	}
+
+	job->func	 = std::move(func);
+	job->counter = counter;
+	job->busy.store(true, std::memory_order_relaxed);
+
+	if (counter) {
+		counter->m_Pending.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if (dependency) {
+		std::lock_guard<std::mutex> lock(dependency->m_Mutex);
+		if (!dependency->IsDone()) {
+			dependency->m_Waiting.push_back(job);
+			return;
+		}
+	}
+	Enqueue(job);
+}
+
+void JobSystem::Wait(JobCounter& counter) {
+
+	Scheduler& scheduler = GetScheduler();
+	GetSelf(scheduler);
+
+	while (!counter.IsDone()) {
+		if (!RunOne((uint32_t)s_Index)) {
+			std::this_thread::yield();
+		}
+	}
+
+	// Lets a Release still holding the mutex finish with the counter.
+	std::lock_guard<std::mutex> lock(counter.m_Mutex);
+}
+
+JobSystem::Stats JobSystem::GetStats() {
+
+	Stats stats = {};
+	if (s_Scheduler) {
+		for (auto& worker : s_Scheduler->workers) {
+			stats.executed += worker->executed.load(std::memory_order_relaxed);
+			stats.stolen += worker->stolen.load(std::memory_order_relaxed);
+			stats.sleeps += worker->sleeps.load(std::memory_order_relaxed);
+		}
+	}
+	return stats;
+}
+
+void JobSystem::ResetStats() {
+
+	if (s_Scheduler) {
+		for (auto& worker : s_Scheduler->workers) {
+			worker->executed.store(0, std::memory_order_relaxed);
+			worker->stolen.store(0, std::memory_order_relaxed);
+			worker->sleeps.store(0, std::memory_order_relaxed);
+		}
+	}
+}
+
+// Joins the workers on exit, as the worker pool did.
+static struct ShutdownAtExit {
+	~ShutdownAtExit() { JobSystem::Shutdown(); }
+} s_ShutdownAtExit;
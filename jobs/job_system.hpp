@@ -0,0 +1,90 @@
+
+#ifndef _JOB_SYSTEM_HPP
+#define _JOB_SYSTEM_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+using JobFunc = std::function<void()>;
+
+struct Job;
+
+/*
+ * Job Counter class
+ * Counts the jobs run against it that have not finished yet. Jobs may
+ * depend on a counter, they are queued once it drops to zero. A counter
+ * can be reused once done, and must outlive the jobs run against it.
+ */
+
+class JobCounter {
+	std::atomic<uint32_t> m_Pending{ 0 };
+	std::mutex			  m_Mutex;
+	std::vector<Job*>	  m_Waiting; // Jobs depending on this counter
+
+	friend class JobSystem;
+
+public:
+	bool IsDone() const { return m_Pending.load(std::memory_order_acquire) == 0; }
+
+	JobCounter() {}
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+};
+
+/*
+ * Job System class
+ * Work stealing scheduler. Every thread taking part, the one that first
+ * used the system included, owns a Chase-Lev deque: it pushes and pops
+ * jobs at the bottom of its own, idle threads steal from the top of the
+ * others'. Jobs come out of a fixed ring per thread, so running one does
+ * not allocate unless the function's captures do.
+ * Waiting on a counter runs other jobs in the meantime, so jobs can wait
+ * on jobs. Workers with nothing to steal spin briefly, then sleep until
+ * something is queued.
+ * Init must be called before anything else, there is no lazy start.
+ * Only threads taking part may run jobs or wait. Besides the ones Init
+ * starts, a few long lived threads of their own, like the render thread,
+ * can take part by attaching. Others get JOBS::NOT_ATTACHED.
+ */
+
+class JobSystem {
+	static bool RunOne(uint32_t self);
+	static void Execute(Job* job);
+	static void Enqueue(Job* job);
+	static void Release(JobCounter& counter, std::vector<Job*>& ready);
+	static void WorkerMain(uint32_t index);
+
+public:
+	struct Stats {
+		uint64_t executed;
+		uint64_t stolen; // Executed by a thread other than the one queueing it
+		uint64_t sleeps; // Times a worker went idle
+	};
+
+	// Threads taking part, the calling thread included. 0 for one per core. Restarts the workers if running.
+	static void Init(uint32_t threads = 0);
+	static void Shutdown();
+
+	// Threads Init started, the calling thread included. Attached threads are not counted.
+	static uint32_t GetThreadCount();
+
+	// Lets the calling thread run jobs and wait, with a deque of its own. Detach before it exits,
+	// with nothing of its own still queued.
+	static void Attach();
+	static void Detach();
+
+	// Queues func. The counter, if any, is counted up until it finished. With a dependency,
+	// the job is only queued once that counter is done.
+	static void Run(JobFunc func, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+	// Runs jobs until the counter is done.
+	static void Wait(JobCounter& counter);
+
+	static Stats GetStats();
+	static void	 ResetStats();
+};
+
+#endif /* _JOB_SYSTEM_HPP */
@@ -0,0 +1,43 @@
+#include "parallel.hpp"
+#include "job_system.hpp"
+
+#include <algorithm>
+
+uint32_t GetWorkerCount() {
+	return JobSystem::GetThreadCount();
+}
+
+uint32_t GetRangeCount(uint32_t count, uint32_t minPerRange) {
+	uint32_t ranges = std::min(GetWorkerCount(), count / std::max(1u, minPerRange));
+	return std::max(1u, ranges);
+}
+
+// Small enough that the job captures fit in std::function without allocating.
+struct ParallelBatch {
+	const ParallelForFunc* func;
+	uint32_t			   count;
+	uint32_t			   ranges;
+
+	void RunRange(uint32_t r) const {
+		uint32_t begin = (uint32_t)((uint64_t)count * r / ranges);
+		uint32_t end   = (uint32_t)((uint64_t)count * (r + 1) / ranges);
+		(*func)(begin, end, r);
+	}
+};
+
+void ParallelFor(uint32_t count, uint32_t minPerRange, const ParallelForFunc& func) {
+
+	uint32_t ranges = GetRangeCount(count, minPerRange);
+	if (ranges == 1) {
+		func(0, count, 0);
+		return;
+	}
+
+	const ParallelBatch batch = { &func, count, ranges };
+	JobCounter			counter;
+	for (uint32_t r = 1; r < ranges; r++) {
+		JobSystem::Run([&batch, r] { batch.RunRange(r); }, &counter);
+	}
+	batch.RunRange(0);
+	JobSystem::Wait(counter);
+}
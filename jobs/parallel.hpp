@@ -0,0 +1,29 @@
+
+#ifndef _PARALLEL_HPP
+#define _PARALLEL_HPP
+
+#include <cstdint>
+#include <memory/function_ref.hpp>
+
+/*
+ * Parallel For
+ * Splits [0, count) into contiguous ranges and runs them as jobs on the
+ * JobSystem, the calling thread taking the first range itself.
+ * Range i always covers lower indices than range i + 1, so per-range
+ * outputs can be concatenated in order.
+ * Returns once every range has finished, running other jobs meanwhile,
+ * so it can be called from inside jobs and other ParallelFor ranges.
+ */
+
+// ParallelFor returns before the callable it was handed goes away.
+using ParallelForFunc = FunctionRef<void(uint32_t begin, uint32_t end, uint32_t range)>;
+
+// Number of threads taking part in ParallelFor, including the caller.
+uint32_t GetWorkerCount();
+
+// Number of ranges ParallelFor would split count into.
+uint32_t GetRangeCount(uint32_t count, uint32_t minPerRange);
+
+void ParallelFor(uint32_t count, uint32_t minPerRange, const ParallelForFunc& func);
+
+#endif /* _PARALLEL_HPP */
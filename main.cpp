@@ -24,6 +24,7 @@
 
 #include "main.hpp"
 #include <cstdlib>
+#include <sys/stat.h>
 
 int main() {
 
@@ -39,27 +40,279 @@ int main() {
 	return EXIT_SUCCESS;
 }
 
-Material* mat;
-Mesh*	 mesh;
+Material*			   materials[3]; // Two opaque, one glass
+Mesh*				   mesh;
+std::vector<glm::mat4> transforms;
+std::vector<uint32_t>  objectMaterial;
+float				   elapsed;
+
+static constexpr UniformId VIEW_PROJ("viewProj");
+
+// Feature bits of the scene shader.
+static const uint64_t SCENE_INSTANCED = 1 << 0;
+
 // Set up the scene and object
 void MainApp::Setup() {
-	auto shdr = m_ShaderLoader.Load("default", "assets/shaders/vshader.vs", "assets/shaders/fshader.fs");
-	mesh	  = m_MeshLoader.Load("tet");
-	mat		  = new Material(shdr);
-	auto tex  = m_TextureLoader.Load("text2d", "assets/models/skybox/front.jpg", {});
-	mat->SetTexture("text2d", tex, 2);
-	mat->Attach();
+	// Culling, the PVS bake and BVH builds run as jobs, this thread taking part.
+	JobSystem::Init();
+
+	if (m_UploadWindow) {
+		m_Uploads.Start(
+			[this]() {
+				glfwMakeContextCurrent(m_UploadWindow);
+				GLState::Invalidate();
+			},
+			[]() { glfwMakeContextCurrent(nullptr); });
+	}
+
+	// Linked programs are cached per driver, so later launches skip compiling.
+	mkdir("cache", 0755);
+	mkdir("cache/shaders", 0755);
+	m_ShaderLoader.Init("cache/shaders", (GLADloadproc)glfwGetProcAddress);
+	std::cout << "Shaders: program binaries " << (m_ShaderLoader.GetCache().IsEnabled() ? "cached" : "unsupported") << ", "
+			  << (m_ShaderLoader.IsParallel() ? "parallel" : "serial") << " compile" << std::endl;
+
+	// Scene shaders compile in the background, drawn with the fallback until ready.
+	m_Queue.SetFallback(m_ShaderLoader.Load("fallback", "assets/shaders/fallback.vs", "assets/shaders/fallback.fs"));
+	m_ShaderLoader.Register("scene", "assets/shaders/scene.vs", "assets/shaders/scene.fs", { "INSTANCED" });
+	m_ShaderLoader.Prewarm("cache/shaders/usage.txt");
+	auto shdr = m_ShaderLoader.GetVariant("scene", 0);
+	auto inst = m_ShaderLoader.GetVariant("scene", SCENE_INSTANCED);
+	mesh	  = m_MeshLoader.Load("tet", true);
+	// Decoded and uploaded in the background, sampled as black until then.
+	auto front = m_TextureLoader.LoadAsync("front", "assets/models/skybox/front.jpg", {}, m_Uploads);
+	auto back  = m_TextureLoader.LoadAsync("back", "assets/models/skybox/back.jpg", {}, m_Uploads);
+	for (int i = 0; i < 3; i++) {
+		materials[i] = m_Materials.Get(m_Materials.Create(shdr));
+		materials[i]->SetInstancedShader(inst);
+		materials[i]->SetTexture(ShaderReflection::scene::text2d, i == 1 ? back : front, 2);
+		materials[i]->Set(ShaderReflection::scene::alpha, i == 2 ? 0.4f : 1.0f);
+	}
+
+	// A field of objects around the origin, most of it off screen at any time.
+	const int GRID = 64;
+	for (int x = 0; x < GRID; x++) {
+		for (int z = 0; z < GRID; z++) {
+			glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(x - GRID / 2, 0.0f, z - GRID / 2) * 2.0f);
+			transforms.push_back(model);
+			objectMaterial.push_back((x + z) % 16 == 0 ? 2 : (x + z) & 1);
+			m_ObjectBounds.Add(mesh->m_Bounds.Transform(model));
+		}
+	}
+
+	// A ring of large pillars, drawn as objects and rasterized as occluders.
+	const MeshData* data = m_MeshLoader.GetData("tet");
+	PVS::Occluders	occluders;
+	for (int i = 0; i < 12; i++) {
+		float	 angle = glm::two_pi<float>() * i / 12.0f;
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(std::sin(angle), 0.0f, std::cos(angle)) * 12.0f);
+		model			= glm::scale(model, glm::vec3(8.0f, 24.0f, 8.0f));
+		transforms.push_back(model);
+		objectMaterial.push_back(0);
+		m_ObjectBounds.Add(mesh->m_Bounds.Transform(model));
+		m_Occlusion.AddOccluder(data->positions.data(), data->indices.data(), (uint32_t)data->indices.size(), model);
+
+		for (uint32_t idx : data->indices) {
+			occluders.triangles.push_back(glm::vec3(model * glm::vec4(data->positions[idx], 1.0f)));
+		}
+		occluders.owners.resize(occluders.triangles.size() / 3, (uint32_t)transforms.size() - 1);
+	}
+
+	// Static scene, so the visibility bake is cached on disk.
+	if (!m_PVS.Load("cache/scene.pvs", m_ObjectBounds)) {
+		PVS::BakeParams params;
+		params.cellSize = 16.0f;
+		m_PVS.Bake(m_ObjectBounds, occluders, params);
+
+		m_PVS.Save("cache/scene.pvs");
+
+		const PVS::Stats& stats = m_PVS.GetStats();
+		std::cout << "PVS: baked " << stats.cells << " cells in " << stats.bakeMilliseconds << "ms, " << stats.raysCast << " rays, "
+				  << stats.compressedBytes << "/" << stats.rawBytes << " bytes" << std::endl;
+	}
+
+	auto box = m_ShaderLoader.Load("bbox", "assets/shaders/bbox.vs", "assets/shaders/bbox.fs");
+	m_Queries.Init(box, m_MeshLoader.Load("unit_cube", OcclusionQueries::UnitCube(), VertexLayout::Split()));
+
+	m_Camera.SetPerspective(glm::radians(60.0f), (float)WIDTH / HEIGHT, 0.1f, 200.0f);
+
+	// Edits to shaders and textures show up without a restart.
+	if (!m_Reloader.Start("assets")) {
+		std::cout << "Assets: hot reload unavailable" << std::endl;
+	}
 }
 
-// Update function
+// Simulation and culling, then the frame is handed to the render thread.
 void MainApp::Update(float deltaTime) {
+#ifndef NDEBUG
+	// Every thread's allocations since the last Update, a frame's worth.
+	const HeapCounter::Stats heap = HeapCounter::GetStats();
+	HeapCounter::ResetStats();
+#endif
+	JobSystem::ResetStats();
+	m_RenderThread.ResetStats();
+
+	// The render thread is done with this slot, EndFrame waited for it.
+	FrameState& frame = m_Frames[m_Frame++ & 1];
+	frame.arena.Reset();
+
+	elapsed += deltaTime;
+	m_Camera.SetPosition(glm::vec3(0.0f, 4.0f, 0.0f));
+	m_Camera.SetRotation(elapsed * 0.5f, -0.2f);
+
+	// The PVS narrows the candidates in O(1) when the camera is inside its grid.
+	const Frustum				 frustum	= Frustum::FromMatrix(m_Camera.GetViewProjection());
+	const std::vector<uint32_t>* candidates = m_PVS.Lookup(m_Camera.GetPosition());
+	if (candidates) {
+		m_Culler.Cull(m_ObjectBounds, frustum, *candidates, m_Visible);
+	} else {
+		m_Culler.Cull(m_ObjectBounds, frustum, m_Visible);
+	}
+	m_Occlusion.Render(m_Camera.GetViewProjection());
+	m_Occlusion.Cull(m_ObjectBounds, m_Camera.GetViewProjection(), m_Visible);
+	frame.visible	   = frame.arena.Copy(m_Visible.data(), m_Visible.size());
+	frame.visibleCount = (uint32_t)m_Visible.size();
+
+	frame.data				  = {};
+	frame.data.view			  = m_Camera.GetView();
+	frame.data.projection	  = m_Camera.GetProjection();
+	frame.data.viewProj		  = m_Camera.GetViewProjection();
+	frame.data.cameraPosition = glm::vec4(m_Camera.GetPosition(), 1.0f);
+	frame.data.time			  = glm::vec4(elapsed, deltaTime, 0.0f, 0.0f);
+	frame.data.lights[0]	  = { glm::vec4(glm::normalize(glm::vec3(0.3f, 1.0f, 0.2f)), 0.0f), glm::vec4(1.0f) };
+	frame.data.lightCount	  = glm::ivec4(1, 0, 0, 0);
+	frame.eye				  = m_Camera.GetPosition();
+	frame.nearPlane			  = m_Camera.GetNear();
+	frame.farPlane			  = m_Camera.GetFar();
+	frame.deltaTime			  = deltaTime;
+
+	m_RenderThread.Submit([this, &frame]() {
+		Render(frame);
+		glfwSwapBuffers(m_Window);
+	});
+
+#ifndef NDEBUG
+	static float report = 0.0f;
+	if ((report += deltaTime) > 1.0f) {
+		const FrustumCuller::Stats& stats = m_Culler.GetStats();
+		std::cout << "Cull: " << stats.visible << "/" << stats.tested << " visible in " << stats.milliseconds << "ms" << std::endl;
+		if (candidates) {
+			std::cout << "PVS: " << candidates->size() << "/" << m_ObjectBounds.GetCount() << " candidates, lookup " << m_PVS.GetStats().lookupMicroseconds << "us" << std::endl;
+		}
+		const OcclusionCuller::Stats& occ = m_Occlusion.GetStats();
+		std::cout << "Occlusion: " << occ.rejected << "/" << occ.tested << " rejected, "
+				  << occ.occluderTriangles << " occluder tris, raster " << occ.rasterMilliseconds << "ms, test " << occ.testMilliseconds << "ms" << std::endl;
+		const JobSystem::Stats  jobs = JobSystem::GetStats();
+		std::cout << "Jobs: " << jobs.executed << " run on " << JobSystem::GetThreadCount() << " threads, " << jobs.stolen << " stolen, " << jobs.sleeps << " sleeps" << std::endl;
+		const RenderThread::Stats rt = m_RenderThread.GetStats();
+		std::cout << "Render thread: " << rt.frames << " frames, main waited " << rt.waitMilliseconds << "ms, render idle " << rt.idleMilliseconds << "ms" << std::endl;
+		const FrameArena::Stats arena = frame.arena.GetStats();
+		std::cout << "Heap: " << heap.allocations << " allocations / " << heap.bytes << " bytes last frame, frame arena " << arena.bytes << "/" << arena.peakBytes
+				  << " bytes peak in " << arena.blocks << " blocks, grown " << arena.grows << " times" << std::endl;
+		report = 0.0f;
+	}
+#endif
+}
+
+// Render thread. Draws a frame filled in by Update, touching nothing the main thread writes.
+void MainApp::Render(const FrameState& frame) {
+	GLState::ResetStats();
+	Material::ResetStats();
+
+	// Between frames, so nothing drawn this frame changes under it.
+	m_Uploads.Update();
+	m_Reloader.Update(m_ShaderLoader, m_TextureLoader);
+
+	uint32_t pending = m_ShaderLoader.Update();
+	if (!m_ShadersReady && !pending) {
+		const ProgramCache::Stats& cache = m_ShaderLoader.GetCache().GetStats();
+		std::cout << "Shaders: " << m_ShaderLoader.GetStats().submitted << " ready after " << m_ShaderLoader.GetStats().batchMilliseconds << "ms, "
+				  << cache.hits << " cached, " << cache.misses << " compiled, " << cache.rejected << " rejected, load "
+				  << cache.loadMilliseconds << "ms, compile " << cache.compileMilliseconds << "ms, saved " << cache.savedMilliseconds << "ms" << std::endl;
+		m_ShadersReady = true;
+	}
 	glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
-	glBindVertexArray(mesh->m_VAO);
-	glDrawElements(mesh->m_Mode, mesh->m_Count, GL_UNSIGNED_INT, 0);
+	m_Queue.Begin(frame.eye, frame.farPlane);
+	for (uint32_t n = 0; n < frame.visibleCount; n++) {
+		uint32_t		  i	   = frame.visible[n];
+		RenderQueue::Pass pass = objectMaterial[i] == 2 ? RenderQueue::PASS_TRANSPARENT : RenderQueue::PASS_OPAQUE;
+		m_Queue.Submit(pass, mesh, materials[objectMaterial[i]], &transforms[i], m_ObjectBounds.Get(i).center, i);
+	}
+	m_Queue.Sort();
+
+	m_FrameData.Upload(&frame.data, sizeof(frame.data));
+	m_FrameData.Bind(UniformBlocks::FRAME);
+
+	// Only shaders without the FrameData block need the camera set by hand.
+	auto setup = [&](Shader* shader) {
+		if (!shader->UsesBlock(UniformBlocks::FRAME)) {
+			shader->SetMatrix(VIEW_PROJ, frame.data.viewProj);
+		}
+	};
+
+	if (m_HardwareOcclusion) {
+		// Last frame's visible set goes through the batched path, the hidden
+		// objects are drawn one at a time in sorted order under their queries.
+		const std::vector<DrawPacket>& packets = m_Queue.GetPackets();
+		m_Sorted.clear();
+		m_PacketOf.resize(m_ObjectBounds.GetCount());
+		for (uint32_t index : m_Queue.GetOrder()) {
+			m_Sorted.push_back(packets[index].object);
+			m_PacketOf[packets[index].object] = index;
+		}
+
+		m_Queries.Begin(m_ObjectBounds, m_Sorted, frame.eye, frame.nearPlane);
+		auto visible = [&](uint32_t i) {
+			return m_Queries.WasVisible(i);
+		};
+		m_Queue.Execute(setup, visible);
+
+		auto bind = [&]() {
+			m_Queue.Invalidate();
+		};
+		auto draw = [&](uint32_t i) {
+			m_Queue.Draw(packets[m_PacketOf[i]], setup);
+		};
+		m_Queries.Render(m_ObjectBounds, frame.data.viewProj, bind, draw);
+		m_Queue.End();
+	} else {
+		m_Queue.Execute(setup);
+	}
+
+#ifndef NDEBUG
+	static float report = 0.0f;
+	if ((report += frame.deltaTime) > 1.0f) {
+		if (m_HardwareOcclusion) {
+			const OcclusionQueries::Stats& q = m_Queries.GetStats();
+			std::cout << "Queries: " << q.drawn << " drawn, " << q.conditional << " conditional, " << q.culled << "/" << q.resultsRead
+					  << " results occluded, " << q.issued << " issued, latency " << q.averageLatency << " frames" << std::endl;
+		}
+		const RenderQueue::Stats& rq = m_Queue.GetStats();
+		std::cout << "Queue: " << rq.packets << " packets in " << rq.draws << " draws (" << rq.instances << " instanced in " << rq.instancedDraws
+				  << ", " << rq.fallbackDraws << " fallback, " << rq.keyOverflows << " key overflows), sorted in " << rq.sortMicroseconds << "us, programs/materials/textures/meshes "
+				  << rq.submitted.programs << "/" << rq.submitted.materials << "/" << rq.submitted.textures << "/" << rq.submitted.meshes << " unsorted, "
+				  << rq.executed.programs << "/" << rq.executed.materials << "/" << rq.executed.textures << "/" << rq.executed.meshes << " sorted, "
+				  << rq.commandBytes << " command bytes in " << rq.recorders << " buffers, recorded in " << rq.recordMicroseconds << "us" << std::endl;
+		const UploadThread::Stats up = m_Uploads.GetStats();
+		std::cout << "Uploads: " << up.completed << "/" << up.submitted << " done, " << up.uploadMilliseconds << "ms on the upload thread" << std::endl;
+		const Material::Stats& ms = Material::GetStats();
+		std::cout << "Materials: " << ms.attaches << " attaches, " << ms.clean << " clean, " << ms.uniforms << " uniforms + " << ms.blocks << " blocks / " << ms.bytes << " bytes uploaded" << std::endl;
+		const GLState::Stats& gl = GLState::GetStats();
+		std::cout << "GL state: programs " << gl.programs.issued << "/" << gl.programs.elided << ", vaos " << gl.vertexArrays.issued << "/" << gl.vertexArrays.elided
+				  << ", buffers " << gl.buffers.issued << "/" << gl.buffers.elided << ", textures " << gl.textures.issued << "/" << gl.textures.elided
+				  << ", fixed function " << gl.capabilities.issued + gl.blend.issued + gl.depth.issued + gl.colorMask.issued + gl.viewport.issued << "/"
+				  << gl.capabilities.elided + gl.blend.elided + gl.depth.elided + gl.colorMask.elided + gl.viewport.elided << " issued/elided" << std::endl;
+		report = 0.0f;
+	}
+#endif
 }
 
 // Delete whatever is not important.
 void MainApp::Teardown() {
-	delete mat;
+	m_Uploads.Stop();
+	m_Uploads.Finish();
+	m_Reloader.Stop();
+	m_ShaderLoader.SaveUsage("cache/shaders/usage.txt");
+	m_Materials.Clear();
 }
\ No newline at end of file
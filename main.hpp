@@ -30,11 +30,27 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 
+#include <camera/camera.hpp>
 #include <chrono>
+#include <culling/frustum.hpp>
+#include <culling/occlusion.hpp>
+#include <culling/occlusion_query.hpp>
+#include <culling/pvs.hpp>
+#include <glstate/glstate.hpp>
+#include <jobs/job_system.hpp>
 #include <material/material.hpp>
+#include <memory/frame_arena.hpp>
+#include <memory/heap_counter.hpp>
 #include <model/mesh.hpp>
+#include <render/render_queue.hpp>
+#include <render/render_thread.hpp>
+#include <resource/resource_pool.hpp>
+#include <shader/generated/shader_reflection.hpp>
 #include <shader/shader.hpp>
+#include <shader/uniform_buffer.hpp>
 #include <texture/texture.hpp>
+#include <upload/upload_thread.hpp>
+#include <watch/asset_reloader.hpp>
 
 /*
  * Main Application class
@@ -67,10 +83,49 @@ public:
 class MainApp {
 
 	GLFWwindow*   m_Window;
+	GLFWwindow*   m_UploadWindow; // Hidden, its context shares objects with the window's
 	Time		  m_Timer;
 	ShaderLoader  m_ShaderLoader;
 	TextureLoader m_TextureLoader;
 	MeshLoader	m_MeshLoader;
+	Camera		  m_Camera;
+	BoundsTable   m_ObjectBounds; // World space bounds of every object
+	FrustumCuller m_Culler;
+
+	OcclusionCuller  m_Occlusion;
+	OcclusionQueries m_Queries;
+	PVS				 m_PVS;
+	bool			 m_HardwareOcclusion = true; // GPU queries after the CPU cull
+
+	// Everything the render thread needs of a frame. Two of them, the main thread
+	// fills one while the render thread draws the other. Anything of variable size
+	// goes in the arena, reset when the main thread takes the slot again.
+	struct FrameState {
+		FrameArena		arena;
+		const uint32_t* visible		 = nullptr;
+		uint32_t		visibleCount = 0;
+		FrameData		data;
+		glm::vec3		eye;
+		float			nearPlane;
+		float			farPlane;
+		float			deltaTime;
+	};
+
+	FrameState			  m_Frames[2];
+	std::vector<uint32_t> m_Visible; // Culling output, copied into the frame's arena
+	uint64_t	 m_Frame = 0;
+	RenderThread m_RenderThread; // Owns the context between Setup and Teardown
+	UploadThread m_Uploads;		 // Textures and meshes, on the upload window's context
+
+	ResourcePool<Material> m_Materials;
+
+	RenderQueue			  m_Queue;
+	std::vector<uint32_t> m_Sorted;	  // Visible objects in queue order
+	std::vector<uint32_t> m_PacketOf; // Object to packet index
+
+	UniformBuffer m_FrameData; // Camera, time and lights, bound at UniformBlocks::FRAME
+	bool		  m_ShadersReady = false; // Background compiles all finished
+	AssetReloader m_Reloader;			  // Hot reload of everything under assets/
 
 	void
 	InitWindow();
@@ -78,6 +133,7 @@ class MainApp {
 	void Setup();
 	void MainLoop();
 	void Update(float deltaTime);
+	void Render(const FrameState& frame);
 	void Teardown();
 	void Cleanup();
 
@@ -111,6 +167,10 @@ void MainApp::InitWindow() {
 		throw std::runtime_error("GLFW::WINDOW_INIT_ERR");
 	}
 
+	// Only ever current on the upload thread. Loading happens in the foreground without it.
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	m_UploadWindow = glfwCreateWindow(1, 1, "", nullptr, m_Window);
+
 	glfwMakeContextCurrent(m_Window);
 }
 
@@ -121,12 +181,26 @@ void MainApp::LoadOpenGL() {
 		throw std::runtime_error("GLAD::FAILED_OPENGL_LOAD");
 	}
 
-	glViewport(0, 0, WIDTH, HEIGHT);
+	GLState::Viewport(0, 0, WIDTH, HEIGHT);
+	GLState::Enable(GL_DEPTH_TEST);
 }
 
-// Main Gameloop
+// Main Gameloop. Events and simulation here, drawing on the render thread a frame behind.
 void MainApp::MainLoop() {
 
+	glfwMakeContextCurrent(nullptr);
+	m_RenderThread.Start(
+		[this]() {
+			glfwMakeContextCurrent(m_Window);
+			GLState::Invalidate();
+			// Records the queue's command buffers in parallel.
+			JobSystem::Attach();
+		},
+		[]() {
+			JobSystem::Detach();
+			glfwMakeContextCurrent(nullptr);
+		});
+
 	m_Timer.Init();
 	while (!glfwWindowShouldClose(m_Window)) {
 		m_Timer.Update();
@@ -134,13 +208,20 @@ void MainApp::MainLoop() {
 
 		Update(m_Timer.deltaTime);
 
-		glfwSwapBuffers(m_Window);
+		m_RenderThread.EndFrame();
 	}
+
+	m_RenderThread.Stop();
+	glfwMakeContextCurrent(m_Window);
+	GLState::Invalidate();
 }
 
 // Cleanup part to delete everythin what has been created.
 void MainApp::Cleanup() {
 
+	if (m_UploadWindow) {
+		glfwDestroyWindow(m_UploadWindow);
+	}
 	glfwDestroyWindow(m_Window);
 	glfwTerminate();
 }
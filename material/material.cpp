@@ -1,77 +1,233 @@
 
 #include "material.hpp"
 #include <glad/glad.h>
+#include <glstate/glstate.hpp>
 #include <shader/shader.hpp>
+#include <shader/uniform_buffer.hpp>
 #include <texture/texture.hpp>
 
+#include <cstring>
+
+uint64_t		 Material::s_NextId = 0;
+Material::Stats Material::s_Stats  = {};
+
+static uint32_t GetUniformSize(uint32_t type) {
+	switch (type) {
+		case GL_FLOAT_VEC2: return sizeof(glm::vec2);
+		case GL_FLOAT_VEC3: return sizeof(glm::vec3);
+		case GL_FLOAT_VEC4: return sizeof(glm::vec4);
+		case GL_FLOAT_MAT2: return sizeof(glm::mat2);
+		case GL_FLOAT_MAT3: return sizeof(glm::mat3);
+		case GL_FLOAT_MAT4: return sizeof(glm::mat4);
+		default: return 4;
+	}
+}
+
+// Matrices are stored column major, std140 pads every column to matrixStride.
+static void PackStd140(uint8_t* dst, const uint8_t* src, uint32_t type, int32_t matrixStride) {
+	uint32_t columns = 0;
+	switch (type) {
+		case GL_FLOAT_MAT2: columns = 2; break;
+		case GL_FLOAT_MAT3: columns = 3; break;
+		case GL_FLOAT_MAT4: columns = 4; break;
+		default: std::memcpy(dst, src, GetUniformSize(type)); return;
+	}
+	uint32_t column = columns * sizeof(float);
+	for (uint32_t c = 0; c < columns; c++) {
+		std::memcpy(dst + c * matrixStride, src + c * column, column);
+	}
+}
+
+void Material::SetValue(UniformId id, const char* name, uint32_t type, const void* value, uint32_t size) {
+
+	for (MaterialUniform& uniform : m_Uniforms) {
+		if (uniform.id == id) {
+			// Checked in release too, a larger type would write past the slot.
+			if (uniform.type != type) {
+				throw std::runtime_error("MATL::" + uniform.name + "_TYPE_MISMATCH");
+			}
+			uint8_t* data = m_Values.data() + uniform.offset;
+			if (std::memcmp(data, value, size)) {
+				std::memcpy(data, value, size);
+				uniform.version = ++m_Version;
+			}
+			return;
+		}
+	}
+
+	uint32_t offset = (uint32_t)m_Values.size();
+	m_Values.resize(offset + size);
+	std::memcpy(m_Values.data() + offset, value, size);
+	m_Uniforms.push_back({ id, name, type, offset, ++m_Version });
+	ClearPrograms();
+}
+
 void Material::SetBool(const std::string& name, bool value) {
-	ShaderUniformValue suv;
-	suv.type		 = GL_BOOL;
-	suv.Bool		 = value;
-	m_Uniforms[name] = suv;
+	GLint i = value;
+	SetValue(UniformId(name), name.c_str(), GL_BOOL, &i, sizeof(i));
 }
 
 void Material::SetFloat(const std::string& name, float value) {
-	ShaderUniformValue suv;
-	suv.type		 = GL_FLOAT;
-	suv.Float		 = value;
-	m_Uniforms[name] = suv;
+	SetValue(UniformId(name), name.c_str(), GL_FLOAT, &value, sizeof(value));
 }
 void Material::SetInt(const std::string& name, int value) {
-	ShaderUniformValue suv;
-	suv.type		 = GL_INT;
-	suv.Int			 = value;
-	m_Uniforms[name] = suv;
+	GLint i = value;
+	SetValue(UniformId(name), name.c_str(), GL_INT, &i, sizeof(i));
 }
 
 void Material::SetVector(const std::string& name, const glm::vec2& value) {
-	ShaderUniformValue suv;
-	suv.type		 = GL_FLOAT_VEC2;
-	suv.Vec2		 = value;
-	m_Uniforms[name] = suv;
+	SetValue(UniformId(name), name.c_str(), GL_FLOAT_VEC2, &value, sizeof(value));
 }
 
 void Material::SetVector(const std::string& name, const glm::vec3& value) {
-	ShaderUniformValue suv;
-	suv.type		 = GL_FLOAT_VEC3;
-	suv.Vec3		 = value;
-	m_Uniforms[name] = suv;
+	SetValue(UniformId(name), name.c_str(), GL_FLOAT_VEC3, &value, sizeof(value));
 }
 
 void Material::SetVector(const std::string& name, const glm::vec4& value) {
-	ShaderUniformValue suv;
-	suv.type		 = GL_FLOAT_VEC4;
-	suv.Vec4		 = value;
-	m_Uniforms[name] = suv;
+	SetValue(UniformId(name), name.c_str(), GL_FLOAT_VEC4, &value, sizeof(value));
 }
 
 void Material::SetMatrix(const std::string& name, const glm::mat2& value) {
-	ShaderUniformValue suv;
-	suv.type		 = GL_FLOAT_MAT2;
-	suv.Mat2		 = value;
-	m_Uniforms[name] = suv;
+	SetValue(UniformId(name), name.c_str(), GL_FLOAT_MAT2, &value, sizeof(value));
 }
 
 void Material::SetMatrix(const std::string& name, const glm::mat3& value) {
-	ShaderUniformValue suv;
-	suv.type		 = GL_FLOAT_MAT3;
-	suv.Mat3		 = value;
-	m_Uniforms[name] = suv;
+	SetValue(UniformId(name), name.c_str(), GL_FLOAT_MAT3, &value, sizeof(value));
 }
 
 void Material::SetMatrix(const std::string& name, const glm::mat4& value) {
-	ShaderUniformValue suv;
-	suv.type		 = GL_FLOAT_MAT4;
-	suv.Mat4		 = value;
-	m_Uniforms[name] = suv;
+	SetValue(UniformId(name), name.c_str(), GL_FLOAT_MAT4, &value, sizeof(value));
+}
+
+void Material::Set(const ShaderUniform<bool>& uniform, bool value) {
+	GLint i = value;
+	SetValue(uniform.id, uniform.name, uniform.type, &i, sizeof(i));
 }
 
 void Material::SetTexture(const std::string& name, Texture* value, const uint32_t unit) {
-	ShaderSamplerValue ssv;
-	ssv.type		 = GL_SAMPLER_2D;
-	ssv.unit		 = unit;
-	ssv.Sampler2D	= value;
-	m_Samplers[name] = ssv;
+	SetTexture({ UniformId(name), GL_SAMPLER_2D, name.c_str() }, value, unit);
+}
+
+void Material::SetTexture(const ShaderSampler& sampler, Texture* value, const uint32_t unit) {
+
+	for (MaterialSampler& s : m_Samplers) {
+		if (s.id == sampler.id) {
+			if (s.texture != value || s.unit != unit) {
+				s.texture = value;
+				s.unit	  = unit;
+				s.version = ++m_Version;
+			}
+			return;
+		}
+	}
+	m_Samplers.push_back({ sampler.id, sampler.name, sampler.type, unit, value, ++m_Version });
+	ClearPrograms();
+}
+
+// Resolves locations once per shader, and again after it is reloaded. The only place names are compared.
+Material::Program& Material::GetProgram(Shader* pShader) {
+
+	for (auto it = m_Programs.begin(); it != m_Programs.end(); ++it) {
+		if (it->shader == pShader) {
+			if (it->generation == pShader->GetGeneration()) {
+				return *it;
+			}
+			// Relinked, locations and the block layout may all have moved.
+			if (it->blockBuffer) {
+				GLState::DeleteBuffers(1, &it->blockBuffer);
+			}
+			m_Programs.erase(it);
+			break;
+		}
+	}
+
+	const ShaderUniformBlock* block = pShader->GetUniformBlock(UniformBlocks::GetName(UniformBlocks::MATERIAL));
+
+	auto locate = [&](UniformId id, const std::string& name) {
+		if (const ShaderUniforms* unif = pShader->FindUniform(id)) {
+			return unif->location;
+		}
+#ifndef NDEBUG
+		throw std::out_of_range("UNIF::" + name + "_DOES_NOT_EXIST");
+#endif
+		(void)name;
+		return -1;
+	};
+	auto member = [&](const std::string& name) -> const ShaderBlockMember* {
+		if (block) {
+			for (const ShaderBlockMember& m : block->members) {
+				if (m.name == name) {
+					return &m;
+				}
+			}
+		}
+		return nullptr;
+	};
+
+	Program program = { pShader, pShader->GetGeneration(), {}, {}, 0, {}, {}, 0, 0 };
+	for (uint32_t i = 0; i < m_Uniforms.size(); i++) {
+		if (const ShaderBlockMember* m = member(m_Uniforms[i].name)) {
+			program.blockUniforms.push_back({ m->offset, m->matrixStride, m_Uniforms[i].type, i });
+			continue;
+		}
+		GLint location = locate(m_Uniforms[i].id, m_Uniforms[i].name);
+		if (location >= 0) {
+			program.uniforms.push_back({ location, m_Uniforms[i].type, m_Uniforms[i].offset, i, 0 });
+		}
+	}
+	for (uint32_t i = 0; i < m_Samplers.size(); i++) {
+		GLint location = locate(m_Samplers[i].id, m_Samplers[i].name);
+		if (location >= 0) {
+			program.samplers.push_back({ location, i, 0 });
+		}
+	}
+
+	if (block) {
+		program.block.resize(block->size);
+		glGenBuffers(1, &program.blockBuffer);
+		GLState::BindBuffer(GL_UNIFORM_BUFFER, program.blockBuffer);
+		glBufferData(GL_UNIFORM_BUFFER, block->size, program.block.data(), GL_STATIC_DRAW);
+	}
+
+	m_Programs.push_back(std::move(program));
+	return m_Programs.back();
+}
+
+// Repacks the block members changed since the last upload and rewrites the buffer.
+void Material::UpdateBlock(Program& program) {
+
+	bool changed = false;
+	for (const BlockBinding& b : program.blockUniforms) {
+		const MaterialUniform& uniform = m_Uniforms[b.uniform];
+		if (program.blockVersion && uniform.version <= program.blockVersion) {
+			continue;
+		}
+		PackStd140(program.block.data() + b.offset, m_Values.data() + uniform.offset, b.type, b.matrixStride);
+		changed = true;
+	}
+	program.blockVersion = m_Version;
+
+	if (changed) {
+		GLState::BindBuffer(GL_UNIFORM_BUFFER, program.blockBuffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, program.block.size(), program.block.data());
+		s_Stats.blocks++;
+		s_Stats.bytes += program.block.size();
+	}
+}
+
+void Material::ClearPrograms() {
+
+	for (Program& program : m_Programs) {
+		if (program.blockBuffer) {
+			GLState::DeleteBuffers(1, &program.blockBuffer);
+		}
+	}
+	m_Programs.clear();
+}
+
+Material::~Material() {
+
+	ClearPrograms();
 }
 
 void Material::Attach(Shader* pShader) {
@@ -83,53 +239,88 @@ void Material::Attach(Shader* pShader) {
 	if (!m_Shader) {
 		throw std::runtime_error("MATL::SHDR_NULL");
 	}
+	if (!pShader->IsReady()) {
+		throw std::runtime_error("MATL::SHDR_NOT_READY");
+	}
 #endif
 
 	pShader->Use();
 
-	for (const auto& p : m_Uniforms) {
-		switch (p.second.type) {
-			case GL_BOOL: {
-				pShader->SetBool(p.first, p.second.Bool);
-			}; break;
+	Program&	   program = GetProgram(pShader);
+	const uint8_t* values  = m_Values.data();
+	const bool	   owned   = pShader->GetUniformOwner() == m_Id;
+
+	s_Stats.attaches++;
+
+	// Textures and buffer bindings are context state, not program state, so they are always bound.
+	for (const SamplerBinding& b : program.samplers) {
+		const MaterialSampler& sampler = m_Samplers[b.sampler];
+		sampler.texture->Bind(sampler.unit);
+	}
+	if (program.blockBuffer) {
+		if (program.blockVersion != m_Version) {
+			UpdateBlock(program);
+		}
+		GLState::BindBufferBase(GL_UNIFORM_BUFFER, UniformBlocks::MATERIAL, program.blockBuffer);
+	}
+
+	if (owned && program.version == m_Version) {
+		s_Stats.clean++;
+		return;
+	}
+
+	for (Binding& b : program.uniforms) {
+		uint32_t version = m_Uniforms[b.uniform].version;
+		if (owned && b.uploaded == version) {
+			continue;
+		}
+		b.uploaded = version;
+		s_Stats.uniforms++;
+		s_Stats.bytes += GetUniformSize(b.type);
+
+		const void* value = values + b.offset;
+		switch (b.type) {
+			case GL_BOOL:
 			case GL_INT: {
-				pShader->SetInt(p.first, p.second.Int);
+				glUniform1iv(b.location, 1, (const GLint*)value);
 			}; break;
 			case GL_FLOAT: {
-				pShader->SetFloat(p.first, p.second.Float);
+				glUniform1fv(b.location, 1, (const GLfloat*)value);
 			}; break;
 			case GL_FLOAT_VEC2: {
-				pShader->SetVector(p.first, p.second.Vec2);
+				glUniform2fv(b.location, 1, (const GLfloat*)value);
 			}; break;
 			case GL_FLOAT_VEC3: {
-				pShader->SetVector(p.first, p.second.Vec3);
+				glUniform3fv(b.location, 1, (const GLfloat*)value);
 			}; break;
 			case GL_FLOAT_VEC4: {
-				pShader->SetVector(p.first, p.second.Vec4);
+				glUniform4fv(b.location, 1, (const GLfloat*)value);
 			}; break;
 			case GL_FLOAT_MAT2: {
-				pShader->SetMatrix(p.first, p.second.Mat2);
+				glUniformMatrix2fv(b.location, 1, GL_FALSE, (const GLfloat*)value);
 			}; break;
 			case GL_FLOAT_MAT3: {
-				pShader->SetMatrix(p.first, p.second.Mat3);
+				glUniformMatrix3fv(b.location, 1, GL_FALSE, (const GLfloat*)value);
 			}; break;
 			case GL_FLOAT_MAT4: {
-				pShader->SetMatrix(p.first, p.second.Mat4);
+				glUniformMatrix4fv(b.location, 1, GL_FALSE, (const GLfloat*)value);
 			}; break;
 			default: {
 				throw std::runtime_error("MATL::NO_SUCH_TYPE");
 			}
 		}
 	}
-	for (const auto& p : m_Samplers) {
-		switch (p.second.type) {
-			case GL_SAMPLER_2D: {
-				p.second.Sampler2D->Bind(p.second.unit);
-				pShader->SetInt(p.first, p.second.unit);
-			}; break;
-			default: {
-				throw std::runtime_error("MATL::NO_SUCH_TYPE");
-			}
+	for (SamplerBinding& b : program.samplers) {
+		const MaterialSampler& sampler = m_Samplers[b.sampler];
+		if (owned && b.uploaded == sampler.version) {
+			continue;
 		}
+		b.uploaded = sampler.version;
+		s_Stats.uniforms++;
+		s_Stats.bytes += sizeof(GLint);
+		glUniform1i(b.location, sampler.unit);
 	}
-}
\ No newline at end of file
+
+	pShader->SetUniformOwner(m_Id);
+	program.version = m_Version;
+}
@@ -3,54 +3,139 @@
 #define _MATERIAL_HPP
 
 #include <cstdint>
-#include <map>
 #include <string>
+#include <vector>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <shader/reflection.hpp>
+#include <shader/uniform_id.hpp>
+
 class Shader;
 struct Texture;
 
-struct ShaderUniformValue {
-	uint32_t type;
-	union {
-		bool  Bool;
-		int   Int;
-		float Float;
+/*
+ * Material Uniform struct
+ * A value in the material's uniform blob. Values are found by the id,
+ * the name is only looked at when the material is resolved against a
+ * shader.
+ */
+
+struct MaterialUniform {
+	UniformId	id;
+	std::string name;
+	uint32_t	type;
+	uint32_t	offset;	 // Into the value blob
+	uint32_t	version; // Material version of the last change
+};
+
+struct MaterialSampler {
+	UniformId	id;
+	std::string name;
+	uint32_t	type;
+	uint32_t	unit;
+	Texture*	texture;
+	uint32_t	version;
+};
 
-		glm::vec2 Vec2;
-		glm::vec3 Vec3;
-		glm::vec4 Vec4;
+/*
+ * Material class
+ * Uniform values live in one contiguous blob. The first Attach with a
+ * shader resolves every uniform to its location once, against the
+ * shader's introspection, so attaching is a loop over (location, type,
+ * offset) entries with no string handling.
+ * Uniform values are program state, so each shader remembers which
+ * material last attached to it. Reattaching to a shader the material
+ * still owns only uploads what changed since, and nothing at all when
+ * nothing did. Uniforms set straight on the shader must not overlap
+ * the material's, or the shader's owner has to be reset.
+ * A shader reloaded since gets its bindings resolved again.
+ * Uniforms the shader declares in its MaterialData block are packed
+ * into a uniform buffer the material keeps per shader instead. It is
+ * only rewritten when one of them changes and is bound on every Attach.
+ * Values are best set through the descriptors generated from the shader
+ * sources, see shader/reflection.hpp, which are type checked and hashed
+ * at compile time. The string setters hash the name on every call.
+ */
 
-		glm::mat2 Mat2;
-		glm::mat3 Mat3;
-		glm::mat4 Mat4;
+class Material {
+public:
+	struct Stats {
+		uint32_t attaches;
+		uint32_t clean;	   // Attaches that uploaded no uniforms
+		uint32_t uniforms; // Uniform uploads
+		uint32_t blocks;   // MaterialData buffer uploads
+		size_t	 bytes;	   // Uniform and block data uploaded
 	};
 
-	ShaderUniformValue() {}
-};
+private:
+	struct Binding {
+		int32_t  location;
+		uint32_t type;
+		uint32_t offset;
+		uint32_t uniform;  // Into m_Uniforms
+		uint32_t uploaded; // Version last uploaded to this shader
+	};
 
-struct ShaderSamplerValue {
-	uint32_t type;
-	uint32_t unit;
-	union {
-		Texture* Sampler2D;
+	struct SamplerBinding {
+		int32_t  location;
+		uint32_t sampler; // Into m_Samplers
+		uint32_t uploaded;
 	};
-};
 
-class Material {
+	// A uniform living in the shader's MaterialData block.
+	struct BlockBinding {
+		int32_t  offset; // std140 offset in the block
+		int32_t  matrixStride;
+		uint32_t type;
+		uint32_t uniform; // Into m_Uniforms
+	};
+
+	// Bindings resolved against one shader.
+	struct Program {
+		Shader*						shader;
+		uint32_t					generation; // Of the shader's program when resolved
+		std::vector<Binding>		uniforms;
+		std::vector<SamplerBinding> samplers;
+		uint32_t					version; // Material version fully uploaded
+
+		std::vector<BlockBinding> blockUniforms;
+		std::vector<uint8_t>	  block; // std140 image of MaterialData
+		uint32_t				  blockBuffer;
+		uint32_t				  blockVersion; // Material version in the buffer
+	};
+
+	static uint64_t s_NextId;
+	static Stats	s_Stats;
+
 	Shader* m_Shader;
+	Shader* m_InstancedShader = nullptr; // Same uniforms, transforms from instance attributes
+
+	std::vector<uint8_t>		 m_Values;
+	std::vector<MaterialUniform> m_Uniforms;
+	std::vector<MaterialSampler> m_Samplers;
+
+	// Dropped whenever a uniform or sampler is added.
+	std::vector<Program> m_Programs;
 
-	std::map<std::string, ShaderUniformValue> m_Uniforms;
-	std::map<std::string, ShaderSamplerValue> m_Samplers;
+	const uint64_t m_Id;		  // Owner tag left on shaders, never reused
+	uint32_t	   m_Version = 0; // Bumped on every change
+
+	void SetValue(UniformId id, const char* name, uint32_t type, const void* value, uint32_t size);
+
+	Program& GetProgram(Shader* pShader);
+	void	 UpdateBlock(Program& program);
+	void	 ClearPrograms();
 
 public:
 	void Attach(Shader* pShader = nullptr);
 
 	Shader* GetShader() { return m_Shader; }
 	void	SetShader(Shader* pShader) { m_Shader = pShader; }
+	Shader* GetInstancedShader() { return m_InstancedShader; }
+	void	SetInstancedShader(Shader* pShader) { m_InstancedShader = pShader; }
 
 	void SetBool(const std::string& name, bool value);
 	void SetFloat(const std::string& name, float value);
@@ -63,12 +148,27 @@ public:
 	void SetMatrix(const std::string& name, const glm::mat4& value);
 	void SetTexture(const std::string& name, Texture* value, const uint32_t unit = 0);
 
-	const auto* GetUniforms() { return &m_Uniforms; }
-	const auto* GetSamplers() { return &m_Samplers; }
+	// Typed, by generated descriptor.
+	template <typename T>
+	void Set(const ShaderUniform<T>& uniform, const typename ShaderUniform<T>::Type& value) {
+		SetValue(uniform.id, uniform.name, uniform.type, &value, sizeof(T));
+	}
+	void Set(const ShaderUniform<bool>& uniform, bool value);
+	void SetTexture(const ShaderSampler& sampler, Texture* value, const uint32_t unit = 0);
+
+	const std::vector<MaterialUniform>& GetUniforms() const { return m_Uniforms; }
+	const std::vector<MaterialSampler>& GetSamplers() const { return m_Samplers; }
+
+	// Counters since the last reset, reset once per frame.
+	static const Stats& GetStats() { return s_Stats; }
+	static void			ResetStats() { s_Stats = {}; }
 
 	Material(Shader* pShader) :
-			m_Shader(pShader) {
+			m_Shader(pShader), m_Id(++s_NextId) {
 	}
+	Material(const Material&) = delete;
+	Material& operator=(const Material&) = delete;
+	~Material();
 };
 
 #endif /* _MATERIAL_HPP */
\ No newline at end of file
@@ -0,0 +1,40 @@
+#include "frame_arena.hpp"
+
+#include <algorithm>
+
+void* FrameArena::Grow(size_t size, size_t align) {
+
+	// The skipped tail of the last block counts, so the folded block holds this frame again.
+	if (!m_Blocks.empty()) {
+		m_Bytes += m_Blocks.back().size - m_Used;
+	}
+
+	size_t blockSize = m_Blocks.empty() ? (size_t)MIN_BLOCK_SIZE : m_Blocks.back().size * 2;
+	blockSize		 = std::max(blockSize, size + align);
+	m_Blocks.push_back({ std::unique_ptr<uint8_t[]>(new uint8_t[blockSize]), blockSize });
+	m_Grows++;
+	m_Used = 0;
+	return Allocate(size, align);
+}
+
+void FrameArena::Reset() {
+
+	m_Peak = std::max(m_Peak, m_Bytes);
+
+	if (m_Blocks.size() > 1) {
+		size_t total = 0;
+		for (const Block& block : m_Blocks) {
+			total += block.size;
+		}
+		m_Blocks.clear();
+		m_Blocks.push_back({ std::unique_ptr<uint8_t[]>(new uint8_t[total]), total });
+		m_Grows++;
+	}
+	m_Used	= 0;
+	m_Bytes = 0;
+}
+
+FrameArena::Stats FrameArena::GetStats() const {
+
+	return { (uint32_t)m_Bytes, (uint32_t)std::max(m_Peak, m_Bytes), (uint32_t)m_Blocks.size(), m_Grows };
+}
@@ -0,0 +1,91 @@
+
+#ifndef _FRAME_ARENA_HPP
+#define _FRAME_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/*
+ * Frame Arena class
+ * Linear allocator for data that lives for one frame. Allocating bumps
+ * an offset and nothing is freed on its own, Reset hands everything
+ * back at once. When a frame outgrows the block another one is chained
+ * on, and the next Reset folds them into a single block big enough for
+ * that frame, so once the frames settle the arena stops touching the
+ * heap. Only trivially destructible types, nothing is destroyed.
+ * Not thread safe. Data handed to the render thread goes in the arena
+ * of its FrameState, which is only reset once the frame was drawn.
+ */
+
+class FrameArena {
+public:
+	struct Stats {
+		uint32_t bytes;		// Handed out since Reset, alignment padding included
+		uint32_t peakBytes; // Most handed out in one frame
+		uint32_t blocks;
+		uint32_t grows; // Blocks allocated, over the arena's lifetime
+	};
+
+private:
+	static const size_t MIN_BLOCK_SIZE = 64 * 1024;
+
+	struct Block {
+		std::unique_ptr<uint8_t[]> data;
+		size_t					   size;
+	};
+
+	std::vector<Block> m_Blocks; // Filling the last one
+	size_t			   m_Used  = 0; // In the last block
+	size_t			   m_Bytes = 0;
+	size_t			   m_Peak  = 0;
+	uint32_t		   m_Grows = 0;
+
+	void* Grow(size_t size, size_t align);
+
+public:
+	// Align must be a power of two.
+	void* Allocate(size_t size, size_t align) {
+		if (!m_Blocks.empty()) {
+			const Block& block	 = m_Blocks.back();
+			uintptr_t	 base	 = (uintptr_t)block.data.get();
+			uintptr_t	 aligned = (base + m_Used + align - 1) & ~(uintptr_t)(align - 1);
+			if (aligned + size <= base + block.size) {
+				m_Bytes += aligned + size - (base + m_Used);
+				m_Used = aligned + size - base;
+				return (void*)aligned;
+			}
+		}
+		return Grow(size, align);
+	}
+
+	// Uninitialized.
+	template <typename T>
+	T* Allocate(size_t count) {
+		static_assert(std::is_trivially_destructible<T>::value, "FrameArena does not run destructors");
+		return (T*)Allocate(sizeof(T) * count, alignof(T));
+	}
+
+	template <typename T>
+	T* Copy(const T* data, size_t count) {
+		T* copy = Allocate<T>(count);
+		if (count) {
+			std::memcpy(copy, data, sizeof(T) * count);
+		}
+		return copy;
+	}
+
+	// Everything allocated since the last Reset is invalid afterwards.
+	void Reset();
+
+	Stats GetStats() const;
+
+	FrameArena() {}
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+};
+
+#endif /* _FRAME_ARENA_HPP */
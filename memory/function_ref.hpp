@@ -0,0 +1,39 @@
+
+#ifndef _FUNCTION_REF_HPP
+#define _FUNCTION_REF_HPP
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+/*
+ * Function Ref class
+ * Refers to a callable rather than copying it, so no captures are ever
+ * heap allocated, whatever their size. For callbacks only called before
+ * the function taking them returns; never store one. Empty when default
+ * constructed or made from nullptr.
+ */
+
+template <typename Signature>
+class FunctionRef;
+
+template <typename R, typename... Args>
+class FunctionRef<R(Args...)> {
+	const void* m_Func = nullptr;
+	R (*m_Call)(const void* func, Args... args) = nullptr;
+
+public:
+	FunctionRef() {}
+	FunctionRef(std::nullptr_t) {}
+
+	template <typename Func, typename = typename std::enable_if<!std::is_same<typename std::decay<Func>::type, FunctionRef>::value>::type>
+	FunctionRef(const Func& func) :
+		m_Func(&func),
+		m_Call([](const void* f, Args... args) -> R { return (*(const Func*)f)(std::forward<Args>(args)...); }) {}
+
+	R operator()(Args... args) const { return m_Call(m_Func, std::forward<Args>(args)...); }
+
+	explicit operator bool() const { return m_Call != nullptr; }
+};
+
+#endif /* _FUNCTION_REF_HPP */
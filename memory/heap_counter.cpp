@@ -0,0 +1,99 @@
+#include "heap_counter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<uint64_t> s_Allocations{ 0 };
+static std::atomic<uint64_t> s_Frees{ 0 };
+static std::atomic<uint64_t> s_Bytes{ 0 };
+
+HeapCounter::Stats HeapCounter::GetStats() {
+
+	return { s_Allocations.load(std::memory_order_relaxed), s_Frees.load(std::memory_order_relaxed), s_Bytes.load(std::memory_order_relaxed) };
+}
+
+void HeapCounter::ResetStats() {
+
+	s_Allocations.store(0, std::memory_order_relaxed);
+	s_Frees.store(0, std::memory_order_relaxed);
+	s_Bytes.store(0, std::memory_order_relaxed);
+}
+
+#ifndef NDEBUG
+
+// The replacements every new and delete in the program resolves to. The array, nothrow
+// and sized forms all funnel into these two.
+static void* CountedAllocate(std::size_t size) {
+
+	void* ptr = std::malloc(size ? size : 1);
+	if (ptr) {
+		s_Allocations.fetch_add(1, std::memory_order_relaxed);
+		s_Bytes.fetch_add(size, std::memory_order_relaxed);
+	}
+	return ptr;
+}
+
+static void CountedFree(void* ptr) {
+
+	if (ptr) {
+		s_Frees.fetch_add(1, std::memory_order_relaxed);
+		std::free(ptr);
+	}
+}
+
+void* operator new(std::size_t size) {
+
+	void* ptr = CountedAllocate(size);
+	if (!ptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void* operator new[](std::size_t size) {
+
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+
+	return CountedAllocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+
+	return CountedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+
+	CountedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+
+	CountedFree(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+
+	CountedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+
+	CountedFree(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+
+	CountedFree(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+
+	CountedFree(ptr);
+}
+
+#endif
@@ -0,0 +1,27 @@
+
+#ifndef _HEAP_COUNTER_HPP
+#define _HEAP_COUNTER_HPP
+
+#include <cstdint>
+
+/*
+ * Heap Counter class
+ * Counts the calls to the global operator new and delete, on every
+ * thread, for checking that a frame does not allocate once it settled.
+ * Debug builds only replace the global operators, in release the
+ * counters stay zero.
+ */
+
+class HeapCounter {
+public:
+	struct Stats {
+		uint64_t allocations;
+		uint64_t frees;
+		uint64_t bytes; // Requested by the allocations
+	};
+
+	static Stats GetStats();
+	static void	 ResetStats();
+};
+
+#endif /* _HEAP_COUNTER_HPP */
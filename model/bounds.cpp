@@ -0,0 +1,237 @@
+#include "bounds.hpp"
+
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+Bounds Bounds::Transform(const glm::mat4& matrix) const {
+
+	// Arvo: project the box extents onto each axis of the matrix.
+	glm::vec3 c = glm::vec3(matrix * glm::vec4(center, 1.0f));
+	glm::vec3 e = (max - min) * 0.5f;
+	glm::vec3 o = glm::vec3(glm::abs(matrix[0]) * e.x + glm::abs(matrix[1]) * e.y + glm::abs(matrix[2]) * e.z);
+
+	float scale = glm::max(glm::length(glm::vec3(matrix[0])), glm::max(glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2]))));
+
+	return { c - o, c + o, c, radius * scale };
+}
+
+Bounds ComputeBoundsScalar(const glm::vec3* positions, size_t count) {
+
+	if (!count) {
+		return { glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f), 0.0f };
+	}
+
+	glm::vec3 lo = positions[0];
+	glm::vec3 hi = positions[0];
+	for (size_t i = 1; i < count; i++) {
+		lo = glm::min(lo, positions[i]);
+		hi = glm::max(hi, positions[i]);
+	}
+
+	glm::vec3 center = (lo + hi) * 0.5f;
+	float	 r2	 = 0.0f;
+	for (size_t i = 0; i < count; i++) {
+		glm::vec3 d = positions[i] - center;
+		r2			= glm::max(r2, glm::dot(d, d));
+	}
+
+	return { lo, hi, center, std::sqrt(r2) };
+}
+
+#if defined(__SSE2__)
+
+// Transposes 4 packed vec3 (12 floats) into x, y and z registers.
+static inline void LoadSoA4(const float* p, __m128& x, __m128& y, __m128& z) {
+
+	__m128 a = _mm_loadu_ps(p);	// x0 y0 z0 x1
+	__m128 b = _mm_loadu_ps(p + 4); // y1 z1 x2 y2
+	__m128 c = _mm_loadu_ps(p + 8); // z2 x3 y3 z3
+
+	x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+	y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+	z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+static inline float HorizontalMin(__m128 v) {
+	v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+	v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtss_f32(v);
+}
+
+static inline float HorizontalMax(__m128 v) {
+	v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+	v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtss_f32(v);
+}
+
+#if defined(__AVX__)
+static inline void LoadSoA8(const float* p, __m256& x, __m256& y, __m256& z) {
+	__m128 x0, y0, z0, x1, y1, z1;
+	LoadSoA4(p, x0, y0, z0);
+	LoadSoA4(p + 12, x1, y1, z1);
+	x = _mm256_insertf128_ps(_mm256_castps128_ps256(x0), x1, 1);
+	y = _mm256_insertf128_ps(_mm256_castps128_ps256(y0), y1, 1);
+	z = _mm256_insertf128_ps(_mm256_castps128_ps256(z0), z1, 1);
+}
+#endif
+
+Bounds ComputeBounds(const glm::vec3* positions, size_t count) {
+
+	if (count < 4) {
+		return ComputeBoundsScalar(positions, count);
+	}
+
+	const float* p = &positions[0].x;
+	size_t		 i = 0;
+
+	__m128 minX = _mm_set1_ps(FLT_MAX), minY = minX, minZ = minX;
+	__m128 maxX = _mm_set1_ps(-FLT_MAX), maxY = maxX, maxZ = maxX;
+
+#if defined(__AVX__)
+	__m256 minX8 = _mm256_set1_ps(FLT_MAX), minY8 = minX8, minZ8 = minX8;
+	__m256 maxX8 = _mm256_set1_ps(-FLT_MAX), maxY8 = maxX8, maxZ8 = maxX8;
+	for (; i + 8 <= count; i += 8) {
+		__m256 x, y, z;
+		LoadSoA8(p + i * 3, x, y, z);
+		minX8 = _mm256_min_ps(minX8, x);
+		minY8 = _mm256_min_ps(minY8, y);
+		minZ8 = _mm256_min_ps(minZ8, z);
+		maxX8 = _mm256_max_ps(maxX8, x);
+		maxY8 = _mm256_max_ps(maxY8, y);
+		maxZ8 = _mm256_max_ps(maxZ8, z);
+	}
+	minX = _mm_min_ps(_mm256_castps256_ps128(minX8), _mm256_extractf128_ps(minX8, 1));
+	minY = _mm_min_ps(_mm256_castps256_ps128(minY8), _mm256_extractf128_ps(minY8, 1));
+	minZ = _mm_min_ps(_mm256_castps256_ps128(minZ8), _mm256_extractf128_ps(minZ8, 1));
+	maxX = _mm_max_ps(_mm256_castps256_ps128(maxX8), _mm256_extractf128_ps(maxX8, 1));
+	maxY = _mm_max_ps(_mm256_castps256_ps128(maxY8), _mm256_extractf128_ps(maxY8, 1));
+	maxZ = _mm_max_ps(_mm256_castps256_ps128(maxZ8), _mm256_extractf128_ps(maxZ8, 1));
+#endif
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 x, y, z;
+		LoadSoA4(p + i * 3, x, y, z);
+		minX = _mm_min_ps(minX, x);
+		minY = _mm_min_ps(minY, y);
+		minZ = _mm_min_ps(minZ, z);
+		maxX = _mm_max_ps(maxX, x);
+		maxY = _mm_max_ps(maxY, y);
+		maxZ = _mm_max_ps(maxZ, z);
+	}
+
+	glm::vec3 lo(HorizontalMin(minX), HorizontalMin(minY), HorizontalMin(minZ));
+	glm::vec3 hi(HorizontalMax(maxX), HorizontalMax(maxY), HorizontalMax(maxZ));
+	for (size_t t = i; t < count; t++) {
+		lo = glm::min(lo, positions[t]);
+		hi = glm::max(hi, positions[t]);
+	}
+
+	// Second pass for the sphere radius around the box center.
+	glm::vec3 center = (lo + hi) * 0.5f;
+	__m128	cx	 = _mm_set1_ps(center.x);
+	__m128	cy	 = _mm_set1_ps(center.y);
+	__m128	cz	 = _mm_set1_ps(center.z);
+	__m128	r2	 = _mm_setzero_ps();
+
+	for (i = 0; i + 4 <= count; i += 4) {
+		__m128 x, y, z;
+		LoadSoA4(p + i * 3, x, y, z);
+		x  = _mm_sub_ps(x, cx);
+		y  = _mm_sub_ps(y, cy);
+		z  = _mm_sub_ps(z, cz);
+		r2 = _mm_max_ps(r2, _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+	}
+
+	float radius2 = HorizontalMax(r2);
+	for (; i < count; i++) {
+		glm::vec3 d = positions[i] - center;
+		radius2		= glm::max(radius2, glm::dot(d, d));
+	}
+
+	return { lo, hi, center, std::sqrt(radius2) };
+}
+
+#else
+
+Bounds ComputeBounds(const glm::vec3* positions, size_t count) {
+	return ComputeBoundsScalar(positions, count);
+}
+
+#endif
+
+Bounds ComputeBounds(const glm::vec3* positions, const uint32_t* indices, size_t count) {
+
+	// Gather the referenced vertices so the reduction runs over packed data.
+	std::vector<glm::vec3> gathered(count);
+	for (size_t i = 0; i < count; i++) {
+		gathered[i] = positions[indices[i]];
+	}
+	return ComputeBounds(gathered.data(), gathered.size());
+}
+
+// ----------------------------
+
+uint32_t BoundsTable::Add(const Bounds& bounds) {
+
+	uint32_t index = m_Count++;
+	if (index >= m_MinX.size()) {
+		// Pad with empty boxes that fail every containment test.
+		size_t size = m_MinX.size() + WIDTH;
+		m_MinX.resize(size, FLT_MAX);
+		m_MinY.resize(size, FLT_MAX);
+		m_MinZ.resize(size, FLT_MAX);
+		m_MaxX.resize(size, -FLT_MAX);
+		m_MaxY.resize(size, -FLT_MAX);
+		m_MaxZ.resize(size, -FLT_MAX);
+		m_CenterX.resize(size, 0.0f);
+		m_CenterY.resize(size, 0.0f);
+		m_CenterZ.resize(size, 0.0f);
+		m_Radius.resize(size, -1.0f);
+	}
+
+	Set(index, bounds);
+	return index;
+}
+
+void BoundsTable::Set(uint32_t index, const Bounds& bounds) {
+
+	m_MinX[index]	= bounds.min.x;
+	m_MinY[index]	= bounds.min.y;
+	m_MinZ[index]	= bounds.min.z;
+	m_MaxX[index]	= bounds.max.x;
+	m_MaxY[index]	= bounds.max.y;
+	m_MaxZ[index]	= bounds.max.z;
+	m_CenterX[index] = bounds.center.x;
+	m_CenterY[index] = bounds.center.y;
+	m_CenterZ[index] = bounds.center.z;
+	m_Radius[index]  = bounds.radius;
+}
+
+Bounds BoundsTable::Get(uint32_t index) const {
+
+	return {
+		glm::vec3(m_MinX[index], m_MinY[index], m_MinZ[index]),
+		glm::vec3(m_MaxX[index], m_MaxY[index], m_MaxZ[index]),
+		glm::vec3(m_CenterX[index], m_CenterY[index], m_CenterZ[index]),
+		m_Radius[index]
+	};
+}
+
+void BoundsTable::Clear() {
+
+	m_MinX.clear();
+	m_MinY.clear();
+	m_MinZ.clear();
+	m_MaxX.clear();
+	m_MaxY.clear();
+	m_MaxZ.clear();
+	m_CenterX.clear();
+	m_CenterY.clear();
+	m_CenterZ.clear();
+	m_Radius.clear();
+	m_Count = 0;
+}
@@ -0,0 +1,74 @@
+
+#ifndef _BOUNDS_HPP
+#define _BOUNDS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+/*
+ * Bounds struct
+ * Axis aligned box and bounding sphere of a set of positions.
+ * The sphere is centered on the box and encloses every position.
+ */
+
+struct Bounds {
+	glm::vec3 min;
+	glm::vec3 max;
+	glm::vec3 center;
+	float	 radius;
+
+	// Bounds of the box transformed by an affine matrix.
+	Bounds Transform(const glm::mat4& matrix) const;
+};
+
+// SIMD (SSE, AVX when compiled in) min/max reduction over positions.
+Bounds ComputeBounds(const glm::vec3* positions, size_t count);
+// Bounds of only the vertices referenced by an index range.
+Bounds ComputeBounds(const glm::vec3* positions, const uint32_t* indices, size_t count);
+// Reference implementation with plain glm.
+Bounds ComputeBoundsScalar(const glm::vec3* positions, size_t count);
+
+/*
+ * Bounds Table class
+ * Structure of arrays storage of bounds so culling can stream
+ * through one component of many boxes at a time.
+ * Arrays are padded to a multiple of WIDTH with empty boxes so
+ * SIMD loops never need a scalar tail.
+ */
+
+class BoundsTable {
+public:
+	static const uint32_t WIDTH = 8;
+
+private:
+	std::vector<float> m_MinX, m_MinY, m_MinZ;
+	std::vector<float> m_MaxX, m_MaxY, m_MaxZ;
+	std::vector<float> m_CenterX, m_CenterY, m_CenterZ, m_Radius;
+	uint32_t		   m_Count = 0;
+
+public:
+	uint32_t Add(const Bounds& bounds);
+	void	 Set(uint32_t index, const Bounds& bounds);
+	Bounds   Get(uint32_t index) const;
+	void	 Clear();
+
+	uint32_t GetCount() const { return m_Count; }
+	// Count rounded up to WIDTH, the length of every array.
+	uint32_t GetPaddedCount() const { return (uint32_t)m_MinX.size(); }
+
+	const float* MinX() const { return m_MinX.data(); }
+	const float* MinY() const { return m_MinY.data(); }
+	const float* MinZ() const { return m_MinZ.data(); }
+	const float* MaxX() const { return m_MaxX.data(); }
+	const float* MaxY() const { return m_MaxY.data(); }
+	const float* MaxZ() const { return m_MaxZ.data(); }
+	const float* CenterX() const { return m_CenterX.data(); }
+	const float* CenterY() const { return m_CenterY.data(); }
+	const float* CenterZ() const { return m_CenterZ.data(); }
+	const float* Radius() const { return m_Radius.data(); }
+};
+
+#endif /* _BOUNDS_HPP */
@@ -1,6 +1,12 @@
-
 #include "mesh.hpp"
 #include <glad/glad.h>
+#include <glstate/glstate.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <utility>
 
 float tetHedData[] = {
 	0.5f, -0.25f, 0.0f,
@@ -9,52 +15,257 @@ float tetHedData[] = {
 	0.0f, 0.5f, 0.0f
 };
 
-int indices[] = {
+uint32_t indices[] = {
 	0, 1, 2,
 	0, 1, 3,
 	1, 2, 3,
 	2, 0, 3
 };
 
-Mesh* MeshLoader::Load(const std::string& name) {
+// Converts a float into the component format of an attribute.
+static void WriteComponent(uint8_t* dst, GLenum type, GLboolean normalized, float value) {
+	switch (type) {
+		case GL_FLOAT: {
+			std::memcpy(dst, &value, sizeof(float));
+		}; break;
+		case GL_SHORT: {
+			int16_t v = (int16_t)(normalized ? std::round(glm::clamp(value, -1.0f, 1.0f) * 32767.0f) : value);
+			std::memcpy(dst, &v, sizeof(int16_t));
+		}; break;
+		case GL_UNSIGNED_SHORT: {
+			uint16_t v = (uint16_t)(normalized ? std::round(glm::clamp(value, 0.0f, 1.0f) * 65535.0f) : value);
+			std::memcpy(dst, &v, sizeof(uint16_t));
+		}; break;
+		case GL_BYTE: {
+			int8_t v = (int8_t)(normalized ? std::round(glm::clamp(value, -1.0f, 1.0f) * 127.0f) : value);
+			std::memcpy(dst, &v, sizeof(int8_t));
+		}; break;
+		case GL_UNSIGNED_BYTE: {
+			uint8_t v = (uint8_t)(normalized ? std::round(glm::clamp(value, 0.0f, 1.0f) * 255.0f) : value);
+			std::memcpy(dst, &v, sizeof(uint8_t));
+		}; break;
+		default: {
+			throw std::runtime_error("MESH::NO_SUCH_TYPE");
+		}
+	}
+}
 
-	uint32_t VAO;
-	uint32_t VBO;
-	uint32_t EBO;
-	glGenBuffers(1, &VBO);
-	glGenBuffers(1, &EBO);
-	glGenVertexArrays(1, &VAO);
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(tetHedData), tetHedData, GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, (void*)0);
-	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+// Returns the source component of a vertex for the attribute location.
+static float ReadComponent(const MeshData& data, GLuint location, uint32_t vertex, int component) {
+	switch (location) {
+		case VertexLayout::POSITION: return data.positions[vertex][component];
+		case VertexLayout::NORMAL: return vertex < data.normals.size() ? data.normals[vertex][component] : 0.0f;
+		case VertexLayout::TEXCOORD: return vertex < data.texCoords.size() && component < 2 ? data.texCoords[vertex][component] : 0.0f;
+		default: return 0.0f;
+	}
+}
+
+Mesh* MeshLoader::Load(const std::string& name, bool keepData) {
+
+	MeshData data;
+	for (int i = 0; i < 4; i++) {
+		data.positions.push_back(glm::vec3(tetHedData[3 * i], tetHedData[3 * i + 1], tetHedData[3 * i + 2]));
+	}
+	data.indices.assign(std::begin(indices), std::end(indices));
 
-	return m_Meshes[name] = new Mesh{ GL_TRIANGLES, VBO, EBO, VAO, sizeof(tetHedData) };
+	return Load(name, data, VertexLayout::Split(), keepData);
 }
 
-void MeshLoader::Delete(Mesh* pMesh) {
+void MeshLoader::Pack(const MeshData& data, const VertexLayout& layout, Packed& packed) {
 
-	glDeleteBuffers(1, &pMesh->m_VBO);
-	glDeleteBuffers(1, &pMesh->m_EBO);
-	glDeleteVertexArrays(1, &pMesh->m_VAO);
+	const uint32_t vertexCount = (uint32_t)data.positions.size();
+	packed.vertexCount		   = vertexCount;
+	packed.bounds			   = ComputeBounds(data.positions.data(), vertexCount);
 
-	delete pMesh;
+	packed.subMeshes.clear();
+	for (const MeshData::SubMeshRange& range : data.subMeshes) {
+		Bounds subBounds = ComputeBounds(data.positions.data(), data.indices.data() + range.firstIndex, range.count);
+		packed.subMeshes.push_back({ range.firstIndex, (int32_t)range.count, subBounds, 0 });
+	}
+	packed.whole = packed.subMeshes.empty();
+	if (packed.whole) {
+		packed.subMeshes.push_back({ 0, (int32_t)data.indices.size(), packed.bounds, 0 });
+	}
+
+	// Pack each stream of the layout.
+	std::vector<uint8_t>* streams = packed.streams;
+	for (uint32_t s = 0; s < layout.GetStreamCount(); s++) {
+		streams[s].resize((size_t)layout.GetStride(s) * vertexCount);
+	}
+
+	for (const VertexAttribute& attr : layout.GetAttributes()) {
+		const GLsizei stride   = layout.GetStride(attr.stream);
+		const GLuint  compSize = VertexLayout::GetTypeSize(attr.type);
+
+		for (uint32_t v = 0; v < vertexCount; v++) {
+			uint8_t* dst = streams[attr.stream].data() + (size_t)v * stride + attr.offset;
+			for (int c = 0; c < attr.components; c++) {
+				float value = ReadComponent(data, attr.location, v, c);
+				WriteComponent(dst + c * compSize, attr.type, attr.normalized, value);
+			}
+		}
+	}
 }
 
-MeshLoader::MeshLoader() {}
+Mesh* MeshLoader::Create(const std::string& name, Packed& packed, const VertexLayout& layout, const VertexArrayCache::Allocation& alloc, uint32_t indexCount) {
 
-MeshLoader::~MeshLoader() {
+	uint32_t boundsIndex = m_Bounds.Add(packed.bounds);
+	for (SubMesh& sub : packed.subMeshes) {
+		sub.boundsIndex = packed.whole ? boundsIndex : m_Bounds.Add(sub.bounds);
+	}
+
+	Handle handle = m_Names[name] = m_Meshes.Create(
+		(uint32_t)GL_TRIANGLES,
+		alloc.vao, alloc.positionVao,
+		(int32_t)indexCount,
+		alloc.firstIndex, alloc.baseVertex,
+		layout.GetHash(),
+		packed.bounds, boundsIndex,
+		std::move(packed.subMeshes));
+	return m_Meshes.Get(handle);
+}
+
+Mesh* MeshLoader::Load(const std::string& name, const MeshData& data, const VertexLayout& layout, bool keepData) {
 
-	for (auto& p : m_Meshes) {
-		Delete(p.second);
+#ifndef NDEBUG
+	if (m_Names.count(name)) {
+		throw std::runtime_error("MESH_LOAD::" + name + "_NOT_UNIQUE");
 	}
+#endif
+
+	Packed packed;
+	Pack(data, layout, packed);
+
+	if (keepData) {
+		m_Data[name] = data;
+	}
+
+	VertexArrayCache::Allocation alloc = m_VertexArrays.Append(layout, packed.streams, packed.vertexCount, data.indices.data(), (uint32_t)data.indices.size());
+	return Create(name, packed, layout, alloc, (uint32_t)data.indices.size());
 }
 
+// Vertex arrays are not shared between contexts, so the upload fills staging buffers
+// and the completion copies them into the layout's buffers on the GPU.
+void MeshLoader::LoadAsync(const std::string& name, const MeshData& data, const VertexLayout& layout, UploadThread& uploads, bool keepData) {
+
+	if (!uploads.IsRunning()) {
+		Load(name, data, layout, keepData);
+		return;
+	}
+
+#ifndef NDEBUG
+	if (m_Names.count(name)) {
+		throw std::runtime_error("MESH_LOAD::" + name + "_NOT_UNIQUE");
+	}
+#endif
+
+	struct Staging {
+		MeshData data;
+		Packed	 packed;
+		GLuint	 streams[VertexLayout::MAX_STREAMS];
+		GLuint	 indices;
+	};
+	std::shared_ptr<Staging> staging = std::make_shared<Staging>();
+	staging->data					 = data;
+	m_Loading++;
+
+	uploads.Submit(
+		[staging, layout]() {
+			Pack(staging->data, layout, staging->packed);
+
+			const uint32_t streamCount = layout.GetStreamCount();
+			glGenBuffers(streamCount, staging->streams);
+			glGenBuffers(1, &staging->indices);
+			for (uint32_t s = 0; s < streamCount; s++) {
+				const std::vector<uint8_t>& stream = staging->packed.streams[s];
+				GLState::BindBuffer(GL_COPY_WRITE_BUFFER, staging->streams[s]);
+				glBufferData(GL_COPY_WRITE_BUFFER, stream.size(), stream.data(), GL_STATIC_COPY);
+			}
+			GLState::BindBuffer(GL_COPY_WRITE_BUFFER, staging->indices);
+			glBufferData(GL_COPY_WRITE_BUFFER, staging->data.indices.size() * sizeof(uint32_t), staging->data.indices.data(), GL_STATIC_COPY);
+		},
+		[this, staging, name, layout, keepData]() {
+			const uint32_t indexCount = (uint32_t)staging->data.indices.size();
+
+			VertexArrayCache::Allocation alloc = m_VertexArrays.AppendCopy(layout, staging->streams, staging->packed.vertexCount, staging->indices, indexCount);
+			GLState::DeleteBuffers(layout.GetStreamCount(), staging->streams);
+			GLState::DeleteBuffers(1, &staging->indices);
+
+			Create(name, staging->packed, layout, alloc, indexCount);
+			if (keepData) {
+				m_Data[name] = std::move(staging->data);
+			}
+			m_Loading--;
+		});
+}
+
+void Mesh::Draw(bool positionOnly) const {
+
+	GLState::BindVertexArray(positionOnly ? m_PositionVAO : m_VAO);
+	glDrawElementsBaseVertex(m_Mode, m_Count, GL_UNSIGNED_INT, (void*)(uintptr_t)(m_FirstIndex * sizeof(uint32_t)), m_BaseVertex);
+}
+
+void Mesh::DrawSubMesh(uint32_t index, bool positionOnly) const {
+
+	const SubMesh& sub = m_SubMeshes[index];
+	GLState::BindVertexArray(positionOnly ? m_PositionVAO : m_VAO);
+	glDrawElementsBaseVertex(m_Mode, sub.count, GL_UNSIGNED_INT, (void*)(uintptr_t)((m_FirstIndex + sub.firstIndex) * sizeof(uint32_t)), m_BaseVertex);
+}
+
+void Mesh::DrawInstanced(GLsizei instances, bool positionOnly) const {
+
+	GLState::BindVertexArray(positionOnly ? m_PositionVAO : m_VAO);
+	glDrawElementsInstancedBaseVertex(m_Mode, m_Count, GL_UNSIGNED_INT, (void*)(uintptr_t)(m_FirstIndex * sizeof(uint32_t)), instances, m_BaseVertex);
+}
+
+void Mesh::DrawSubMeshInstanced(uint32_t index, GLsizei instances, bool positionOnly) const {
+
+	const SubMesh& sub = m_SubMeshes[index];
+	GLState::BindVertexArray(positionOnly ? m_PositionVAO : m_VAO);
+	glDrawElementsInstancedBaseVertex(m_Mode, sub.count, GL_UNSIGNED_INT, (void*)(uintptr_t)((m_FirstIndex + sub.firstIndex) * sizeof(uint32_t)), instances, m_BaseVertex);
+}
+
+void Mesh::DrawRange(uint32_t firstIndex, GLsizei count, GLsizei instances) const {
+
+	GLState::BindVertexArray(m_VAO);
+	void* offset = (void*)(uintptr_t)((m_FirstIndex + firstIndex) * sizeof(uint32_t));
+	if (instances) {
+		glDrawElementsInstancedBaseVertex(m_Mode, count, GL_UNSIGNED_INT, offset, instances, m_BaseVertex);
+	} else {
+		glDrawElementsBaseVertex(m_Mode, count, GL_UNSIGNED_INT, offset, m_BaseVertex);
+	}
+}
+
+MeshLoader::MeshLoader() {}
+
+// Geometry stays in the shared layout buffers until the loader is destroyed.
+MeshLoader::~MeshLoader() {}
+
 void MeshLoader::Unload(const std::string& name) {
 
-	Delete(m_Meshes[name]);
-	m_Meshes.erase(name);
+	auto it = m_Names.find(name);
+	if (it == m_Names.end()) {
+		return;
+	}
+	m_Meshes.Release(it->second);
+	m_Names.erase(it);
+	m_Data.erase(name);
+}
+
+Mesh* MeshLoader::Get(const std::string& name) const {
+
+	auto it = m_Names.find(name);
+	return it != m_Names.end() ? m_Meshes.Get(it->second) : nullptr;
+}
+
+MeshLoader::Handle MeshLoader::Find(const std::string& name) const {
+
+	auto it = m_Names.find(name);
+	return it != m_Names.end() ? it->second : Handle();
+}
+
+const MeshData* MeshLoader::GetData(const std::string& name) const {
+
+	auto it = m_Data.find(name);
+	return it != m_Data.end() ? &it->second : nullptr;
 }
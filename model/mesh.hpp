@@ -5,28 +5,120 @@
 #include <cstdint>
 #include <map>
 #include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <model/bounds.hpp>
+#include <model/vertex_layout.hpp>
+#include <resource/resource_pool.hpp>
+#include <upload/upload_thread.hpp>
+
+/*
+ * Mesh Data struct
+ * CPU side geometry handed to the MeshLoader. Missing attributes
+ * are zero filled when packed into the layout.
+ */
+
+struct MeshData {
+	struct SubMeshRange {
+		uint32_t firstIndex;
+		uint32_t count;
+	};
+
+	std::vector<glm::vec3>	positions;
+	std::vector<glm::vec3>	normals;
+	std::vector<glm::vec2>	texCoords;
+	std::vector<uint32_t>	 indices;
+	std::vector<SubMeshRange> subMeshes; // Whole index range when empty
+};
+
+/*
+ * Sub Mesh struct
+ * Index range of a mesh drawn with its own material, and its bounds.
+ */
+
+struct SubMesh {
+	uint32_t firstIndex; // Relative to the mesh
+	int32_t  count;
+	Bounds   bounds;
+	uint32_t boundsIndex; // Entry in the loader bounds table
+};
 
 struct Mesh {
 
 	const uint32_t m_Mode;
-	const uint32_t m_VBO;
-	const uint32_t m_EBO;
-	const uint32_t m_VAO;
-	const int32_t  m_Count; // Number of indices
+	const uint32_t m_VAO;		  // All streams of the layout
+	const uint32_t m_PositionVAO; // Position stream only, for depth and shadow passes
+	const int32_t  m_Count;		  // Number of indices
+	const uint32_t m_FirstIndex;
+	const int32_t  m_BaseVertex;
+	const uint64_t m_Layout; // Hash of the vertex layout
+
+	// Bounds in model space, computed on load.
+	const Bounds			   m_Bounds;
+	const uint32_t			   m_BoundsIndex;
+	const std::vector<SubMesh> m_SubMeshes;
+
+	void Draw(bool positionOnly = false) const;
+	void DrawSubMesh(uint32_t index, bool positionOnly = false) const;
+
+	// Instance attributes must already point at the first instance on the VAO.
+	void DrawInstanced(GLsizei instances, bool positionOnly = false) const;
+	void DrawSubMeshInstanced(uint32_t index, GLsizei instances, bool positionOnly = false) const;
+
+	// Any index range, firstIndex relative to the mesh. Instanced when instances is not 0.
+	void DrawRange(uint32_t firstIndex, GLsizei count, GLsizei instances = 0) const;
 };
 
 class MeshLoader {
+public:
+	typedef ResourcePool<Mesh>::Handle Handle;
+
+private:
+	// Everything a mesh derives from its data without touching GL.
+	struct Packed {
+		Bounds				 bounds;
+		std::vector<SubMesh> subMeshes; // Bounds indices are handed out on Create
+		bool				 whole;		// Single submesh covering the mesh, sharing its bounds
+		std::vector<uint8_t> streams[VertexLayout::MAX_STREAMS];
+		uint32_t			 vertexCount;
+	};
 
-	std::map<std::string, Mesh*> m_Meshes;
+	ResourcePool<Mesh>						m_Meshes;
+	std::unordered_map<std::string, Handle> m_Names;
+	std::map<std::string, MeshData>			m_Data; // CPU copies kept on request
+	VertexArrayCache						m_VertexArrays;
+	BoundsTable								m_Bounds;
+	uint32_t								m_Loading = 0; // Uploads not finished
 
-	void Delete(Mesh* pMesh);
+	static void Pack(const MeshData& data, const VertexLayout& layout, Packed& packed);
+
+	Mesh* Create(const std::string& name, Packed& packed, const VertexLayout& layout, const VertexArrayCache::Allocation& alloc, uint32_t indexCount);
 
 public:
-	Mesh* Load(const std::string& name);
+	// keepData retains the CPU geometry for occluders and scene queries.
+	Mesh* Load(const std::string& name, bool keepData = false);
+	Mesh* Load(const std::string& name, const MeshData& data, const VertexLayout& layout, bool keepData = false);
+	// Packs and uploads on the upload thread, the mesh shows up in Get once its upload finished,
+	// see UploadThread::Update. Loads right away when the upload thread is not running.
+	void  LoadAsync(const std::string& name, const MeshData& data, const VertexLayout& layout, UploadThread& uploads, bool keepData = false);
 	void  Unload(const std::string& name);
 
+	// Null while still uploading.
+	Mesh*	 Get(const std::string& name) const;
+	// Handles go stale on Unload, Get then returns null instead of a deleted mesh.
+	Handle	 Find(const std::string& name) const;
+	Mesh*	 Get(Handle handle) const { return m_Meshes.Get(handle); }
+	uint32_t GetLoadingCount() const { return m_Loading; }
+
+	const MeshData* GetData(const std::string& name) const;
+
+	// Bounds of every loaded mesh and submesh, indexed by their boundsIndex.
+	const BoundsTable& GetBoundsTable() const { return m_Bounds; }
+
 	MeshLoader();
 	~MeshLoader();
 };
 
-#endif /* _MESH_HPP */
\ No newline at end of file
+#endif /* _MESH_HPP */
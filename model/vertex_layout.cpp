@@ -0,0 +1,269 @@
+#include "vertex_layout.hpp"
+#include <glstate/glstate.hpp>
+#include <stdexcept>
+
+GLuint VertexLayout::GetTypeSize(GLenum type) {
+	switch (type) {
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE: return 1;
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+		case GL_HALF_FLOAT: return 2;
+		case GL_INT:
+		case GL_UNSIGNED_INT:
+		case GL_FLOAT: return 4;
+		default: throw std::runtime_error("VTX_LAYOUT::NO_SUCH_TYPE");
+	}
+}
+
+VertexLayout& VertexLayout::Add(GLuint location, GLuint stream, GLint components, GLenum type, GLboolean normalized) {
+
+#ifndef NDEBUG
+	if (stream >= MAX_STREAMS) {
+		throw std::out_of_range("VTX_LAYOUT::STREAM_OUT_OF_RANGE");
+	}
+	if (GetAttribute(location)) {
+		throw std::runtime_error("VTX_LAYOUT::LOCATION_NOT_UNIQUE");
+	}
+	if (location == POSITION && type != GL_FLOAT) {
+		throw std::runtime_error("VTX_LAYOUT::POSITION_NOT_FLOAT");
+	}
+#endif
+
+	m_Attributes.push_back({ location, stream, components, type, normalized, (GLuint)m_Strides[stream] });
+	m_Strides[stream] += components * GetTypeSize(type);
+	if (stream + 1 > m_StreamCount) {
+		m_StreamCount = stream + 1;
+	}
+
+	UpdateHash();
+	return *this;
+}
+
+// FNV-1a step over the four bytes of value.
+static void HashMix(uint64_t& hash, uint32_t value) {
+	for (int i = 0; i < 4; i++) {
+		hash ^= (value >> (i * 8)) & 0xFF;
+		hash *= 1099511628211ull;
+	}
+}
+
+void VertexLayout::UpdateHash() {
+
+	uint64_t hash = 14695981039346656037ull;
+	for (const VertexAttribute& attr : m_Attributes) {
+		HashMix(hash, attr.location);
+		HashMix(hash, attr.stream);
+		HashMix(hash, attr.components);
+		HashMix(hash, attr.type);
+		HashMix(hash, attr.normalized);
+		HashMix(hash, attr.offset);
+	}
+	m_Hash = hash;
+}
+
+const VertexAttribute* VertexLayout::GetAttribute(GLuint location) const {
+	for (const VertexAttribute& attr : m_Attributes) {
+		if (attr.location == location) {
+			return &attr;
+		}
+	}
+	return nullptr;
+}
+
+bool VertexLayout::operator==(const VertexLayout& other) const {
+
+	if (m_Hash != other.m_Hash || m_Attributes.size() != other.m_Attributes.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < m_Attributes.size(); i++) {
+		const VertexAttribute& a = m_Attributes[i];
+		const VertexAttribute& b = other.m_Attributes[i];
+		if (a.location != b.location || a.stream != b.stream || a.components != b.components || a.type != b.type || a.normalized != b.normalized || a.offset != b.offset) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void VertexLayout::Apply(const GLuint* buffers, bool positionOnly) const {
+
+	for (const VertexAttribute& attr : m_Attributes) {
+		if (positionOnly && attr.location != POSITION) {
+			glDisableVertexAttribArray(attr.location);
+			continue;
+		}
+		GLState::BindBuffer(GL_ARRAY_BUFFER, buffers[attr.stream]);
+		glVertexAttribPointer(attr.location, attr.components, attr.type, attr.normalized, m_Strides[attr.stream], (void*)(uintptr_t)attr.offset);
+		glEnableVertexAttribArray(attr.location);
+	}
+}
+
+VertexLayout VertexLayout::Interleaved() {
+
+	VertexLayout layout;
+	layout.Add(POSITION, 0, 3, GL_FLOAT)
+			.Add(NORMAL, 0, 3, GL_FLOAT)
+			.Add(TEXCOORD, 0, 2, GL_FLOAT);
+	return layout;
+}
+
+VertexLayout VertexLayout::Split() {
+
+	VertexLayout layout;
+	layout.Add(POSITION, 0, 3, GL_FLOAT)
+			.Add(NORMAL, 1, 3, GL_FLOAT)
+			.Add(TEXCOORD, 1, 2, GL_FLOAT);
+	return layout;
+}
+
+// ----------------------------
+
+VertexArrayCache::Entry& VertexArrayCache::GetEntry(const VertexLayout& layout) {
+
+	auto range = m_Entries.equal_range(layout.GetHash());
+	for (auto it = range.first; it != range.second; ++it) {
+		if (it->second.layout == layout) {
+			return it->second;
+		}
+	}
+
+	Entry& entry = m_Entries.emplace(layout.GetHash(), Entry())->second;
+	entry.layout = layout;
+
+	glGenVertexArrays(1, &entry.vao);
+	glGenVertexArrays(1, &entry.positionVao);
+
+	// Buffers are created on the first Reserve.
+	for (uint32_t s = 0; s < VertexLayout::MAX_STREAMS; s++) {
+		entry.buffers[s]  = 0;
+		entry.capacity[s] = 0;
+	}
+	entry.ebo			= 0;
+	entry.indexCapacity = 0;
+	entry.vertexCount   = 0;
+	entry.indexCount	= 0;
+
+	return entry;
+}
+
+// Grows a buffer to hold at least the given size, keeping its contents.
+static void GrowBuffer(GLuint& buffer, GLsizeiptr used, GLsizeiptr& capacity, GLsizeiptr required) {
+
+	if (required <= capacity) {
+		return;
+	}
+
+	GLsizeiptr newCapacity = capacity ? capacity : 4096;
+	while (newCapacity < required) {
+		newCapacity *= 2;
+	}
+
+	GLuint newBuffer;
+	glGenBuffers(1, &newBuffer);
+	GLState::BindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, newCapacity, nullptr, GL_STATIC_DRAW);
+	if (used) {
+		GLState::BindBuffer(GL_COPY_READ_BUFFER, buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+	}
+	GLState::DeleteBuffers(1, &buffer);
+
+	buffer   = newBuffer;
+	capacity = newCapacity;
+}
+
+void VertexArrayCache::Reserve(Entry& entry, uint32_t vertexCount, uint32_t indexCount) {
+
+	const VertexLayout& layout = entry.layout;
+	bool				grown  = false;
+
+	for (uint32_t s = 0; s < layout.GetStreamCount(); s++) {
+		GLsizeiptr stride = layout.GetStride(s);
+		GLuint	 old	= entry.buffers[s];
+		GrowBuffer(entry.buffers[s], entry.vertexCount * stride, entry.capacity[s], (entry.vertexCount + vertexCount) * stride);
+		grown |= old != entry.buffers[s];
+	}
+
+	GLuint oldEbo = entry.ebo;
+	GrowBuffer(entry.ebo, entry.indexCount * sizeof(uint32_t), entry.indexCapacity, (entry.indexCount + indexCount) * sizeof(uint32_t));
+	grown |= oldEbo != entry.ebo;
+
+	// VAO ids stay stable, only their bindings are refreshed.
+	if (grown) {
+		GLState::BindVertexArray(entry.vao);
+		layout.Apply(entry.buffers);
+		GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, entry.ebo);
+
+		GLState::BindVertexArray(entry.positionVao);
+		layout.Apply(entry.buffers, true);
+		GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, entry.ebo);
+
+		GLState::BindVertexArray(0);
+	}
+}
+
+VertexArrayCache::Allocation VertexArrayCache::Append(const VertexLayout& layout, const std::vector<uint8_t>* streams, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount) {
+
+	Entry& entry = GetEntry(layout);
+	Reserve(entry, vertexCount, indexCount);
+
+	for (uint32_t s = 0; s < layout.GetStreamCount(); s++) {
+		GLsizeiptr stride = layout.GetStride(s);
+		GLState::BindBuffer(GL_ARRAY_BUFFER, entry.buffers[s]);
+		glBufferSubData(GL_ARRAY_BUFFER, entry.vertexCount * stride, vertexCount * stride, streams[s].data());
+	}
+	GLState::BindBuffer(GL_COPY_WRITE_BUFFER, entry.ebo);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, entry.indexCount * sizeof(uint32_t), indexCount * sizeof(uint32_t), indices);
+
+	Allocation alloc = {
+		entry.vao,
+		entry.positionVao,
+		entry.indexCount,
+		(int32_t)entry.vertexCount
+	};
+
+	entry.vertexCount += vertexCount;
+	entry.indexCount += indexCount;
+
+	return alloc;
+}
+
+VertexArrayCache::Allocation VertexArrayCache::AppendCopy(const VertexLayout& layout, const GLuint* streams, uint32_t vertexCount, GLuint indices, uint32_t indexCount) {
+
+	Entry& entry = GetEntry(layout);
+	Reserve(entry, vertexCount, indexCount);
+
+	for (uint32_t s = 0; s < layout.GetStreamCount(); s++) {
+		GLsizeiptr stride = layout.GetStride(s);
+		GLState::BindBuffer(GL_COPY_READ_BUFFER, streams[s]);
+		GLState::BindBuffer(GL_COPY_WRITE_BUFFER, entry.buffers[s]);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, entry.vertexCount * stride, vertexCount * stride);
+	}
+	GLState::BindBuffer(GL_COPY_READ_BUFFER, indices);
+	GLState::BindBuffer(GL_COPY_WRITE_BUFFER, entry.ebo);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, entry.indexCount * sizeof(uint32_t), indexCount * sizeof(uint32_t));
+
+	Allocation alloc = {
+		entry.vao,
+		entry.positionVao,
+		entry.indexCount,
+		(int32_t)entry.vertexCount
+	};
+
+	entry.vertexCount += vertexCount;
+	entry.indexCount += indexCount;
+
+	return alloc;
+}
+
+VertexArrayCache::~VertexArrayCache() {
+
+	for (auto& p : m_Entries) {
+		Entry& entry = p.second;
+		GLState::DeleteVertexArrays(1, &entry.vao);
+		GLState::DeleteVertexArrays(1, &entry.positionVao);
+		GLState::DeleteBuffers(entry.layout.GetStreamCount(), entry.buffers);
+		GLState::DeleteBuffers(1, &entry.ebo);
+	}
+}
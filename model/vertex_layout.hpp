@@ -0,0 +1,129 @@
+
+#ifndef _VERTEX_LAYOUT_HPP
+#define _VERTEX_LAYOUT_HPP
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include <glad/glad.h>
+
+/*
+ * Vertex Attribute struct
+ * Describes a single attribute: the shader location it feeds, the stream
+ * (vertex buffer) it is fetched from and its format inside that stream.
+ */
+
+struct VertexAttribute {
+	GLuint	location;
+	GLuint	stream;
+	GLint	 components;
+	GLenum	type;
+	GLboolean normalized;
+	GLuint	offset; // Byte offset inside one element of the stream
+};
+
+/*
+ * Vertex Layout class
+ * Descriptor of how vertices are laid out in memory. Attributes can share
+ * a stream (interleaved) or live in streams of their own (split).
+ * Keeping the position in a tightly packed stream of its own lets depth
+ * and shadow passes fetch 12 bytes per vertex. Positions are always
+ * floats, no shader decodes anything else.
+ */
+
+class VertexLayout {
+public:
+	static const uint32_t MAX_STREAMS = 4;
+
+	// Attribute locations shared by every shader.
+	static const GLuint POSITION = 0;
+	static const GLuint NORMAL   = 1;
+	static const GLuint TEXCOORD = 2;
+
+	// Per instance attributes, fed from an InstanceBuffer.
+	static const GLuint INSTANCE_MODEL	= 3; // mat4, takes 4 locations
+	static const GLuint INSTANCE_COLOR	= 7;
+	static const GLuint INSTANCE_MATERIAL = 8;
+
+private:
+	std::vector<VertexAttribute> m_Attributes;
+	GLsizei						 m_Strides[MAX_STREAMS] = {};
+	uint32_t					 m_StreamCount			= 0;
+	uint64_t					 m_Hash					= 0;
+
+	void UpdateHash();
+
+public:
+	// Appends an attribute to the end of the given stream.
+	VertexLayout& Add(GLuint location, GLuint stream, GLint components, GLenum type, GLboolean normalized = GL_FALSE);
+
+	// Sets up attribute pointers on the bound VAO for the given stream buffers.
+	// When positionOnly is set, only the position attribute is enabled.
+	void Apply(const GLuint* buffers, bool positionOnly = false) const;
+
+	const std::vector<VertexAttribute>& GetAttributes() const { return m_Attributes; }
+	const VertexAttribute*				GetAttribute(GLuint location) const;
+
+	GLsizei  GetStride(uint32_t stream) const { return m_Strides[stream]; }
+	uint32_t GetStreamCount() const { return m_StreamCount; }
+	uint64_t GetHash() const { return m_Hash; }
+
+	bool operator==(const VertexLayout& other) const;
+	bool operator!=(const VertexLayout& other) const { return !(*this == other); }
+
+	// Size in bytes of one component of the given type.
+	static GLuint GetTypeSize(GLenum type);
+
+	// Common layouts
+	// Position, normal and texcoord interleaved in a single stream.
+	static VertexLayout Interleaved();
+	// Position alone in stream 0, normal and texcoord interleaved in stream 1.
+	static VertexLayout Split();
+};
+
+/*
+ * Vertex Array Cache class
+ * Owns the vertex/index buffers and VAOs for every layout in use.
+ * Geometry of the same layout is appended into shared buffers so one VAO
+ * per layout (plus a position-only VAO) serves every mesh using it.
+ */
+
+class VertexArrayCache {
+public:
+	struct Allocation {
+		GLuint   vao;
+		GLuint   positionVao;
+		uint32_t firstIndex;
+		int32_t  baseVertex;
+	};
+
+private:
+	struct Entry {
+		VertexLayout layout;
+		GLuint		 vao;
+		GLuint		 positionVao;
+		GLuint		 buffers[VertexLayout::MAX_STREAMS];
+		GLsizeiptr   capacity[VertexLayout::MAX_STREAMS];
+		GLuint		 ebo;
+		GLsizeiptr   indexCapacity;
+		uint32_t	 vertexCount;
+		uint32_t	 indexCount;
+	};
+
+	std::multimap<uint64_t, Entry> m_Entries; // By layout hash, compared in full on a hit
+
+	Entry& GetEntry(const VertexLayout& layout);
+	void   Reserve(Entry& entry, uint32_t vertexCount, uint32_t indexCount);
+
+public:
+	// Appends packed stream data and indices to the buffers of the layout.
+	Allocation Append(const VertexLayout& layout, const std::vector<uint8_t>* streams, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+	// Same from buffers already holding them, copied on the GPU. One buffer per stream of the layout.
+	Allocation AppendCopy(const VertexLayout& layout, const GLuint* streams, uint32_t vertexCount, GLuint indices, uint32_t indexCount);
+
+	VertexArrayCache() {}
+	~VertexArrayCache();
+};
+
+#endif /* _VERTEX_LAYOUT_HPP */
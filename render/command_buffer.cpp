@@ -0,0 +1,40 @@
+#include "command_buffer.hpp"
+
+bool CommandBuffer::Next(size_t& cursor, Command& command) const {
+
+	if (cursor >= m_Size) {
+		return false;
+	}
+
+	command.op = (Op)Read<uint8_t>(cursor);
+	switch (command.op) {
+	case OP_PASS:
+		command.pass = Read<uint8_t>(cursor);
+		break;
+	case OP_PROGRAM:
+		command.program = Read<Shader*>(cursor);
+		break;
+	case OP_MATERIAL:
+		command.material = Read<Material*>(cursor);
+		break;
+	case OP_MESH:
+		command.mesh = Read<const Mesh*>(cursor);
+		break;
+	case OP_INSTANCES:
+		command.firstInstance = Read<uint32_t>(cursor);
+		break;
+	case OP_BLOCK:
+		command.block.binding = Read<uint8_t>(cursor);
+		command.block.offset  = Read<uint32_t>(cursor);
+		break;
+	case OP_MODEL:
+		command.model = Read<const glm::mat4*>(cursor);
+		break;
+	case OP_DRAW:
+		command.draw.firstIndex = Read<uint32_t>(cursor);
+		command.draw.count		= Read<uint32_t>(cursor);
+		command.draw.instances	= Read<uint32_t>(cursor);
+		break;
+	}
+	return true;
+}
@@ -0,0 +1,146 @@
+
+#ifndef _COMMAND_BUFFER_HPP
+#define _COMMAND_BUFFER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class Material;
+class Shader;
+struct Mesh;
+
+/*
+ * Command Buffer class
+ * Draw commands recorded without touching GL, for replay on the thread
+ * that owns the context. Any thread may record into a buffer of its own;
+ * buffers recorded in parallel are replayed one after the other.
+ * Commands are packed back to back, an opcode byte and then its operands
+ * unaligned, so a draw with its state changes takes a few dozen bytes.
+ * Recording keeps no state, the recorder skips what is still bound.
+ */
+
+class CommandBuffer {
+public:
+	enum Op : uint8_t {
+		OP_PASS,	  // pass
+		OP_PROGRAM,	  // program, forgets the material
+		OP_MATERIAL,  // material, attached to the bound program
+		OP_MESH,	  // mesh
+		OP_INSTANCES, // first instance, on the bound mesh
+		OP_BLOCK,	  // binding and offset into the frame's uniform ring
+		OP_MODEL,	  // model matrix, for programs without the DrawData block
+		OP_DRAW,	  // index range of the bound mesh and instances, 0 for a plain draw
+	};
+
+	struct Command {
+		Op op;
+		union {
+			uint32_t		 pass;
+			Shader*			 program;
+			Material*		 material;
+			const Mesh*		 mesh;
+			uint32_t		 firstInstance;
+			const glm::mat4* model;
+			struct {
+				uint32_t binding;
+				uint32_t offset;
+			} block;
+			struct {
+				uint32_t firstIndex;
+				uint32_t count;
+				uint32_t instances;
+			} draw;
+		};
+	};
+
+private:
+	static const size_t MAX_COMMAND_SIZE = 16;
+
+	std::vector<uint8_t> m_Data; // Grown ahead of m_Size, so writes need no checks
+	size_t				 m_Size	 = 0;
+	uint32_t			 m_Count = 0;
+
+	template <typename T>
+	void Write(const T& value) {
+		std::memcpy(&m_Data[m_Size], &value, sizeof(T));
+		m_Size += sizeof(T);
+	}
+
+	template <typename T>
+	T Read(size_t& cursor) const {
+		T value;
+		std::memcpy(&value, &m_Data[cursor], sizeof(T));
+		cursor += sizeof(T);
+		return value;
+	}
+
+	void Begin(Op op) {
+		if (m_Size + MAX_COMMAND_SIZE > m_Data.size()) {
+			m_Data.resize(std::max<size_t>(m_Data.size() * 2, 4096));
+		}
+		Write((uint8_t)op);
+		m_Count++;
+	}
+
+public:
+	// Keeps the memory, buffers are refilled every frame.
+	void Clear() {
+		m_Size	= 0;
+		m_Count = 0;
+	}
+
+	void SetPass(uint32_t pass) {
+		Begin(OP_PASS);
+		Write((uint8_t)pass);
+	}
+
+	void UseProgram(Shader* program) {
+		Begin(OP_PROGRAM);
+		Write(program);
+	}
+
+	void AttachMaterial(Material* material) {
+		Begin(OP_MATERIAL);
+		Write(material);
+	}
+
+	void BindMesh(const Mesh* mesh) {
+		Begin(OP_MESH);
+		Write(mesh);
+	}
+
+	void BindInstances(uint32_t firstInstance) {
+		Begin(OP_INSTANCES);
+		Write(firstInstance);
+	}
+
+	void SetBlockOffset(uint32_t binding, uint32_t offset) {
+		Begin(OP_BLOCK);
+		Write((uint8_t)binding);
+		Write(offset);
+	}
+
+	void SetModel(const glm::mat4* model) {
+		Begin(OP_MODEL);
+		Write(model);
+	}
+
+	void Draw(uint32_t firstIndex, uint32_t count, uint32_t instances = 0) {
+		Begin(OP_DRAW);
+		Write(firstIndex);
+		Write(count);
+		Write(instances);
+	}
+
+	// Decodes the command at cursor and moves past it. False at the end.
+	bool Next(size_t& cursor, Command& command) const;
+
+	uint32_t GetCount() const { return m_Count; }
+	size_t	 GetSize() const { return m_Size; }
+};
+
+#endif /* _COMMAND_BUFFER_HPP */
@@ -0,0 +1,46 @@
+#include "instance_buffer.hpp"
+#include <glstate/glstate.hpp>
+#include <model/vertex_layout.hpp>
+
+#include <cstddef>
+
+uint32_t InstanceBuffer::Add(const InstanceData& instance) {
+
+	m_Data.push_back(instance);
+	return (uint32_t)m_Data.size() - 1;
+}
+
+void InstanceBuffer::Upload() {
+
+	m_Ring.Next();
+	m_Ring.Upload(m_Data.data(), m_Data.size() * sizeof(InstanceData));
+}
+
+void InstanceBuffer::Bind(uint32_t first) const {
+
+	const GLsizei stride = sizeof(InstanceData);
+	const size_t  base	 = m_Ring.GetBase() + first * sizeof(InstanceData);
+
+	GLState::BindBuffer(GL_ARRAY_BUFFER, m_Ring.GetBuffer());
+	for (GLuint c = 0; c < 4; c++) {
+		GLuint location = VertexLayout::INSTANCE_MODEL + c;
+		glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(InstanceData, model) + c * sizeof(glm::vec4)));
+		glVertexAttribDivisor(location, 1);
+		glEnableVertexAttribArray(location);
+	}
+
+	glVertexAttribPointer(VertexLayout::INSTANCE_COLOR, 4, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(InstanceData, color)));
+	glVertexAttribDivisor(VertexLayout::INSTANCE_COLOR, 1);
+	glEnableVertexAttribArray(VertexLayout::INSTANCE_COLOR);
+
+	glVertexAttribIPointer(VertexLayout::INSTANCE_MATERIAL, 1, GL_UNSIGNED_INT, stride, (void*)(base + offsetof(InstanceData, material)));
+	glVertexAttribDivisor(VertexLayout::INSTANCE_MATERIAL, 1);
+	glEnableVertexAttribArray(VertexLayout::INSTANCE_MATERIAL);
+}
+
+void InstanceBuffer::Unbind() const {
+
+	for (GLuint location = VertexLayout::INSTANCE_MODEL; location <= VertexLayout::INSTANCE_MATERIAL; location++) {
+		glDisableVertexAttribArray(location);
+	}
+}
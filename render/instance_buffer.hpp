@@ -0,0 +1,53 @@
+
+#ifndef _INSTANCE_BUFFER_HPP
+#define _INSTANCE_BUFFER_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glstate/stream_ring.hpp>
+
+/*
+ * Instance Data struct
+ * One instance as the vertex shader sees it, at the INSTANCE_* locations
+ * of VertexLayout.
+ */
+
+struct InstanceData {
+	glm::mat4 model;
+	glm::vec4 color;
+	uint32_t  material; // Index for shaders that look materials up, numbered per frame
+	uint32_t  pad[3];
+};
+
+/*
+ * Instance Buffer class
+ * A stream of per instance attributes, refilled every frame. GL 3.3 has
+ * no base instance, so each batch re-points the instance attributes of
+ * the bound VAO at its first instance before drawing, and turns them off
+ * again after, since mesh VAOs are shared with non instanced draws.
+ * Like UniformRing it streams through a StreamRing, a segment per frame.
+ */
+
+class InstanceBuffer {
+	StreamRing				  m_Ring{ GL_ARRAY_BUFFER, GL_STREAM_DRAW, 256 * sizeof(InstanceData) };
+	std::vector<InstanceData> m_Data;
+
+public:
+	uint32_t Add(const InstanceData& instance);
+	void	 Clear() { m_Data.clear(); }
+	uint32_t GetCount() const { return (uint32_t)m_Data.size(); }
+
+	// Moves to the next segment and uploads everything added since Clear.
+	void Upload();
+
+	// Sets up the instance attributes of the bound VAO, starting at first.
+	void Bind(uint32_t first) const;
+	// Disables them on the bound VAO again, after the batch has drawn.
+	void Unbind() const;
+
+};
+
+#endif /* _INSTANCE_BUFFER_HPP */
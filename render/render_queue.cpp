@@ -0,0 +1,472 @@
+#include "render_queue.hpp"
+#include <glad/glad.h>
+#include <glstate/glstate.hpp>
+#include <jobs/parallel.hpp>
+#include <material/material.hpp>
+#include <model/mesh.hpp>
+#include <shader/shader.hpp>
+#include <texture/texture.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+
+static const uint32_t DEPTH_BITS	= 24;
+static const uint32_t DEPTH_MAX		= (1u << DEPTH_BITS) - 1;
+static const uint32_t PROGRAM_MAX	= (1u << 10) - 1;
+static const uint32_t TEXTURE_MAX	= (1u << 16) - 1;
+static const uint32_t MATERIAL_MAX	= (1u << 12) - 1;
+static const uint32_t PASS_SHIFT	= 62;
+static const uint32_t NO_PASS		= ~0u;
+
+static constexpr UniformId MODEL("model");
+
+void RenderQueue::KeyIds::Reset() {
+
+	if (ids.size() > 2 * next + 64) {
+		ids.clear();
+	}
+	next = 0;
+	frame++;
+}
+
+uint32_t RenderQueue::KeyIds::Get(uintptr_t value) {
+
+	Entry& entry = ids[value];
+	if (entry.frame != frame) {
+		entry.id	= next++;
+		entry.frame = frame;
+	}
+	return entry.id;
+}
+
+uint32_t RenderQueue::GetMaterialId(const Material* material) {
+
+	return m_MaterialIds.Get((uintptr_t)material);
+}
+
+// Materials bind all their samplers together, the texture on the lowest unit stands in for the set.
+uint32_t RenderQueue::GetTextureKey(Material* material) {
+
+	uint32_t key  = 0;
+	uint32_t unit = ~0u;
+	for (const MaterialSampler& sampler : material->GetSamplers()) {
+		if (sampler.unit < unit) {
+			unit = sampler.unit;
+			key	 = sampler.texture->id;
+		}
+	}
+	return key;
+}
+
+Shader* RenderQueue::Resolve(Shader* program) const {
+
+	return program->IsReady() ? program : m_Fallback;
+}
+
+void RenderQueue::CountChanges(const DrawPacket& previous, const DrawPacket& packet, StateChanges& changes) {
+
+	if (!previous.material || previous.material->GetShader() != packet.material->GetShader()) {
+		changes.programs++;
+	}
+	if (previous.material != packet.material) {
+		changes.materials++;
+		if (!previous.material || GetTextureKey(previous.material) != GetTextureKey(packet.material)) {
+			changes.textures++;
+		}
+	}
+	if (previous.mesh != packet.mesh) {
+		changes.meshes++;
+	}
+}
+
+void RenderQueue::Begin(const glm::vec3& eye, float farPlane) {
+
+	m_Packets.clear();
+	m_Order.clear();
+	m_Eye	 = eye;
+	m_InvFar = 1.0f / farPlane;
+	m_Stats	 = {};
+	m_ProgramIds.Reset();
+	m_TextureIds.Reset();
+	m_MaterialIds.Reset();
+	Invalidate();
+}
+
+void RenderQueue::Submit(Pass pass, const Mesh* mesh, Material* material, const glm::mat4* model, const glm::vec3& center, uint32_t object, int32_t subMesh, const glm::vec4& color) {
+
+#ifndef NDEBUG
+	if (!material || !material->GetShader()) {
+		throw std::runtime_error("RQUE::MATL_NULL");
+	}
+#endif
+
+	uint64_t depth	  = (uint64_t)(std::min(glm::length(center - m_Eye) * m_InvFar, 1.0f) * DEPTH_MAX);
+	uint64_t program  = m_ProgramIds.Get(material->GetShader()->GetID());
+	uint64_t texture  = m_TextureIds.Get(GetTextureKey(material));
+	uint64_t matId	  = GetMaterialId(material);
+	uint64_t key	  = (uint64_t)pass << PASS_SHIFT;
+
+	// Past the field width ids share its last value, only the grouping suffers.
+	if (program > PROGRAM_MAX || texture > TEXTURE_MAX || matId > MATERIAL_MAX) {
+		program = std::min<uint64_t>(program, PROGRAM_MAX);
+		texture = std::min<uint64_t>(texture, TEXTURE_MAX);
+		matId	= std::min<uint64_t>(matId, MATERIAL_MAX);
+		m_Stats.keyOverflows++;
+	}
+
+	if (pass == PASS_TRANSPARENT) {
+		key |= (DEPTH_MAX - depth) << 38 | program << 28 | texture << 12 | matId;
+		m_Stats.transparent++;
+	} else {
+		key |= program << 52 | texture << 36 | matId << 24 | depth;
+	}
+
+	m_Packets.push_back({ key, mesh, material, model, color, subMesh, object, 0 });
+}
+
+// LSD radix sort on the keys, 8 bits a pass, skipping bytes every key shares.
+void RenderQueue::Sort() {
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	const size_t count = m_Packets.size();
+	m_Keys.resize(count);
+	m_KeyScratch.resize(count);
+	m_Order.resize(count);
+	m_OrderScratch.resize(count);
+
+	for (size_t i = 0; i < count; i++) {
+		m_Keys[i] = m_Packets[i].key;
+	}
+	std::iota(m_Order.begin(), m_Order.end(), 0);
+
+	for (uint32_t shift = 0; shift < 64; shift += 8) {
+		size_t offsets[256] = {};
+		for (uint64_t key : m_Keys) {
+			offsets[(key >> shift) & 0xFF]++;
+		}
+		if (offsets[m_Keys.empty() ? 0 : (m_Keys[0] >> shift) & 0xFF] == count) {
+			continue;
+		}
+
+		size_t sum = 0;
+		for (size_t& offset : offsets) {
+			size_t c = offset;
+			offset	 = sum;
+			sum += c;
+		}
+		for (size_t i = 0; i < count; i++) {
+			size_t dst		   = offsets[(m_Keys[i] >> shift) & 0xFF]++;
+			m_KeyScratch[dst]   = m_Keys[i];
+			m_OrderScratch[dst] = m_Order[i];
+		}
+		m_Keys.swap(m_KeyScratch);
+		m_Order.swap(m_OrderScratch);
+	}
+
+	auto stop = std::chrono::high_resolution_clock::now();
+
+	// Written in sorted order so the draws walk the ring front to back.
+	m_DrawData.Begin();
+	for (uint32_t index : m_Order) {
+		DrawPacket& packet	= m_Packets[index];
+		Shader*		program = Resolve(packet.material->GetShader());
+		if (program && program->UsesBlock(UniformBlocks::DRAW)) {
+			DrawData data	= { *packet.model, packet.color };
+			packet.drawData = m_DrawData.Allocate(&data, sizeof(data));
+		}
+	}
+	m_DrawData.Flush();
+
+	m_Stats.packets			 = (uint32_t)count;
+	m_Stats.sortMicroseconds = std::chrono::duration<float, std::micro>(stop - start).count();
+
+	DrawPacket previous = {};
+	for (const DrawPacket& packet : m_Packets) {
+		CountChanges(previous, packet, m_Stats.submitted);
+		previous = packet;
+	}
+}
+
+void RenderQueue::SetPass(uint32_t pass) {
+
+	if (pass == m_Pass) {
+		return;
+	}
+	if (pass == PASS_TRANSPARENT) {
+		GLState::Enable(GL_BLEND);
+		GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		GLState::DepthMask(GL_FALSE);
+	} else {
+		GLState::Disable(GL_BLEND);
+		GLState::DepthMask(GL_TRUE);
+	}
+	m_Pass = pass;
+}
+
+// A material is attached per program, switching programs forgets it. No material for the fallback.
+void RenderQueue::Bind(Shader* program, Material* material, const SetupFunc& setup) {
+
+	if (program != m_Program) {
+		program->Use();
+		if (setup) {
+			setup(program);
+		}
+		m_Program  = program;
+		m_Material = nullptr;
+		m_Stats.executed.programs++;
+	}
+
+	if (material && material != m_Material) {
+		material->Attach(program);
+		m_Material = material;
+		m_Stats.executed.materials++;
+
+		uint32_t texture = GetTextureKey(material);
+		if (texture != m_Texture) {
+			m_Texture = texture;
+			m_Stats.executed.textures++;
+		}
+	}
+}
+
+void RenderQueue::Draw(const DrawPacket& packet, const SetupFunc& setup) {
+
+	Shader* shader	= packet.material->GetShader();
+	Shader* program = Resolve(shader);
+	if (!program) {
+		return;
+	}
+
+	SetPass((uint32_t)(packet.key >> PASS_SHIFT));
+	if (program == shader) {
+		Bind(program, packet.material, setup);
+	} else {
+		Bind(program, nullptr, setup);
+		m_Stats.fallbackDraws++;
+	}
+
+	if (packet.mesh != m_Mesh) {
+		m_Mesh = packet.mesh;
+		m_Stats.executed.meshes++;
+	}
+
+	if (m_Program->UsesBlock(UniformBlocks::DRAW)) {
+		m_DrawData.Bind(UniformBlocks::DRAW, packet.drawData, sizeof(DrawData));
+	} else {
+		m_Program->SetMatrix(MODEL, *packet.model);
+	}
+	if (packet.subMesh < 0) {
+		packet.mesh->Draw();
+	} else {
+		packet.mesh->DrawSubMesh(packet.subMesh);
+	}
+	m_Stats.draws++;
+}
+
+// Sorting already made equal mesh and material packets adjacent. Filtered out packets end a run.
+void RenderQueue::BuildBatches(const FilterFunc& filter) {
+
+	m_Batches.clear();
+	m_Items.clear();
+	m_Instances.Clear();
+
+	const uint32_t count = (uint32_t)m_Order.size();
+	for (uint32_t i = 0; i < count;) {
+		const DrawPacket& first = m_Packets[m_Order[i]];
+		if (filter && !filter(first.object)) {
+			i++;
+			continue;
+		}
+
+		uint32_t end = i + 1;
+		while (end < count) {
+			const DrawPacket& next = m_Packets[m_Order[end]];
+			if (next.mesh != first.mesh || next.material != first.material || next.subMesh != first.subMesh || (next.key >> PASS_SHIFT) != (first.key >> PASS_SHIFT)) {
+				break;
+			}
+			if (filter && !filter(next.object)) {
+				break;
+			}
+			end++;
+		}
+
+		Shader* instanced = first.material->GetInstancedShader();
+		if (m_Instancing && end - i >= MIN_INSTANCES && instanced && instanced->IsReady()) {
+			m_Items.push_back({ i, (int32_t)m_Batches.size() });
+			m_Batches.push_back({ i, end - i, m_Instances.GetCount() });
+			for (uint32_t k = i; k < end; k++) {
+				const DrawPacket& packet = m_Packets[m_Order[k]];
+				m_Instances.Add({ *packet.model, packet.color, GetMaterialId(packet.material), {} });
+			}
+		} else {
+			for (uint32_t k = i; k < end; k++) {
+				m_Items.push_back({ k, -1 });
+			}
+		}
+		i = end;
+	}
+
+	if (!m_Batches.empty()) {
+		m_Instances.Upload();
+	}
+}
+
+// Worker threads, so nothing here touches GL or the queue. Every buffer starts from unknown state.
+void RenderQueue::Record(uint32_t begin, uint32_t end, CommandBuffer& out, uint32_t& fallbacks) const {
+
+	uint32_t	pass	 = NO_PASS;
+	Shader*		program	 = nullptr;
+	Material*	material = nullptr;
+	const Mesh* mesh	 = nullptr;
+
+	auto bind = [&](const DrawPacket& packet, Shader* nextProgram, Material* nextMaterial) {
+		uint32_t nextPass = (uint32_t)(packet.key >> PASS_SHIFT);
+		if (nextPass != pass) {
+			out.SetPass(nextPass);
+			pass = nextPass;
+		}
+		if (nextProgram != program) {
+			out.UseProgram(nextProgram);
+			program	 = nextProgram;
+			material = nullptr;
+		}
+		if (nextMaterial && nextMaterial != material) {
+			out.AttachMaterial(nextMaterial);
+			material = nextMaterial;
+		}
+		if (packet.mesh != mesh) {
+			out.BindMesh(packet.mesh);
+			mesh = packet.mesh;
+		}
+	};
+
+	for (uint32_t i = begin; i < end; i++) {
+		const Item&		  item	 = m_Items[i];
+		const DrawPacket& packet = m_Packets[m_Order[item.start]];
+
+		uint32_t first = 0;
+		uint32_t count = (uint32_t)packet.mesh->m_Count;
+		if (packet.subMesh >= 0) {
+			const SubMesh& sub = packet.mesh->m_SubMeshes[packet.subMesh];
+			first			   = sub.firstIndex;
+			count			   = (uint32_t)sub.count;
+		}
+
+		if (item.batch >= 0) {
+			const Batch& batch = m_Batches[item.batch];
+			bind(packet, packet.material->GetInstancedShader(), packet.material);
+			out.BindInstances(batch.firstInstance);
+			out.Draw(first, count, batch.count);
+			continue;
+		}
+
+		Shader* shader	 = packet.material->GetShader();
+		Shader* resolved = Resolve(shader);
+		if (!resolved) {
+			continue;
+		}
+		if (resolved == shader) {
+			bind(packet, resolved, packet.material);
+		} else {
+			bind(packet, resolved, nullptr);
+			fallbacks++;
+		}
+
+		if (resolved->UsesBlock(UniformBlocks::DRAW)) {
+			out.SetBlockOffset(UniformBlocks::DRAW, (uint32_t)packet.drawData);
+		} else {
+			out.SetModel(packet.model);
+		}
+		out.Draw(first, count);
+	}
+}
+
+void RenderQueue::Replay(const CommandBuffer& buffer, const SetupFunc& setup) {
+
+	CommandBuffer::Command command;
+	size_t				   cursor = 0;
+	while (buffer.Next(cursor, command)) {
+		switch (command.op) {
+		case CommandBuffer::OP_PASS:
+			SetPass(command.pass);
+			break;
+		case CommandBuffer::OP_PROGRAM:
+			Bind(command.program, nullptr, setup);
+			break;
+		case CommandBuffer::OP_MATERIAL:
+			Bind(m_Program, command.material, setup);
+			break;
+		case CommandBuffer::OP_MESH:
+			if (command.mesh != m_Mesh) {
+				m_Mesh = command.mesh;
+				m_Stats.executed.meshes++;
+			}
+			GLState::BindVertexArray(m_Mesh->m_VAO);
+			break;
+		case CommandBuffer::OP_INSTANCES:
+			m_Instances.Bind(command.firstInstance);
+			break;
+		case CommandBuffer::OP_BLOCK:
+			m_DrawData.Bind(command.block.binding, command.block.offset, sizeof(DrawData));
+			break;
+		case CommandBuffer::OP_MODEL:
+			m_Program->SetMatrix(MODEL, *command.model);
+			break;
+		case CommandBuffer::OP_DRAW:
+			m_Mesh->DrawRange(command.draw.firstIndex, (GLsizei)command.draw.count, (GLsizei)command.draw.instances);
+			m_Stats.draws++;
+			if (command.draw.instances) {
+				m_Instances.Unbind();
+				m_Stats.instancedDraws++;
+				m_Stats.instances += command.draw.instances;
+			}
+			break;
+		}
+	}
+}
+
+void RenderQueue::Execute(const SetupFunc& setup, const FilterFunc& filter) {
+
+	Invalidate();
+	BuildBatches(filter);
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	const uint32_t count  = (uint32_t)m_Items.size();
+	const uint32_t ranges = GetRangeCount(count, MIN_RECORD_ITEMS);
+	if (m_Buffers.size() < ranges) {
+		m_Buffers.resize(ranges);
+	}
+	m_Fallbacks.assign(ranges, 0);
+	ParallelFor(count, MIN_RECORD_ITEMS, [&](uint32_t begin, uint32_t end, uint32_t range) {
+		m_Buffers[range].Clear();
+		Record(begin, end, m_Buffers[range], m_Fallbacks[range]);
+	});
+
+	auto stop = std::chrono::high_resolution_clock::now();
+
+	for (uint32_t r = 0; r < ranges; r++) {
+		Replay(m_Buffers[r], setup);
+		m_Stats.fallbackDraws += m_Fallbacks[r];
+		m_Stats.commandBytes += (uint32_t)m_Buffers[r].GetSize();
+	}
+	m_Stats.recorders		   = ranges;
+	m_Stats.recordMicroseconds = std::chrono::duration<float, std::micro>(stop - start).count();
+	End();
+}
+
+void RenderQueue::Invalidate() {
+
+	m_Program  = nullptr;
+	m_Material = nullptr;
+	m_Mesh	   = nullptr;
+	m_Texture  = ~0u;
+	m_Pass	   = NO_PASS;
+}
+
+void RenderQueue::End() {
+
+	SetPass(PASS_OPAQUE);
+}
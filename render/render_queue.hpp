@@ -0,0 +1,205 @@
+
+#ifndef _RENDER_QUEUE_HPP
+#define _RENDER_QUEUE_HPP
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <memory/function_ref.hpp>
+#include <render/command_buffer.hpp>
+#include <render/instance_buffer.hpp>
+#include <shader/uniform_buffer.hpp>
+
+class Material;
+class Shader;
+struct Mesh;
+
+/*
+ * Draw Packet struct
+ * Everything needed to issue one draw, plus the 64 bit key it sorts on.
+ * Opaque keys put state first, most expensive switch first, and depth last:
+ *   pass:2 | program:10 | texture:16 | material:12 | depth:24
+ * Transparent keys need strict back to front, so inverted depth leads:
+ *   pass:2 | ~depth:24 | program:10 | texture:16 | material:12
+ * Programs, textures and materials go in as dense ids numbered per frame,
+ * not GL names or pointers, so they only run out of bits past that many
+ * distinct ones in a frame.
+ */
+
+struct DrawPacket {
+	uint64_t		 key;
+	const Mesh*		 mesh;
+	Material*		 material;
+	const glm::mat4* model;
+	glm::vec4		 color;	  // Per instance tint when drawn instanced
+	int32_t			 subMesh; // -1 for the whole mesh
+	uint32_t		 object;  // Caller's index, passed through untouched
+	intptr_t		 drawData; // DrawData offset in the frame's ring segment
+};
+
+/*
+ * Render Queue class
+ * Collects the frame's draws, radix sorts them on their keys and submits
+ * them in an order that keeps glUseProgram, Material::Attach and texture
+ * binds to the minimum. Opaque draws go front to back for early-Z, the
+ * transparent pass back to front with blending.
+ * Runs of packets with the same mesh and material are merged into one
+ * instanced draw when the material has an instanced shader.
+ * Shaders with a DrawData block get their transform and tint from the
+ * frame's uniform ring, written once after sorting and bound per draw
+ * with glBindBufferRange, instead of a glUniform call per draw.
+ * Packets whose shader is still compiling are drawn with the fallback
+ * shader and no material, or skipped when there is none.
+ * Execute records the sorted draws into command buffers in parallel,
+ * one per ParallelFor range, and replays them in order on the calling
+ * thread, the only one touching GL.
+ */
+
+class RenderQueue {
+public:
+	enum Pass : uint32_t {
+		PASS_OPAQUE		 = 0,
+		PASS_TRANSPARENT = 1,
+	};
+
+	// Called whenever a new program is bound, to set per frame uniforms. May be empty.
+	using SetupFunc = FunctionRef<void(Shader* shader)>;
+	// Picks the packets Execute draws by their object. May be empty, for all of them.
+	using FilterFunc = FunctionRef<bool(uint32_t object)>;
+
+	struct StateChanges {
+		uint32_t programs;
+		uint32_t materials;
+		uint32_t textures;
+		uint32_t meshes;
+	};
+
+	struct Stats {
+		uint32_t	 packets;
+		uint32_t	 transparent;
+		uint32_t	 draws;			 // Draw calls issued, instanced ones included
+		uint32_t	 instancedDraws;
+		uint32_t	 instances;		 // Packets drawn through instancing
+		uint32_t	 fallbackDraws;	 // Drawn with the fallback, their shader not ready
+		float		 sortMicroseconds;
+		StateChanges submitted; // What the submission order would have cost
+		StateChanges executed;	// What the sorted order did cost
+		uint32_t	 recorders;		 // Command buffers recorded in parallel
+		uint32_t	 commandBytes;
+		float		 recordMicroseconds;
+		uint32_t	 keyOverflows;	 // Packets whose ids did not fit their key fields, grouped less well
+	};
+
+	// Shorter runs are cheaper drawn one by one than re-pointing the instance stream.
+	static const uint32_t MIN_INSTANCES = 2;
+	// Draws and batches per command buffer at least, below that recording is not worth a job.
+	static const uint32_t MIN_RECORD_ITEMS = 512;
+
+private:
+	struct Batch {
+		uint32_t start; // Into the sorted order
+		uint32_t count;
+		uint32_t firstInstance;
+	};
+
+	// One draw in sorted order, a batch or a single packet.
+	struct Item {
+		uint32_t start; // Into the sorted order
+		int32_t	 batch; // -1 for a single packet
+	};
+
+	std::vector<DrawPacket> m_Packets;
+	std::vector<uint32_t>	m_Order;
+	std::vector<uint64_t>	m_Keys;
+	std::vector<uint64_t>	m_KeyScratch;
+	std::vector<uint32_t>	m_OrderScratch;
+
+	// Hands out ids in first use order, starting over every frame. Entries
+	// for values not seen in a while are dropped once they outnumber the
+	// live ones, so destroyed materials do not pile up.
+	struct KeyIds {
+		struct Entry {
+			uint32_t id;
+			uint32_t frame;
+		};
+
+		std::unordered_map<uintptr_t, Entry> ids;
+		uint32_t							 next  = 0;
+		uint32_t							 frame = 0;
+
+		void	 Reset();
+		uint32_t Get(uintptr_t value);
+	};
+
+	KeyIds m_ProgramIds;
+	KeyIds m_TextureIds;
+	KeyIds m_MaterialIds;
+
+	InstanceBuffer	   m_Instances;
+	UniformRing		   m_DrawData;
+	std::vector<Batch> m_Batches;
+	std::vector<Item>  m_Items;
+	bool			   m_Instancing = true;
+	Shader*			   m_Fallback	= nullptr;
+
+	std::vector<CommandBuffer> m_Buffers;	// One per recording range
+	std::vector<uint32_t>	   m_Fallbacks; // Fallback draws recorded per range
+
+	glm::vec3 m_Eye;
+	float	  m_InvFar;
+
+	// Bound state while executing
+	Shader*		m_Program  = nullptr;
+	Material*	m_Material = nullptr;
+	const Mesh* m_Mesh	   = nullptr;
+	uint32_t	m_Texture  = ~0u;
+	uint32_t	m_Pass	   = ~0u;
+
+	Stats m_Stats = {};
+
+	uint32_t GetMaterialId(const Material* material);
+
+	static uint32_t GetTextureKey(Material* material);
+	static void		CountChanges(const DrawPacket& previous, const DrawPacket& packet, StateChanges& changes);
+
+	Shader* Resolve(Shader* program) const;
+
+	void SetPass(uint32_t pass);
+	void Bind(Shader* program, Material* material, const SetupFunc& setup);
+	void BuildBatches(const FilterFunc& filter);
+	void Record(uint32_t begin, uint32_t end, CommandBuffer& out, uint32_t& fallbacks) const;
+
+public:
+	// Depth is measured from the eye, normalized by the far plane.
+	void Begin(const glm::vec3& eye, float farPlane);
+	void Submit(Pass pass, const Mesh* mesh, Material* material, const glm::mat4* model, const glm::vec3& center, uint32_t object, int32_t subMesh = -1, const glm::vec4& color = glm::vec4(1.0f));
+	void Sort();
+
+	// Draws every packet in sorted order, or those filter passes, instancing where it can.
+	void Execute(const SetupFunc& setup, const FilterFunc& filter = nullptr);
+
+	// Runs recorded commands, skipping state that is still bound. GL thread only.
+	void Replay(const CommandBuffer& buffer, const SetupFunc& setup);
+
+	// Draws a single packet, skipping state that is still bound from the last one.
+	void Draw(const DrawPacket& packet, const SetupFunc& setup);
+	// Forgets the bound state, for when something else has drawn since.
+	void Invalidate();
+	void End();
+
+	// Drawn with in place of shaders that are not ready yet. Needs no material uniforms.
+	void SetFallback(Shader* fallback) { m_Fallback = fallback; }
+
+	// Off draws every packet on its own, for comparison.
+	void SetInstancing(bool enabled) { m_Instancing = enabled; }
+
+	// Packet indices in sorted order.
+	const std::vector<uint32_t>&   GetOrder() const { return m_Order; }
+	const std::vector<DrawPacket>& GetPackets() const { return m_Packets; }
+
+	const Stats& GetStats() const { return m_Stats; }
+};
+
+#endif /* _RENDER_QUEUE_HPP */
@@ -0,0 +1,192 @@
+#include "render_thread.hpp"
+
+#include <chrono>
+#include <stdexcept>
+
+using hr_clock = std::chrono::high_resolution_clock;
+
+void RenderThread::Main(Command init, Command exit) {
+
+	try {
+		init();
+
+		Command	 command;
+		uint32_t spins = 0;
+		auto	 idle  = hr_clock::now();
+		while (true) {
+			if (m_Ring.Pop(command)) {
+				if (spins) {
+					auto micros = std::chrono::duration_cast<std::chrono::microseconds>(hr_clock::now() - idle).count();
+					m_IdleMicroseconds.fetch_add((uint64_t)micros, std::memory_order_relaxed);
+					spins = 0;
+				}
+				command();
+				command = nullptr;
+				continue;
+			}
+			if (m_Quit.load()) {
+				// Everything submitted before Stop is visible once it is.
+				while (m_Ring.Pop(command)) {
+					command();
+				}
+				break;
+			}
+			if (!spins++) {
+				idle = hr_clock::now();
+			}
+			if (spins < IDLE_SPINS) {
+				std::this_thread::yield();
+				continue;
+			}
+
+			// Submit fences between its push and reading m_Sleeping, so either it sees
+			// this thread asleep and notifies, or the predicate sees the command.
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Sleeping.fetch_add(1);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			m_Wake.wait(lock, [&] { return !m_Ring.IsEmpty() || m_Quit.load(); });
+			m_Sleeping.fetch_sub(1);
+		}
+	} catch (...) {
+		m_Error = std::current_exception();
+	}
+
+	try {
+		exit();
+	} catch (...) {
+		if (!m_Error) {
+			m_Error = std::current_exception();
+		}
+	}
+
+	if (m_Error) {
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Failed.store(true);
+		m_Done.notify_all();
+	}
+}
+
+void RenderThread::WaitFor(const std::atomic<uint64_t>& counter, uint64_t value) {
+
+	if (counter.load(std::memory_order_acquire) < value) {
+		auto start = hr_clock::now();
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Done.wait(lock, [&] { return counter.load(std::memory_order_acquire) >= value || m_Failed.load(); });
+		}
+		m_Stats.waitMilliseconds += std::chrono::duration<float, std::milli>(hr_clock::now() - start).count();
+	}
+	if (m_Failed.load()) {
+		std::rethrow_exception(m_Error);
+	}
+}
+
+void RenderThread::Start(Command init, Command exit) {
+
+#ifndef NDEBUG
+	if (IsRunning()) {
+		throw std::runtime_error("RTHR::RUNNING");
+	}
+#endif
+
+	m_Submitted = 0;
+	m_Synced	= 0;
+	m_Completed.store(0);
+	m_Reached.store(0);
+	m_Error = nullptr;
+	m_Failed.store(false);
+	m_Quit.store(false);
+
+	m_Thread = std::thread(&RenderThread::Main, this, std::move(init), std::move(exit));
+}
+
+void RenderThread::Stop() {
+
+	if (!IsRunning()) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Quit.store(true);
+	}
+	m_Wake.notify_all();
+	m_Thread.join();
+
+	if (m_Error) {
+		std::exception_ptr error = m_Error;
+		m_Error					 = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+void RenderThread::Submit(Command command) {
+
+#ifndef NDEBUG
+	if (!IsRunning()) {
+		throw std::runtime_error("RTHR::NOT_RUNNING");
+	}
+#endif
+
+	// Full means the render thread is busy, it frees a slot per command.
+	while (!m_Ring.Push(std::move(command))) {
+		if (m_Failed.load()) {
+			std::rethrow_exception(m_Error);
+		}
+		std::this_thread::yield();
+	}
+
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_Sleeping.load(std::memory_order_relaxed)) {
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Wake.notify_one();
+	}
+}
+
+void RenderThread::EndFrame() {
+
+	Submit([this]() {
+		m_Completed.fetch_add(1, std::memory_order_release);
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Done.notify_all();
+	});
+
+	m_Submitted++;
+	if (m_Submitted > FRAMES_AHEAD) {
+		WaitFor(m_Completed, m_Submitted - FRAMES_AHEAD);
+	}
+}
+
+void RenderThread::Sync() {
+
+	uint64_t point = ++m_Synced;
+	Submit([this, point]() {
+		m_Reached.store(point, std::memory_order_release);
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Done.notify_all();
+	});
+	WaitFor(m_Reached, point);
+}
+
+RenderThread::Stats RenderThread::GetStats() const {
+
+	Stats stats			   = m_Stats;
+	stats.frames		   = (uint32_t)(m_Completed.load(std::memory_order_relaxed) - m_FramesAtReset);
+	stats.idleMilliseconds = m_IdleMicroseconds.load(std::memory_order_relaxed) / 1000.0f;
+	return stats;
+}
+
+void RenderThread::ResetStats() {
+
+	m_Stats			= {};
+	m_FramesAtReset = m_Completed.load(std::memory_order_relaxed);
+	m_IdleMicroseconds.store(0, std::memory_order_relaxed);
+}
+
+// Does not throw, an error still pending is dropped.
+RenderThread::~RenderThread() {
+
+	try {
+		Stop();
+	} catch (...) {
+	}
+}
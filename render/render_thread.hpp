@@ -0,0 +1,95 @@
+
+#ifndef _RENDER_THREAD_HPP
+#define _RENDER_THREAD_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include <render/spsc_ring.hpp>
+
+/*
+ * Render Thread class
+ * Runs commands on a thread of its own that owns the GL context, in the
+ * order they were submitted. Commands go through a lock-free ring from
+ * the one thread submitting them; the render thread only sleeps once the
+ * ring has been empty for a while, and submitting only takes a lock to
+ * wake it.
+ * Frames are delimited by EndFrame, which lets the submitting thread run
+ * at most one frame ahead: it simulates frame N + 1 while frame N draws.
+ * Anything a command reads must be left alone until its frame finished.
+ * An exception thrown by a command stops the thread and is rethrown by
+ * the next EndFrame, Sync or Stop.
+ */
+
+class RenderThread {
+public:
+	using Command = std::function<void()>;
+
+	struct Stats {
+		uint32_t frames;			// Finished by the render thread
+		float	 waitMilliseconds;	// Submitting thread blocked on the render thread
+		float	 idleMilliseconds;	// Render thread waiting for commands
+	};
+
+private:
+	static const uint32_t RING_SIZE	   = 256;
+	static const uint32_t FRAMES_AHEAD = 1;  // Frames submitted and not finished at most, besides the one being built
+	static const uint32_t IDLE_SPINS   = 64; // Empty polls before the render thread sleeps
+
+	SpscRing<Command, RING_SIZE> m_Ring;
+	std::thread					 m_Thread;
+
+	std::atomic<uint32_t>	m_Sleeping{ 0 };
+	std::atomic<bool>		m_Quit{ false };
+	std::mutex				m_Mutex;
+	std::condition_variable m_Wake; // Render thread, commands queued
+	std::condition_variable m_Done; // Submitting thread, a frame or sync finished
+
+	uint64_t			  m_Submitted = 0; // Frames ended, submitting thread only
+	std::atomic<uint64_t> m_Completed{ 0 };
+	uint64_t			  m_Synced = 0;
+	std::atomic<uint64_t> m_Reached{ 0 }; // Last sync point run
+
+	std::exception_ptr m_Error; // Set by the render thread before it stops
+	std::atomic<bool>  m_Failed{ false };
+
+	Stats				  m_Stats		  = {};
+	uint64_t			  m_FramesAtReset = 0;
+	std::atomic<uint64_t> m_IdleMicroseconds{ 0 };
+
+	void Main(Command init, Command exit);
+	void WaitFor(const std::atomic<uint64_t>& counter, uint64_t value);
+
+public:
+	// Runs init first thing on the new thread, making the context current, and exit last.
+	void Start(Command init, Command exit);
+
+	// Runs the remaining commands, then joins the thread.
+	void Stop();
+
+	bool IsRunning() const { return m_Thread.joinable(); }
+
+	// Queues a command, spinning while the ring is full.
+	void Submit(Command command);
+
+	// Ends the frame submitted since the last call, waits while the previous one has not finished.
+	void EndFrame();
+
+	// Waits until everything submitted so far has run.
+	void Sync();
+
+	Stats GetStats() const;
+	void  ResetStats();
+
+	RenderThread() {}
+	RenderThread(const RenderThread&) = delete;
+	RenderThread& operator=(const RenderThread&) = delete;
+	~RenderThread();
+};
+
+#endif /* _RENDER_THREAD_HPP */
@@ -0,0 +1,55 @@
+
+#ifndef _SPSC_RING_HPP
+#define _SPSC_RING_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+/*
+ * SPSC Ring class
+ * Fixed size lock-free queue for exactly one producer and one consumer
+ * thread. The producer only writes the tail and the consumer only the
+ * head, each publishing its slots with a release store. Size must be a
+ * power of two.
+ */
+
+template <typename T, uint32_t Size>
+class SpscRing {
+	static_assert(Size && !(Size & (Size - 1)), "SpscRing size must be a power of two");
+
+	// Padded apart, the producer and the consumer each hammer one of them.
+	std::atomic<uint32_t> m_Head{ 0 };
+	uint8_t				  m_HeadPad[64];
+	std::atomic<uint32_t> m_Tail{ 0 };
+	uint8_t				  m_TailPad[64];
+	T					  m_Items[Size];
+
+public:
+	// Producer only. False when full.
+	bool Push(T&& item) {
+		uint32_t tail = m_Tail.load(std::memory_order_relaxed);
+		if (tail - m_Head.load(std::memory_order_acquire) == Size) {
+			return false;
+		}
+		m_Items[tail & (Size - 1)] = std::move(item);
+		m_Tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer only. False when empty.
+	bool Pop(T& item) {
+		uint32_t head = m_Head.load(std::memory_order_relaxed);
+		if (head == m_Tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+		item = std::move(m_Items[head & (Size - 1)]);
+		m_Items[head & (Size - 1)] = T();
+		m_Head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool IsEmpty() const { return m_Head.load(std::memory_order_acquire) == m_Tail.load(std::memory_order_acquire); }
+};
+
+#endif /* _SPSC_RING_HPP */
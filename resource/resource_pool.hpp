@@ -0,0 +1,135 @@
+
+#ifndef _RESOURCE_POOL_HPP
+#define _RESOURCE_POOL_HPP
+
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * Resource Pool class
+ * Slots for resources in pages of PageSize, so a resource never moves
+ * and raw pointers to it stay valid until it is released, while
+ * walking the pool touches memory in order. A resource is named by a
+ * 32 bit handle: the slot index and the generation of the slot, which
+ * is bumped on every create and release, so a handle to a released
+ * resource no longer resolves even once its slot is reused. Generations
+ * wrap after 2048 reuses of one slot. Handle 0 never resolves.
+ * Not thread safe.
+ */
+
+template <typename T, uint32_t PageSize = 64>
+class ResourcePool {
+	static_assert(PageSize && !(PageSize & (PageSize - 1)), "ResourcePool page size must be a power of two");
+
+public:
+	struct Handle {
+		uint32_t value = 0;
+
+		bool operator==(Handle other) const { return value == other.value; }
+		bool operator!=(Handle other) const { return value != other.value; }
+		explicit operator bool() const { return value != 0; }
+	};
+
+	static const uint32_t INDEX_BITS	  = 20;
+	static const uint32_t INDEX_MASK	  = (1u << INDEX_BITS) - 1;
+	static const uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+private:
+	typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Slot;
+
+	std::vector<std::unique_ptr<Slot[]>> m_Pages;
+	std::vector<uint32_t>				 m_Generations; // Per slot, odd while live
+	std::vector<uint32_t>				 m_Free;
+	uint32_t							 m_Count = 0; // Live resources
+
+	T* At(uint32_t index) const {
+		return reinterpret_cast<T*>(&m_Pages[index / PageSize][index & (PageSize - 1)]);
+	}
+
+public:
+	// Constructs in place, braces so aggregates with const members work.
+	template <typename... Args>
+	Handle Create(Args&&... args) {
+		uint32_t index;
+		if (!m_Free.empty()) {
+			index = m_Free.back();
+			m_Free.pop_back();
+		} else {
+			index = (uint32_t)m_Generations.size();
+#ifndef NDEBUG
+			if (index > INDEX_MASK) {
+				throw std::runtime_error("POOL::FULL");
+			}
+#endif
+			if (index / PageSize == m_Pages.size()) {
+				m_Pages.emplace_back(new Slot[PageSize]);
+			}
+			m_Generations.push_back(0);
+		}
+
+		new (At(index)) T{ std::forward<Args>(args)... };
+		uint32_t generation = ++m_Generations[index];
+		m_Count++;
+		return { index | (generation & GENERATION_MASK) << INDEX_BITS };
+	}
+
+	// Null when the handle was released or never valid.
+	T* Get(Handle handle) const {
+		uint32_t index = handle.value & INDEX_MASK;
+		if (index >= m_Generations.size() || ((m_Generations[index] & GENERATION_MASK) != handle.value >> INDEX_BITS) || !(m_Generations[index] & 1)) {
+			return nullptr;
+		}
+		return At(index);
+	}
+
+	bool IsValid(Handle handle) const { return Get(handle) != nullptr; }
+
+	// Destroys the resource, its handle and pointers to it go stale. False when already released.
+	bool Release(Handle handle) {
+		T* resource = Get(handle);
+		if (!resource) {
+			return false;
+		}
+		uint32_t index = handle.value & INDEX_MASK;
+		resource->~T();
+		m_Generations[index]++;
+		m_Free.push_back(index);
+		m_Count--;
+		return true;
+	}
+
+	// Live resources in slot order.
+	template <typename Func>
+	void ForEach(Func func) const {
+		for (uint32_t index = 0; index < m_Generations.size(); index++) {
+			if (m_Generations[index] & 1) {
+				func(*At(index));
+			}
+		}
+	}
+
+	void Clear() {
+		for (uint32_t index = 0; index < m_Generations.size(); index++) {
+			if (m_Generations[index] & 1) {
+				At(index)->~T();
+				m_Generations[index]++;
+				m_Free.push_back(index);
+			}
+		}
+		m_Count = 0;
+	}
+
+	uint32_t GetCount() const { return m_Count; }
+
+	ResourcePool() {}
+	ResourcePool(const ResourcePool&) = delete;
+	ResourcePool& operator=(const ResourcePool&) = delete;
+	~ResourcePool() { Clear(); }
+};
+
+#endif /* _RESOURCE_POOL_HPP */
@@ -0,0 +1,171 @@
+#include "preprocessor.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+// Directive keyword of a line, empty when the line is not a directive. rest points past the keyword.
+static std::string GetDirective(const std::string& line, size_t& rest) {
+
+	size_t i = line.find_first_not_of(" \t");
+	if (i == std::string::npos || line[i] != '#') {
+		return "";
+	}
+	i = line.find_first_not_of(" \t", i + 1);
+	if (i == std::string::npos) {
+		return "";
+	}
+	size_t end = line.find_first_of(" \t", i);
+	rest	   = end == std::string::npos ? line.size() : end;
+	return line.substr(i, rest - i);
+}
+
+static std::string GetWord(const std::string& line, size_t from) {
+
+	size_t i = line.find_first_not_of(" \t", from);
+	if (i == std::string::npos) {
+		return "";
+	}
+	size_t end = line.find_first_of(" \t/", i);
+	return line.substr(i, end == std::string::npos ? std::string::npos : end - i);
+}
+
+const ShaderPreprocessor::File& ShaderPreprocessor::Read(const std::string& path) {
+
+	auto it = m_Files.find(path);
+	if (it != m_Files.end()) {
+		return it->second;
+	}
+
+	std::ifstream stream(path);
+	if (!stream) {
+		throw std::runtime_error("SHDR_PREP::" + path + "_NOT_FOUND");
+	}
+
+	File file = { {}, "", false, 0 };
+
+	auto known = std::find(m_Order.begin(), m_Order.end(), path);
+	file.index = (uint32_t)(known - m_Order.begin());
+	if (known == m_Order.end()) {
+		m_Order.push_back(path);
+	}
+
+	// The guard is an #ifndef X directly followed by #define X, before anything else.
+	std::string line;
+	std::string candidate;
+	bool		leading = true;
+	while (std::getline(stream, line)) {
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+
+		size_t		rest;
+		std::string directive = GetDirective(line, rest);
+		if (directive == "pragma" && GetWord(line, rest) == "once") {
+			file.once = true;
+			file.lines.push_back("");
+			continue;
+		}
+		if (leading) {
+			if (directive == "ifndef" && candidate.empty()) {
+				candidate = GetWord(line, rest);
+			} else if (directive == "define" && !candidate.empty()) {
+				if (GetWord(line, rest) == candidate) {
+					file.guard = candidate;
+				}
+				leading = false;
+			} else if (line.find_first_not_of(" \t") != std::string::npos && line.compare(line.find_first_not_of(" \t"), 2, "//")) {
+				leading = false;
+			}
+		}
+		file.lines.push_back(line);
+	}
+
+	return m_Files[path] = std::move(file);
+}
+
+void ShaderPreprocessor::Expand(const std::string& path, Context& context, uint32_t depth) {
+
+	if (depth > MAX_DEPTH) {
+		throw std::runtime_error("SHDR_PREP::" + path + "_INCLUDE_DEPTH");
+	}
+
+	const File& file = Read(path);
+	if (file.once || !file.guard.empty()) {
+		if (std::find(context.included.begin(), context.included.end(), path) != context.included.end()) {
+			return;
+		}
+		if (!context.conditional) {
+			context.included.push_back(path);
+		}
+	}
+	if (context.dependencies && std::find(context.dependencies->begin(), context.dependencies->end(), path) == context.dependencies->end()) {
+		context.dependencies->push_back(path);
+	}
+
+	const std::string directory = path.substr(0, path.find_last_of('/') + 1);
+	const std::string source	= std::to_string(file.index);
+	std::string&	  out		= context.out;
+
+	// Nothing may come before #version, so the root file's line numbering starts after it.
+	bool versioned = depth > 0;
+	if (versioned) {
+		out += "#line 1 " + source + "\n";
+	}
+
+	for (size_t i = 0; i < file.lines.size(); i++) {
+		const std::string& line = file.lines[i];
+
+		size_t		rest;
+		std::string directive = GetDirective(line, rest);
+
+		if (directive == "include") {
+			size_t open	 = line.find('"', rest);
+			size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+			if (close == std::string::npos) {
+				throw std::runtime_error("SHDR_PREP::" + path + "::" + std::to_string(i + 1) + "_BAD_INCLUDE");
+			}
+			Expand(directory + line.substr(open + 1, close - open - 1), context, depth + 1);
+			out += "#line " + std::to_string(i + 2) + " " + source + "\n";
+			continue;
+		}
+
+		if (directive == "if" || directive == "ifdef" || directive == "ifndef") {
+			context.conditional++;
+		} else if (directive == "endif" && context.conditional) {
+			context.conditional--;
+		}
+
+		out += line;
+		out += '\n';
+
+		if (!versioned && directive == "version") {
+			for (const std::string& define : *context.defines) {
+				out += "#define " + define + "\n";
+			}
+			out += "#line " + std::to_string(i + 2) + " " + source + "\n";
+			versioned = true;
+		}
+	}
+
+	// No #version at all, defines still have to go in.
+	if (!versioned && depth == 0 && !context.defines->empty()) {
+		std::string defines;
+		for (const std::string& define : *context.defines) {
+			defines += "#define " + define + "\n";
+		}
+		out = defines + "#line 1 " + source + "\n" + out;
+	}
+}
+
+std::string ShaderPreprocessor::Process(const std::string& path, const std::vector<std::string>& defines, std::vector<std::string>* dependencies) {
+
+	Context context = { &defines, {}, 0, dependencies, "" };
+	Expand(path, context, 0);
+	return std::move(context.out);
+}
+
+void ShaderPreprocessor::Invalidate(const std::string& path) {
+
+	m_Files.erase(path);
+}
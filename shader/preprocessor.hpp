@@ -0,0 +1,59 @@
+
+#ifndef _PREPROCESSOR_HPP
+#define _PREPROCESSOR_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Shader Preprocessor class
+ * Expands #include "path" in GLSL, relative to the including file, and
+ * injects #defines right after #version. Everything else is left to the
+ * driver's preprocessor.
+ * Files are read once and kept. A file with #pragma once, or wrapped
+ * in an #ifndef/#define guard, is not expanded again once it has been
+ * outside of any #if, where it cannot have been compiled out.
+ * #line directives keep the driver's errors
+ * pointing at the right file and line, files are numbered in the order
+ * Process first met them, see GetFiles.
+ */
+
+class ShaderPreprocessor {
+	struct File {
+		std::vector<std::string> lines;
+		std::string				 guard; // Include guard macro, empty if none
+		bool					 once;	// #pragma once
+		uint32_t				 index; // Source string number in #line
+	};
+
+	// State of one Process call.
+	struct Context {
+		const std::vector<std::string>* defines;
+		std::vector<std::string>		included;	 // Guarded files expanded outside any #if
+		uint32_t						conditional; // #if nesting of the line being emitted
+		std::vector<std::string>*		dependencies;
+		std::string						out;
+	};
+
+	static const uint32_t MAX_DEPTH = 32;
+
+	std::unordered_map<std::string, File> m_Files;
+	std::vector<std::string>			  m_Order; // Path of each file index
+
+	const File& Read(const std::string& path);
+	void		Expand(const std::string& path, Context& context, uint32_t depth);
+
+public:
+	// Preprocessed source of the file. Paths of every file it pulled in, itself included, go into dependencies.
+	std::string Process(const std::string& path, const std::vector<std::string>& defines, std::vector<std::string>* dependencies = nullptr);
+
+	// Drops a file from the cache, so the next Process reads it again.
+	void Invalidate(const std::string& path);
+
+	// File paths, by their #line source string number.
+	const std::vector<std::string>& GetFiles() const { return m_Order; }
+};
+
+#endif /* _PREPROCESSOR_HPP */
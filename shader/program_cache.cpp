@@ -0,0 +1,192 @@
+#include "program_cache.hpp"
+#include <glstate/glstate.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+// ARB_get_program_binary, absent from the 3.3 glad profile.
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+static const uint32_t CACHE_MAGIC	= 0x4E494250; // "PBIN"
+static const uint32_t CACHE_VERSION = 1;
+
+static uint64_t Hash(uint64_t hash, const void* data, size_t size) {
+
+	// FNV-1a
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+static uint64_t Hash(uint64_t hash, const char* string) {
+
+	// Strings are terminated in the hash too, so "ab"+"c" differs from "a"+"bc".
+	return string ? Hash(hash, string, std::strlen(string) + 1) : hash;
+}
+
+bool ProgramCache::Init(const std::string& directory, GLADloadproc load) {
+
+	m_Directory = directory;
+	m_Enabled	= false;
+
+	GLint major = 0;
+	GLint minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+
+	bool supported = major > 4 || (major == 4 && minor >= 1);
+	if (!supported) {
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count && !supported; i++) {
+			const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+			supported			  = extension && !std::strcmp(extension, "GL_ARB_get_program_binary");
+		}
+	}
+	if (!supported) {
+		return false;
+	}
+
+	m_GetProgramBinary	= (GetProgramBinaryProc)load("glGetProgramBinary");
+	m_ProgramBinary		= (ProgramBinaryProc)load("glProgramBinary");
+	m_ProgramParameteri = (ProgramParameteriProc)load("glProgramParameteri");
+	if (!m_GetProgramBinary || !m_ProgramBinary || !m_ProgramParameteri) {
+		return false;
+	}
+
+	// Drivers may support the extension with no formats, which means no binaries.
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if (formats <= 0) {
+		return false;
+	}
+
+	m_DriverHash = 14695981039346656037ull;
+	m_DriverHash = Hash(m_DriverHash, (const char*)glGetString(GL_VENDOR));
+	m_DriverHash = Hash(m_DriverHash, (const char*)glGetString(GL_RENDERER));
+	m_DriverHash = Hash(m_DriverHash, (const char*)glGetString(GL_VERSION));
+	m_Enabled	 = true;
+	return true;
+}
+
+uint64_t ProgramCache::GetKey(const std::vector<std::string>& sources) const {
+
+	uint64_t hash = m_DriverHash;
+	for (const std::string& source : sources) {
+		hash = Hash(hash, source.c_str());
+	}
+	return hash;
+}
+
+std::string ProgramCache::GetPath(uint64_t key) const {
+
+	std::stringstream path;
+	path << m_Directory << '/' << std::hex << key << ".bin";
+	return path.str();
+}
+
+void ProgramCache::PrepareLink(GLuint program) const {
+
+	if (m_Enabled) {
+		m_ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+}
+
+GLuint ProgramCache::Load(uint64_t key) {
+
+	if (!m_Enabled) {
+		m_Stats.misses++;
+		return 0;
+	}
+
+	std::ifstream file(GetPath(key), std::ios::binary);
+	if (!file) {
+		m_Stats.misses++;
+		return 0;
+	}
+
+	uint32_t magic;
+	uint32_t version;
+	uint64_t storedKey;
+	GLenum	 format;
+	GLsizei	 length;
+	float	 compileMilliseconds;
+	file.read((char*)&magic, sizeof(magic));
+	file.read((char*)&version, sizeof(version));
+	file.read((char*)&storedKey, sizeof(storedKey));
+	file.read((char*)&format, sizeof(format));
+	file.read((char*)&length, sizeof(length));
+	file.read((char*)&compileMilliseconds, sizeof(compileMilliseconds));
+	if (!file || magic != CACHE_MAGIC || version != CACHE_VERSION || storedKey != key || length <= 0) {
+		m_Stats.misses++;
+		return 0;
+	}
+
+	std::vector<char> binary(length);
+	file.read(binary.data(), length);
+	if (!file) {
+		m_Stats.misses++;
+		return 0;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	GLuint program = glCreateProgram();
+	m_ProgramBinary(program, format, binary.data(), length);
+
+	GLint success;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success) {
+		// Format no longer accepted, the caller recompiles and overwrites the entry.
+		GLState::DeleteProgram(program);
+		m_Stats.rejected++;
+		return 0;
+	}
+
+	auto  stop		   = std::chrono::high_resolution_clock::now();
+	float milliseconds = std::chrono::duration<float, std::milli>(stop - start).count();
+
+	m_Stats.hits++;
+	m_Stats.loadMilliseconds += milliseconds;
+	m_Stats.savedMilliseconds += compileMilliseconds - milliseconds;
+	return program;
+}
+
+void ProgramCache::Store(uint64_t key, GLuint program, float compileMilliseconds) {
+
+	m_Stats.compileMilliseconds += compileMilliseconds;
+	if (!m_Enabled) {
+		return;
+	}
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return;
+	}
+
+	GLenum			  format;
+	std::vector<char> binary(length);
+	m_GetProgramBinary(program, length, &length, &format, binary.data());
+
+	std::ofstream file(GetPath(key), std::ios::binary);
+	if (!file) {
+		return;
+	}
+	file.write((const char*)&CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	file.write((const char*)&CACHE_VERSION, sizeof(CACHE_VERSION));
+	file.write((const char*)&key, sizeof(key));
+	file.write((const char*)&format, sizeof(format));
+	file.write((const char*)&length, sizeof(length));
+	file.write((const char*)&compileMilliseconds, sizeof(compileMilliseconds));
+	file.write(binary.data(), length);
+}
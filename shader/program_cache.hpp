@@ -0,0 +1,70 @@
+
+#ifndef _PROGRAM_CACHE_HPP
+#define _PROGRAM_CACHE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+/*
+ * Program Cache class
+ * Keeps linked program binaries on disk so later launches can skip
+ * compiling and linking. Entries are keyed on a hash of the shader
+ * sources and the driver's vendor, renderer and version strings, so a
+ * driver update or an edited source just misses.
+ * glGetProgramBinary is GL 4.1 or ARB_get_program_binary, not part of
+ * the 3.3 glad profile, so the entry points are loaded by hand. Without
+ * them the cache stays disabled and every program compiles from source.
+ * Each entry also records how long its compile took, which is what a
+ * hit saves.
+ */
+
+class ProgramCache {
+public:
+	struct Stats {
+		uint32_t hits;
+		uint32_t misses;
+		uint32_t rejected;			 // Binaries the driver refused, recompiled
+		float	 loadMilliseconds;	 // Spent loading binaries
+		float	 compileMilliseconds; // Spent compiling on misses
+		float	 savedMilliseconds;	 // Recorded compile time of the hits, minus loading them
+	};
+
+private:
+	typedef void(APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+	typedef void(APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+	typedef void(APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+	GetProgramBinaryProc  m_GetProgramBinary  = nullptr;
+	ProgramBinaryProc	  m_ProgramBinary	  = nullptr;
+	ProgramParameteriProc m_ProgramParameteri = nullptr;
+
+	std::string m_Directory;
+	uint64_t	m_DriverHash = 0;
+	bool		m_Enabled	 = false;
+
+	Stats m_Stats = {};
+
+	std::string GetPath(uint64_t key) const;
+
+public:
+	// Loads the entry points through the context's loader, false when binaries are unsupported.
+	bool Init(const std::string& directory, GLADloadproc load);
+	bool IsEnabled() const { return m_Enabled; }
+
+	// Hash of the sources, any defines folded in, and the driver.
+	uint64_t GetKey(const std::vector<std::string>& sources) const;
+
+	// Must be called before linking for the binary to be retrievable.
+	void PrepareLink(GLuint program) const;
+
+	// Creates the program from the cached binary, 0 when missing or rejected.
+	GLuint Load(uint64_t key);
+	void   Store(uint64_t key, GLuint program, float compileMilliseconds);
+
+	const Stats& GetStats() const { return m_Stats; }
+};
+
+#endif /* _PROGRAM_CACHE_HPP */
@@ -0,0 +1,51 @@
+
+#ifndef _REFLECTION_HPP
+#define _REFLECTION_HPP
+
+#include <cstdint>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <shader/uniform_id.hpp>
+
+/*
+ * Shader Reflection descriptors
+ * What shader/generated/shader_reflection.hpp is made of. The build
+ * parses the GLSL under assets/shaders and emits one namespace per
+ * shader in ShaderReflection, with a constexpr descriptor for each
+ * attribute and uniform, and a struct per uniform block laid out and
+ * checked to std140:
+ *   material->Set(ShaderReflection::scene::alpha, 0.4f);
+ * The uniform's type is part of the descriptor, so setting it to the
+ * wrong type does not compile, and its id is hashed at compile time.
+ */
+
+template <typename T>
+struct ShaderUniform {
+	typedef T Type;
+
+	UniformId	id;
+	GLenum		type;
+	const char* name;
+};
+
+struct ShaderSampler {
+	UniformId	id;
+	GLenum		type;
+	const char* name;
+};
+
+struct ShaderAttribute {
+	GLuint		location;
+	GLenum		type;
+	const char* name;
+};
+
+// Element of a std140 array whose type is smaller than the 16 byte array stride.
+template <typename T>
+struct Std140Element {
+	T		value;
+	uint8_t pad[(sizeof(T) + 15) / 16 * 16 - sizeof(T)];
+};
+
+#endif /* _REFLECTION_HPP */
@@ -1,173 +1,103 @@
 #include "shader.hpp"
 #include <glad/glad.h>
+#include <glstate/glstate.hpp>
+#include <shader/program_cache.hpp>
+#include <shader/uniform_buffer.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <sstream>
 #include <vector>
 
-// Shader constructor without geometry shader
-Shader::Shader(const std::string& name, const std::string& vertexShaderPath, const std::string& fragShaderPath) :
-		m_Name(name) {
-
-	std::string  vertexCode;
-	std::string  fragmentCode;
-	std::fstream vShaderFile;
-	std::fstream fShaderFile;
-
-	vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-	// Open files.
-	try {
-		vShaderFile.open(vertexShaderPath, std::ios::in);
-		fShaderFile.open(fragShaderPath, std::ios::in);
+// KHR_parallel_shader_compile, absent from the 3.3 glad profile.
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
 
-		std::stringstream vShaderStream;
-		std::stringstream fShaderStream;
+// Shader constructor
+Shader::Shader(const std::string& name, const std::vector<ShaderSource>& sources, ProgramCache* cache) :
+		m_Name(name) {
 
-		vShaderStream << vShaderFile.rdbuf();
-		fShaderStream << fShaderFile.rdbuf();
+	Submit(sources, cache);
+}
 
-		vShaderFile.close();
-		fShaderFile.close();
+// Takes the program from the binary cache when it can, queues the compile and link otherwise.
+void Shader::Submit(const std::vector<ShaderSource>& sources, ProgramCache* cache) {
 
-		vertexCode   = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
-	} catch (std::fstream::failure e) {
-		throw std::runtime_error("SHADER_" + m_Name + "::" + std::string(e.what()));
+	if (cache) {
+		std::vector<std::string> code;
+		for (const ShaderSource& source : sources) {
+			code.push_back(source.code);
+		}
+		m_CacheKey = cache->GetKey(code);
+		m_Shader   = cache->Load(m_CacheKey);
+		if (m_Shader) {
+			IntrospectShader();
+			m_Ready = true;
+			return;
+		}
 	}
-	const char* vShaderCode = vertexCode.c_str();
-	const char* fShaderCode = fragmentCode.c_str();
-
-	GLint success;
-	char  infoLog[512];
 
-	// Compile Vertex Shader
-	GLuint vShaderIdx = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vShaderIdx, 1, &vShaderCode, nullptr);
-	glCompileShader(vShaderIdx);
-
-	glGetShaderiv(vShaderIdx, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		glGetShaderInfoLog(vShaderIdx, 512, nullptr, infoLog);
-		throw std::runtime_error("SHADER_" + m_Name + "::VERTEX_COMPILATION" + std::string(infoLog));
-	}
+	m_SubmitTime = std::chrono::high_resolution_clock::now();
 
-	// Compile Fragment Shader
-	GLuint fShaderIdx = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fShaderIdx, 1, &fShaderCode, nullptr);
-	glCompileShader(fShaderIdx);
+	// Any status query would wait for the compile, so none happen until Finish.
+	for (const ShaderSource& source : sources) {
+		const char* code = source.code.c_str();
 
-	glGetShaderiv(fShaderIdx, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		glGetShaderInfoLog(fShaderIdx, 512, nullptr, infoLog);
-		throw std::runtime_error("SHADER_" + m_Name + "::FRAGMENT_COMPILATION::" + std::string(infoLog));
+		GLuint stage = glCreateShader(source.stage);
+		glShaderSource(stage, 1, &code, nullptr);
+		glCompileShader(stage);
+		m_Stages.push_back(stage);
 	}
 
-	// Link the two.
 	m_Shader = glCreateProgram();
-	glAttachShader(m_Shader, vShaderIdx);
-	glAttachShader(m_Shader, fShaderIdx);
-	glLinkProgram(m_Shader);
-
-	glGetProgramiv(m_Shader, GL_LINK_STATUS, &success);
-	if (!success) {
-		glGetProgramInfoLog(m_Shader, 512, nullptr, infoLog);
-		throw std::runtime_error("SHADER_" + m_Name + "::PROGRAM_LINKING::" + std::string(infoLog));
+	for (GLuint stage : m_Stages) {
+		glAttachShader(m_Shader, stage);
 	}
-
-	// Program made, clear out the shader objects.
-	glDeleteShader(vShaderIdx);
-	glDeleteShader(fShaderIdx);
-
-	// Launch Introspection
-	IntrospectShader();
+	if (cache) {
+		cache->PrepareLink(m_Shader);
+	}
+	glLinkProgram(m_Shader);
 }
 
-// Shader constructor with geometry shader
-Shader::Shader(const std::string& name, const std::string& vertexShaderPath, const std::string& geometryShaderPath, const std::string& fragShaderPath) :
-		m_Name(name) {
-
-	std::string  vertexCode;
-	std::string  geometryCode;
-	std::string  fragmentCode;
-	std::fstream vShaderFile;
-	std::fstream gShaderFile;
-	std::fstream fShaderFile;
-
-	vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+// Only meaningful with KHR_parallel_shader_compile, elsewhere the query reads as done.
+bool Shader::IsCompiled() const {
 
-	// Open files.
-	try {
-		vShaderFile.open(vertexShaderPath, std::ios::in);
-		gShaderFile.open(geometryShaderPath, std::ios::in);
-		fShaderFile.open(fragShaderPath, std::ios::in);
-
-		std::stringstream vShaderStream;
-		std::stringstream gShaderStream;
-		std::stringstream fShaderStream;
+	GLint done = GL_TRUE;
+	glGetProgramiv(m_Shader, GL_COMPLETION_STATUS_KHR, &done);
+	return done == GL_TRUE;
+}
 
-		vShaderStream << vShaderFile.rdbuf();
-		gShaderStream << gShaderFile.rdbuf();
-		fShaderStream << fShaderFile.rdbuf();
+static const char* GetStageName(GLint stage) {
+	switch (stage) {
+		case GL_VERTEX_SHADER: return "VERTEX";
+		case GL_GEOMETRY_SHADER: return "GEOMETRY";
+		case GL_FRAGMENT_SHADER: return "FRAGMENT";
+		default: return "UNKNOWN";
+	}
+}
 
-		vShaderFile.close();
-		gShaderFile.close();
-		fShaderFile.close();
+// Checks the results, waiting on the driver if it is still compiling, then introspects.
+void Shader::Finish(ProgramCache* cache) {
 
-		vertexCode   = vShaderStream.str();
-		geometryCode = gShaderStream.str();
-		fragmentCode = fShaderStream.str();
-	} catch (std::fstream::failure e) {
-		throw std::runtime_error("SHADER_" + m_Name + "::" + std::string(e.what()));
+	if (m_Ready) {
+		return;
 	}
-	const char* vShaderCode = vertexCode.c_str();
-	const char* gShaderCode = geometryCode.c_str();
-	const char* fShaderCode = fragmentCode.c_str();
 
 	GLint success;
 	char  infoLog[512];
 
-	// Compile Vertex Shaders
-	GLuint vShaderIdx = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vShaderIdx, 1, &vShaderCode, nullptr);
-	glCompileShader(vShaderIdx);
-
-	glGetShaderiv(vShaderIdx, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		glGetShaderInfoLog(vShaderIdx, 512, nullptr, infoLog);
-		throw std::runtime_error("SHADER_" + m_Name + "::VERTEX_COMPILATION::" + std::string(infoLog));
-	}
-
-	// Compile Geometry Shaders
-	GLuint gShaderIdx = glCreateShader(GL_GEOMETRY_SHADER);
-	glShaderSource(gShaderIdx, 1, &gShaderCode, nullptr);
-	glCompileShader(gShaderIdx);
-
-	glGetShaderiv(gShaderIdx, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		glGetShaderInfoLog(gShaderIdx, 512, nullptr, infoLog);
-		throw std::runtime_error("SHADER_" + m_Name + "::GEOMETRY_COMPILATION::" + std::string(infoLog));
-	}
-
-	// Compile Fragment Shaders
-	GLuint fShaderIdx = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fShaderIdx, 1, &fShaderCode, nullptr);
-	glCompileShader(fShaderIdx);
-
-	glGetShaderiv(fShaderIdx, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		glGetShaderInfoLog(fShaderIdx, 512, nullptr, infoLog);
-		throw std::runtime_error("SHADER_" + m_Name + "::FRAGMENT_COMPILATION::" + std::string(infoLog));
+	for (GLuint stage : m_Stages) {
+		glGetShaderiv(stage, GL_COMPILE_STATUS, &success);
+		if (!success) {
+			GLint type;
+			glGetShaderiv(stage, GL_SHADER_TYPE, &type);
+			glGetShaderInfoLog(stage, 512, nullptr, infoLog);
+			throw std::runtime_error("SHADER_" + m_Name + "::" + GetStageName(type) + "_COMPILATION::" + std::string(infoLog));
+		}
 	}
 
-	// Link program
-	m_Shader = glCreateProgram();
-	glAttachShader(m_Shader, vShaderIdx);
-	glAttachShader(m_Shader, gShaderIdx);
-	glAttachShader(m_Shader, fShaderIdx);
-	glLinkProgram(m_Shader);
-
 	glGetProgramiv(m_Shader, GL_LINK_STATUS, &success);
 	if (!success) {
 		glGetProgramInfoLog(m_Shader, 512, nullptr, infoLog);
@@ -175,170 +105,366 @@ Shader::Shader(const std::string& name, const std::string& vertexShaderPath, con
 	}
 
 	// Program linked, cleanup
-	glDeleteShader(vShaderIdx);
-	glDeleteShader(gShaderIdx);
-	glDeleteShader(fShaderIdx);
+	for (GLuint stage : m_Stages) {
+		glDeleteShader(stage);
+	}
+	m_Stages.clear();
+
+	if (cache) {
+		auto stop = std::chrono::high_resolution_clock::now();
+		cache->Store(m_CacheKey, m_Shader, std::chrono::duration<float, std::milli>(stop - m_SubmitTime).count());
+	}
 
 	// Launch introspection.
 	IntrospectShader();
+	m_Ready = true;
+}
+
+// Takes over next's program and introspection, next is left with the old program to delete.
+void Shader::Swap(Shader& next) {
+
+	std::swap(m_Shader, next.m_Shader);
+	std::swap(m_Uniforms, next.m_Uniforms);
+	std::swap(m_Blocks, next.m_Blocks);
+	std::swap(m_Lookup, next.m_Lookup);
+	std::swap(m_LookupMask, next.m_LookupMask);
+	std::swap(m_BlockMask, next.m_BlockMask);
+
+	// Uniform values do not carry over to the new program.
+	m_UniformOwner = 0;
+	m_Generation++;
 }
 
 // Destructor to delete the shader program
 Shader::~Shader() {
 
-	glDeleteProgram(m_Shader);
+	// Left over when the compile failed.
+	for (GLuint stage : m_Stages) {
+		glDeleteShader(stage);
+	}
+	GLState::DeleteProgram(m_Shader);
 }
 
 // Activates the shader
 void Shader::Use() {
 
-	glUseProgram(m_Shader);
+	GLState::UseProgram(m_Shader);
 }
 
-// Introspection to get the active uniforms in the shader
+// Introspection to get the active uniforms and uniform blocks in the shader
 void Shader::IntrospectShader() {
 
 	GLint	 count;
+	GLint	 blockCount;
 	GLint	 size;
 	GLint	 len;
 	GLuint	type;
 	const int NAME_MAX_LEN = 36;
 	char	  name[NAME_MAX_LEN];
 
+	glGetProgramiv(m_Shader, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+	m_Blocks.resize(blockCount);
+	m_BlockMask = 0;
+	for (GLuint b = 0; b < (GLuint)blockCount; b++) {
+		glGetActiveUniformBlockName(m_Shader, b, NAME_MAX_LEN, &len, name);
+		glGetActiveUniformBlockiv(m_Shader, b, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+
+		GLuint binding = UniformBlocks::GetBinding(name);
+		m_Blocks[b]	= { std::string(name), b, size, binding, {} };
+		if (binding == UniformBlocks::NONE) {
+			continue;
+		}
+#ifndef NDEBUG
+		GLsizeiptr expected = UniformBlocks::GetSize(binding);
+		if (expected && expected != size) {
+			throw std::runtime_error("SHADER_" + m_Name + "::BLOCK_" + std::string(name) + "_LAYOUT_MISMATCH");
+		}
+#endif
+		glUniformBlockBinding(m_Shader, b, binding);
+		m_BlockMask |= 1u << binding;
+	}
+
 	glGetProgramiv(m_Shader, GL_ACTIVE_UNIFORMS, &count);
-	m_Uniforms.resize(count);
-	for (GLuint i = 0; i < count; i++) {
+	m_Uniforms.clear();
+	m_Uniforms.reserve(count);
+	if (!count) {
+		BuildLookup();
+		return;
+	}
+
+	// Block membership and std140 layout for all uniforms in one query each.
+	std::vector<GLuint> indices(count);
+	std::vector<GLint>	blockIndex(count);
+	std::vector<GLint>	offsets(count);
+	std::vector<GLint>	arrayStrides(count);
+	std::vector<GLint>	matrixStrides(count);
+	for (GLint i = 0; i < count; i++) {
+		indices[i] = i;
+	}
+	glGetActiveUniformsiv(m_Shader, count, indices.data(), GL_UNIFORM_BLOCK_INDEX, blockIndex.data());
+	glGetActiveUniformsiv(m_Shader, count, indices.data(), GL_UNIFORM_OFFSET, offsets.data());
+	glGetActiveUniformsiv(m_Shader, count, indices.data(), GL_UNIFORM_ARRAY_STRIDE, arrayStrides.data());
+	glGetActiveUniformsiv(m_Shader, count, indices.data(), GL_UNIFORM_MATRIX_STRIDE, matrixStrides.data());
+
+	for (GLint i = 0; i < count; i++) {
 		glGetActiveUniform(m_Shader, i, NAME_MAX_LEN, &len, &size, &type, name);
 
-		m_Uniforms[i] = {
+		if (blockIndex[i] >= 0) {
+			m_Blocks[blockIndex[i]].members.push_back({ type, offsets[i], arrayStrides[i], matrixStrides[i], size, std::string(name) });
+			continue;
+		}
+
+		m_Uniforms.push_back({
 			type,
 			glGetUniformLocation(m_Shader, name),
 			size,
 			std::string(name)
-		};
+		});
 	}
+	BuildLookup();
 }
 
-// Check if particular uniform exists.
-bool Shader::HasUniform(const std::string& name) const {
-	for (const ShaderUniforms& unif : m_Uniforms) {
-		if (unif.name == name) {
-			return true;
+const ShaderUniformBlock* Shader::GetUniformBlock(const std::string& name) const {
+	for (const ShaderUniformBlock& block : m_Blocks) {
+		if (block.name == name) {
+			return &block;
 		}
 	}
-	return false;
+	return nullptr;
 }
 
-// Get location for uniform
-GLuint Shader::GetUniformLocation(const std::string& name) const {
-	for (const ShaderUniforms& unif : m_Uniforms) {
-		if (unif.name == name) {
-			return unif.location;
+// Hash table over the active uniforms, at most half full.
+void Shader::BuildLookup() {
+
+	uint32_t capacity = 8;
+	while (capacity < m_Uniforms.size() * 2) {
+		capacity *= 2;
+	}
+	m_Lookup.assign(capacity, UniformSlot());
+	m_LookupMask = capacity - 1;
+
+	for (uint32_t i = 0; i < m_Uniforms.size(); i++) {
+		UniformId id(m_Uniforms[i].name);
+		uint32_t  hash = id.GetHash();
+		uint32_t  slot = hash & m_LookupMask;
+		while (m_Lookup[slot].uniform >= 0) {
+#ifndef NDEBUG
+			if (m_Lookup[slot].hash == hash) {
+				throw std::runtime_error("SHADER_" + m_Name + "::UNIFORM_HASH_COLLISION::" + m_Uniforms[i].name);
+			}
+#endif
+			slot = (slot + 1) & m_LookupMask;
+		}
+		m_Lookup[slot] = UniformSlot(id, (int32_t)i);
+	}
+}
+
+const ShaderUniforms* Shader::FindUniform(UniformId id) const {
+	const uint32_t hash = id.GetHash();
+	for (uint32_t slot = hash & m_LookupMask;; slot = (slot + 1) & m_LookupMask) {
+		const UniformSlot& entry = m_Lookup[slot];
+		if (entry.uniform < 0) {
+			return nullptr;
 		}
+		if (entry.hash == hash) {
+#ifndef NDEBUG
+			// At most one uniform per hash, so a different name is not in this shader.
+			if (entry.check != id.GetCheck()) {
+				throw std::runtime_error("SHADER_" + m_Name + "::UNIFORM_HASH_COLLISION::" + id.GetName() + "::" + m_Uniforms[entry.uniform].name);
+			}
+#endif
+			return &m_Uniforms[entry.uniform];
+		}
+	}
+}
+
+// Get location for uniform
+GLint Shader::GetUniformLocation(UniformId id) const {
+	const ShaderUniforms* unif = FindUniform(id);
+	return unif ? unif->location : -1;
+}
+
+#ifndef NDEBUG
+void Shader::RequireUniform(const std::string& name) const {
+	if (!HasUniform(name)) {
+		throw std::out_of_range("UNIF::" + name + "_DOES_NOT_EXIST");
 	}
-	return -1;
 }
+#endif
 
 // Setters for each Uniform type
-// -----------------------------
-void Shader::SetBool(const std::string& name, bool value) {
-	GLint loc = GetUniformLocation(name);
+// ----------------------------
+void Shader::SetBool(UniformId id, bool value) {
+	GLint loc = GetUniformLocation(id);
 #ifndef NDEBUG
 	if (loc < 0) {
-		throw std::out_of_range("UNIF::" + name + "_DOES_NOT_EXIST");
+		throw std::out_of_range("UNIF::" + id.GetName() + "_DOES_NOT_EXIST");
 	}
 #endif
 	glUniform1i(loc, (int)value);
 }
 
 // ----------------------------
-void Shader::SetInt(const std::string& name, int value) {
-	GLint loc = GetUniformLocation(name);
+void Shader::SetInt(UniformId id, int value) {
+	GLint loc = GetUniformLocation(id);
 #ifndef NDEBUG
 	if (loc < 0) {
-		throw std::out_of_range("UNIF::" + name + "_DOES_NOT_EXIST");
+		throw std::out_of_range("UNIF::" + id.GetName() + "_DOES_NOT_EXIST");
 	}
 #endif
 	glUniform1i(loc, value);
 }
 
 // ----------------------------
-void Shader::SetFloat(const std::string& name, float value) {
-	GLint loc = GetUniformLocation(name);
+void Shader::SetFloat(UniformId id, float value) {
+	GLint loc = GetUniformLocation(id);
 #ifndef NDEBUG
 	if (loc < 0) {
-		throw std::out_of_range("UNIF::" + name + "_DOES_NOT_EXIST");
+		throw std::out_of_range("UNIF::" + id.GetName() + "_DOES_NOT_EXIST");
 	}
 #endif
 	glUniform1f(loc, value);
 }
 
 // ----------------------------
-void Shader::SetMatrix(const std::string& name, const glm::mat2& value) {
-	GLint loc = GetUniformLocation(name);
+void Shader::SetMatrix(UniformId id, const glm::mat2& value) {
+	GLint loc = GetUniformLocation(id);
 #ifndef NDEBUG
 	if (loc < 0) {
-		throw std::out_of_range("UNIF::" + name + "_DOES_NOT_EXIST");
+		throw std::out_of_range("UNIF::" + id.GetName() + "_DOES_NOT_EXIST");
 	}
 #endif
 	glUniformMatrix2fv(loc, 1, GL_FALSE, glm::value_ptr(value));
 }
 
 // ----------------------------
-void Shader::SetMatrix(const std::string& name, const glm::mat3& value) {
-	GLint loc = GetUniformLocation(name);
+void Shader::SetMatrix(UniformId id, const glm::mat3& value) {
+	GLint loc = GetUniformLocation(id);
 #ifndef NDEBUG
 	if (loc < 0) {
-		throw std::out_of_range("UNIF::" + name + "_DOES_NOT_EXIST");
+		throw std::out_of_range("UNIF::" + id.GetName() + "_DOES_NOT_EXIST");
 	}
 #endif
 	glUniformMatrix3fv(loc, 1, GL_FALSE, glm::value_ptr(value));
 }
 
 // ----------------------------
-void Shader::SetMatrix(const std::string& name, const glm::mat4& value) {
-	GLint loc = GetUniformLocation(name);
+void Shader::SetMatrix(UniformId id, const glm::mat4& value) {
+	GLint loc = GetUniformLocation(id);
 #ifndef NDEBUG
 	if (loc < 0) {
-		throw std::out_of_range("UNIF::" + name + "_DOES_NOT_EXIST");
+		throw std::out_of_range("UNIF::" + id.GetName() + "_DOES_NOT_EXIST");
 	}
 #endif
 	glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(value));
 }
 
 // ----------------------------
-void Shader::SetVector(const std::string& name, const glm::vec2& value) {
-	GLint loc = GetUniformLocation(name);
+void Shader::SetVector(UniformId id, const glm::vec2& value) {
+	GLint loc = GetUniformLocation(id);
 #ifndef NDEBUG
 	if (loc < 0) {
-		throw std::out_of_range("UNIF::" + name + "_DOES_NOT_EXIST");
+		throw std::out_of_range("UNIF::" + id.GetName() + "_DOES_NOT_EXIST");
 	}
 #endif
 	glUniform2fv(loc, 1, glm::value_ptr(value));
 }
 
 // ----------------------------
-void Shader::SetVector(const std::string& name, const glm::vec3& value) {
-	GLint loc = GetUniformLocation(name);
+void Shader::SetVector(UniformId id, const glm::vec3& value) {
+	GLint loc = GetUniformLocation(id);
 #ifndef NDEBUG
 	if (loc < 0) {
-		throw std::out_of_range("UNIF::" + name + "_DOES_NOT_EXIST");
+		throw std::out_of_range("UNIF::" + id.GetName() + "_DOES_NOT_EXIST");
 	}
 #endif
 	glUniform3fv(loc, 1, glm::value_ptr(value));
 }
 
 // ----------------------------
-void Shader::SetVector(const std::string& name, const glm::vec4& value) {
-	GLint loc = GetUniformLocation(name);
+void Shader::SetVector(UniformId id, const glm::vec4& value) {
+	GLint loc = GetUniformLocation(id);
 #ifndef NDEBUG
 	if (loc < 0) {
-		throw std::out_of_range("UNIF::" + name + "_DOES_NOT_EXIST");
+		throw std::out_of_range("UNIF::" + id.GetName() + "_DOES_NOT_EXIST");
 	}
 #endif
 	glUniform4fv(loc, 1, glm::value_ptr(value));
 }
 
+// By name, debug builds check first to report the name instead of the hash.
+// ----------------------------
+void Shader::SetBool(const std::string& name, bool value) {
+#ifndef NDEBUG
+	RequireUniform(name);
+#endif
+	SetBool(UniformId(name), value);
+}
+
+// ----------------------------
+void Shader::SetInt(const std::string& name, int value) {
+#ifndef NDEBUG
+	RequireUniform(name);
+#endif
+	SetInt(UniformId(name), value);
+}
+
+// ----------------------------
+void Shader::SetFloat(const std::string& name, float value) {
+#ifndef NDEBUG
+	RequireUniform(name);
+#endif
+	SetFloat(UniformId(name), value);
+}
+
+// ----------------------------
+void Shader::SetMatrix(const std::string& name, const glm::mat2& value) {
+#ifndef NDEBUG
+	RequireUniform(name);
+#endif
+	SetMatrix(UniformId(name), value);
+}
+
+// ----------------------------
+void Shader::SetMatrix(const std::string& name, const glm::mat3& value) {
+#ifndef NDEBUG
+	RequireUniform(name);
+#endif
+	SetMatrix(UniformId(name), value);
+}
+
+// ----------------------------
+void Shader::SetMatrix(const std::string& name, const glm::mat4& value) {
+#ifndef NDEBUG
+	RequireUniform(name);
+#endif
+	SetMatrix(UniformId(name), value);
+}
+
+// ----------------------------
+void Shader::SetVector(const std::string& name, const glm::vec2& value) {
+#ifndef NDEBUG
+	RequireUniform(name);
+#endif
+	SetVector(UniformId(name), value);
+}
+
+// ----------------------------
+void Shader::SetVector(const std::string& name, const glm::vec3& value) {
+#ifndef NDEBUG
+	RequireUniform(name);
+#endif
+	SetVector(UniformId(name), value);
+}
+
+// ----------------------------
+void Shader::SetVector(const std::string& name, const glm::vec4& value) {
+#ifndef NDEBUG
+	RequireUniform(name);
+#endif
+	SetVector(UniformId(name), value);
+}
+
 // ----------------------------
 #ifndef NDEBUG
 
@@ -373,42 +499,298 @@ void Shader::PrintUniformData() const {
 }
 #endif
 
+void ShaderLoader::Init(const std::string& cacheDirectory, GLADloadproc load) {
+
+	m_Cache.Init(cacheDirectory, load);
+
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count && !m_Parallel; i++) {
+		const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (!extension) {
+			continue;
+		}
+		MaxShaderCompilerThreadsProc maxThreads = nullptr;
+		if (!std::strcmp(extension, "GL_KHR_parallel_shader_compile")) {
+			maxThreads = (MaxShaderCompilerThreadsProc)load("glMaxShaderCompilerThreadsKHR");
+		} else if (!std::strcmp(extension, "GL_ARB_parallel_shader_compile")) {
+			maxThreads = (MaxShaderCompilerThreadsProc)load("glMaxShaderCompilerThreadsARB");
+		}
+		if (maxThreads) {
+			// Let the driver pick its thread count.
+			maxThreads(0xFFFFFFFF);
+			m_Parallel = true;
+		}
+	}
+}
+
+Shader* ShaderLoader::Create(const std::string& name, const std::string& vertexShaderPath, const std::string& fragShaderPath, const std::vector<std::string>& defines) {
+#ifndef NDEBUG
+	if (m_Names.count(name)) {
+		throw std::runtime_error("SHDR_LOAD::" + name + "_NOT_UNIQUE");
+	}
+#endif
+	Build build = { vertexShaderPath, fragShaderPath, defines, {} };
+
+	std::vector<Shader::ShaderSource> sources = Preprocess(build, &build.dependencies);
+	m_Builds[name]							  = std::move(build);
+	Handle handle							  = m_Names[name] = m_Shaders.Create(name, sources, &m_Cache);
+	return m_Shaders.Get(handle);
+}
+
+std::vector<Shader::ShaderSource> ShaderLoader::Preprocess(const Build& build, std::vector<std::string>* dependencies) {
+
+	return {
+		{ GL_VERTEX_SHADER, m_Preprocessor.Process(build.vertexShaderPath, build.defines, dependencies) },
+		{ GL_FRAGMENT_SHADER, m_Preprocessor.Process(build.fragShaderPath, build.defines, dependencies) }
+	};
+}
+
+void ShaderLoader::AddPending(Shader* shader) {
+
+	if (!shader->IsReady()) {
+		if (m_Pending.empty()) {
+			m_BatchStart = std::chrono::high_resolution_clock::now();
+		}
+		m_Pending.push_back(shader);
+	}
+	m_Stats.submitted++;
+	m_Stats.pending = (uint32_t)m_Pending.size();
+}
+
 // Load Shader into the shader cache, and return a pointer.
 Shader* ShaderLoader::Load(const std::string& name, const std::string& vertexShaderPath, const std::string& fragShaderPath) {
+
+	Shader* shader = Create(name, vertexShaderPath, fragShaderPath, {});
+	shader->Finish(&m_Cache);
+	return shader;
+}
+
+// Queue a Shader for compiling, it can be drawn with once IsReady.
+Shader* ShaderLoader::Submit(const std::string& name, const std::string& vertexShaderPath, const std::string& fragShaderPath) {
+
+	Shader* shader = Create(name, vertexShaderPath, fragShaderPath, {});
+	AddPending(shader);
+	return shader;
+}
+
+void ShaderLoader::Register(const std::string& name, const std::string& vertexShaderPath, const std::string& fragShaderPath, const std::vector<std::string>& features) {
 #ifndef NDEBUG
-	if (m_Shaders.count(name)) {
-		throw std::runtime_error("SHDR_LOAD::" + name + "_NOT_UNIQUE");
+	if (m_Families.count(name) || features.size() > 64) {
+		throw std::runtime_error("SHDR_LOAD::" + name + "_BAD_REGISTER");
+	}
+#endif
+	m_Families[name] = { vertexShaderPath, fragShaderPath, features, {} };
+}
+
+// Submitted on first use, until then the variant does not exist.
+Shader* ShaderLoader::GetVariant(const std::string& name, uint64_t features) {
+
+	auto family = m_Families.find(name);
+#ifndef NDEBUG
+	if (family == m_Families.end()) {
+		throw std::runtime_error("SHDR_LOAD::" + name + "_NOT_REGISTERED");
+	}
+	if (family->second.features.size() < 64 && features >> family->second.features.size()) {
+		throw std::runtime_error("SHDR_LOAD::" + name + "_BAD_FEATURES");
 	}
 #endif
-	return m_Shaders[name] = new Shader(name, vertexShaderPath, fragShaderPath);
+
+	Family& f  = family->second;
+	auto	it = f.variants.find(features);
+	if (it != f.variants.end()) {
+		return it->second;
+	}
+
+	std::vector<std::string> defines;
+	for (uint32_t bit = 0; bit < f.features.size(); bit++) {
+		if ((features >> bit) & 1) {
+			defines.push_back(f.features[bit] + " 1");
+		}
+	}
+
+	Shader* shader = Create(name + ":" + std::to_string(features), f.vertexShaderPath, f.fragShaderPath, defines);
+	AddPending(shader);
+	return f.variants[features] = shader;
+}
+
+bool ShaderLoader::Prewarm(const std::string& path) {
+
+	std::ifstream file(path);
+	if (!file) {
+		return false;
+	}
+
+	std::string name;
+	uint64_t	features;
+	while (file >> name >> features) {
+		// Skip what no longer matches the registered shaders.
+		auto family = m_Families.find(name);
+		if (family != m_Families.end() && (family->second.features.size() >= 64 || !(features >> family->second.features.size()))) {
+			GetVariant(name, features);
+		}
+	}
+	return true;
+}
+
+bool ShaderLoader::SaveUsage(const std::string& path) const {
+
+	std::ofstream file(path);
+	if (!file) {
+		return false;
+	}
+
+	for (const auto& family : m_Families) {
+		for (const auto& variant : family.second.variants) {
+			file << family.first << ' ' << variant.first << '\n';
+		}
+	}
+	return (bool)file;
+}
+
+uint32_t ShaderLoader::Reload(const std::vector<std::string>& paths) {
+
+	for (const std::string& path : paths) {
+		m_Preprocessor.Invalidate(path);
+	}
+
+	uint32_t count = 0;
+	for (auto& b : m_Builds) {
+		Build& build = b.second;
+		bool   stale = false;
+		for (const std::string& path : paths) {
+			stale = stale || std::find(build.dependencies.begin(), build.dependencies.end(), path) != build.dependencies.end();
+		}
+		if (!stale) {
+			continue;
+		}
+
+		// A newer edit supersedes a reload still compiling.
+		Shader* shader = m_Shaders.Get(m_Names[b.first]);
+		DropReload(shader);
+
+		std::vector<std::string>		  dependencies;
+		std::vector<Shader::ShaderSource> sources;
+		try {
+			sources = Preprocess(build, &dependencies);
+			m_Reloads.push_back({ shader, new Shader(b.first, sources, &m_Cache) });
+		} catch (const std::runtime_error& e) {
+			std::cerr << "SHDR_LOAD::" << b.first << "_RELOAD::" << e.what() << std::endl;
+			m_Stats.reloadFailed++;
+			continue;
+		}
+		build.dependencies = std::move(dependencies);
+		count++;
+	}
+	return count;
+}
+
+void ShaderLoader::DropReload(Shader* shader) {
+
+	for (auto it = m_Reloads.begin(); it != m_Reloads.end(); ++it) {
+		if (it->shader == shader) {
+			delete it->next;
+			m_Reloads.erase(it);
+			return;
+		}
+	}
+}
+
+uint32_t ShaderLoader::Update() {
+
+	// A failed reload is reported and dropped, the shader keeps its old program.
+	auto swapped = [&](PendingReload& reload) {
+		if (m_Parallel && !reload.next->IsReady() && !reload.next->IsCompiled()) {
+			return false;
+		}
+		try {
+			reload.next->Finish(&m_Cache);
+			reload.shader->Swap(*reload.next);
+			m_Stats.reloaded++;
+		} catch (const std::runtime_error& e) {
+			std::cerr << e.what() << std::endl;
+			m_Stats.reloadFailed++;
+		}
+		delete reload.next;
+		return true;
+	};
+	m_Reloads.erase(std::remove_if(m_Reloads.begin(), m_Reloads.end(), swapped), m_Reloads.end());
+
+	if (m_Pending.empty()) {
+		return 0;
+	}
+
+	auto done = [&](Shader* shader) {
+		if (m_Parallel && !shader->IsCompiled()) {
+			return false;
+		}
+		shader->Finish(&m_Cache);
+		return true;
+	};
+	m_Pending.erase(std::remove_if(m_Pending.begin(), m_Pending.end(), done), m_Pending.end());
+
+	m_Stats.pending = (uint32_t)m_Pending.size();
+	if (m_Pending.empty()) {
+		auto stop				  = std::chrono::high_resolution_clock::now();
+		m_Stats.batchMilliseconds = std::chrono::duration<float, std::milli>(stop - m_BatchStart).count();
+	}
+	return m_Stats.pending;
+}
+
+void ShaderLoader::Finish() {
+
+	bool parallel = m_Parallel;
+	m_Parallel	  = false;
+	Update();
+	m_Parallel = parallel;
 }
 
 // Gets a loaded shader.
 Shader* ShaderLoader::Get(const std::string& name) {
 #ifndef NDEBUG
 	try {
-		return m_Shaders.at(name);
+		return m_Shaders.Get(m_Names.at(name));
 	} catch (const std::exception& e) {
 		throw std::runtime_error("SHDR_LOAD::" + std::string(e.what()));
 	}
 #else
-	return m_Shaders[name];
+	return m_Shaders.Get(m_Names[name]);
 #endif
 }
 
+ShaderLoader::Handle ShaderLoader::Find(const std::string& name) const {
+
+	auto it = m_Names.find(name);
+	return it != m_Names.end() ? it->second : Handle();
+}
+
 // Unloads a loaded shader
 void ShaderLoader::Unload(const std::string& name) {
 #ifndef NDEBUG
+	Handle handle;
 	try {
-		delete m_Shaders.at(name);
+		handle = m_Names.at(name);
 	} catch (const std::exception& e) {
 		throw std::runtime_error("SHDR_LOAD::" + std::string(e.what()));
 	}
-	m_Shaders.erase(name);
 #else
-	delete m_Shaders[name];
-	m_Shaders.erase(name);
+	Handle handle = m_Names[name];
 #endif
+	Shader* shader = m_Shaders.Get(handle);
+	m_Pending.erase(std::remove(m_Pending.begin(), m_Pending.end(), shader), m_Pending.end());
+	m_Stats.pending = (uint32_t)m_Pending.size();
+	DropReload(shader);
+	m_Builds.erase(name);
+	for (auto& family : m_Families) {
+		for (auto it = family.second.variants.begin(); it != family.second.variants.end(); ++it) {
+			if (it->second == shader) {
+				family.second.variants.erase(it);
+				break;
+			}
+		}
+	}
+	m_Shaders.Release(handle);
+	m_Names.erase(name);
 }
 
 // ----------------------------
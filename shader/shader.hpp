@@ -3,15 +3,21 @@
 #ifndef _SHADER_HPP
 #define _SHADER_HPP
 
+#include <chrono>
 #include <fstream>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include <map>
+#include <unordered_map>
 #include <vector>
 
 #include <glad/glad.h>
+#include <resource/resource_pool.hpp>
+#include <shader/preprocessor.hpp>
+#include <shader/program_cache.hpp>
+#include <shader/uniform_id.hpp>
 
 /*
  * Shader Uniforms struct
@@ -26,6 +32,30 @@ struct ShaderUniforms {
 	std::string name;
 };
 
+/*
+ * Shader Uniform Block structs
+ * An active uniform block and the std140 layout of its members, as
+ * reported by the driver. Blocks named in UniformBlocks are bound to
+ * their fixed binding point, others keep binding NONE.
+ */
+
+struct ShaderBlockMember {
+	GLenum		type;
+	GLint		offset;
+	GLint		arrayStride;  // 0 when not an array
+	GLint		matrixStride; // 0 when not a matrix
+	GLsizei		size;
+	std::string name;
+};
+
+struct ShaderUniformBlock {
+	std::string					   name;
+	GLuint						   index;
+	GLint						   size;
+	GLuint						   binding;
+	std::vector<ShaderBlockMember> members;
+};
+
 /* Forward Declaration */
 class ShaderLoader;
 
@@ -33,34 +63,119 @@ class ShaderLoader;
  * Shader class
  * Wrapper over the GLSL Shader loading and uniform setting methods
  * in OpenGL.
+ * Compiling is split in two: the constructor submits every stage and
+ * the link without reading any status back, Finish checks the results
+ * and introspects. Drivers compile in the background in between, so a
+ * shader is not usable until IsReady.
+ * A reload compiles into a separate shader and swaps its program in once
+ * it linked, so the Shader* stays valid and the old program keeps being
+ * drawn with until then. Anything resolved against the program, uniform
+ * locations above all, has to be redone when GetGeneration changes.
  */
 
 class Shader {
 private:
-	GLuint						m_Shader;
-	std::string					m_Name;
-	std::vector<ShaderUniforms> m_Uniforms;
+	struct ShaderSource {
+		GLenum		stage;
+		std::string code;
+	};
+
+	// Open addressing table from name hash to index in m_Uniforms, linear probing.
+	struct UniformSlot {
+		uint32_t hash	 = 0;
+		int32_t	 uniform = -1; // -1 for an empty slot
+#ifndef NDEBUG
+		uint32_t check = 0; // UniformId::GetCheck of the name
+#endif
+
+		UniformSlot() {}
+		UniformSlot(UniformId id, int32_t uniform) :
+				hash(id.GetHash()), uniform(uniform) {
+#ifndef NDEBUG
+			check = id.GetCheck();
+#endif
+		}
+	};
+
+	GLuint							m_Shader = 0;
+	std::string						m_Name;
+	std::vector<ShaderUniforms>		m_Uniforms; // Block members excluded
+	std::vector<ShaderUniformBlock> m_Blocks;
+	std::vector<UniformSlot>		m_Lookup;
+	uint32_t						m_LookupMask   = 0;
+	uint32_t						m_BlockMask	   = 0; // Bit per UniformBlocks binding
+	uint64_t						m_UniformOwner = 0; // Material whose values are uploaded
+	uint32_t						m_Generation   = 0; // Bumped when a reload swaps the program
 
-	void   IntrospectShader();
-	GLuint GetUniformLocation(const std::string& name) const;
+	// Compile in flight
+	bool										   m_Ready = false;
+	std::vector<GLuint>							   m_Stages;
+	uint64_t									   m_CacheKey = 0;
+	std::chrono::high_resolution_clock::time_point m_SubmitTime;
 
-	// Constructor / Loaders. Load the appropriate files and compile into a Shader Programme before launching introspection.
-	Shader(const std::string& name, const std::string& vertexShaderPath, const std::string& fragShaderPath);
-	Shader(const std::string& name, const std::string& vertexShaderPath, const std::string& geometryShaderPath, const std::string& fragShaderPath);
+	void		Submit(const std::vector<ShaderSource>& sources, ProgramCache* cache);
+	bool		IsCompiled() const;
+	void		Finish(ProgramCache* cache);
+	void		Swap(Shader& next);
+
+	void  IntrospectShader();
+	void  BuildLookup();
+	GLint GetUniformLocation(UniformId id) const;
+#ifndef NDEBUG
+	void RequireUniform(const std::string& name) const;
+#endif
+
+	// Constructor. Submits the preprocessed stages for compiling, or takes the program from the binary cache.
+	Shader(const std::string& name, const std::vector<ShaderSource>& sources, ProgramCache* cache = nullptr);
 	~Shader();
 
 	friend class ShaderLoader;
+	template <typename T, uint32_t PageSize>
+	friend class ResourcePool;
 
 public:
 	// Activate shader for use.
 	void Use();
 
+	// Linked and introspected, nothing else may be called before.
+	bool IsReady() const { return m_Ready; }
+
 	// Getters for info about the shader;
 	GLuint			   GetID() const { return m_Shader; }
 	const std::string& GetName() const { return m_Name; }
-	bool			   HasUniform(const std::string& name) const;
+	bool			   HasUniform(UniformId id) const { return FindUniform(id) != nullptr; }
+	bool			   HasUniform(const std::string& name) const { return HasUniform(UniformId(name)); }
+
+	// Constant time, allocation free lookup, nullptr when the uniform is not active.
+	const ShaderUniforms* FindUniform(UniformId id) const;
 
-	// Setters for all the uniforms.
+	// Introspected active uniforms, for resolving locations up front.
+	const std::vector<ShaderUniforms>& GetUniforms() const { return m_Uniforms; }
+
+	// Introspected uniform blocks.
+	const std::vector<ShaderUniformBlock>& GetUniformBlocks() const { return m_Blocks; }
+	const ShaderUniformBlock*			   GetUniformBlock(const std::string& name) const;
+	bool								   UsesBlock(GLuint binding) const { return (m_BlockMask >> binding) & 1; }
+
+	// Changes whenever a reload replaced the program.
+	uint32_t GetGeneration() const { return m_Generation; }
+
+	// Tag of the material that last uploaded its uniforms, 0 for none.
+	uint64_t GetUniformOwner() const { return m_UniformOwner; }
+	void	 SetUniformOwner(uint64_t owner) { m_UniformOwner = owner; }
+
+	// Setters for all the uniforms, by precomputed id.
+	void SetBool(UniformId id, bool value);
+	void SetFloat(UniformId id, float value);
+	void SetInt(UniformId id, int value);
+	void SetVector(UniformId id, const glm::vec2& value);
+	void SetVector(UniformId id, const glm::vec3& value);
+	void SetVector(UniformId id, const glm::vec4& value);
+	void SetMatrix(UniformId id, const glm::mat2& value);
+	void SetMatrix(UniformId id, const glm::mat3& value);
+	void SetMatrix(UniformId id, const glm::mat4& value);
+
+	// By name, these hash the name on every call.
 	void SetBool(const std::string& name, bool value);
 	void SetFloat(const std::string& name, float value);
 	void SetInt(const std::string& name, int value);
@@ -78,22 +193,117 @@ public:
 
 /*
  * Shader Loader class
- * Is able to load Shaders and caches the loaded shaders.
+ * Is able to load Shaders and caches the loaded shaders. Linked programs
+ * also go through the on disk binary cache, once it is initialised.
+ * Load compiles synchronously. Submit only queues the compile and
+ * returns a shader that becomes ready on a later Update, so a batch of
+ * programs compiles on the driver's threads instead of one at a time.
+ * Where KHR_parallel_shader_compile is available Update only finishes
+ * the programs the driver reports done, otherwise it finishes all of
+ * them, which still lets the whole batch be submitted up front.
+ * Sources go through the preprocessor. A registered shader has a list
+ * of features, each a #define, and its variants are keyed by a bitmask
+ * of them. A variant is submitted the first time it is asked for, and
+ * the variants used can be saved and submitted up front next launch.
  */
 
 class ShaderLoader {
-	std::map<std::string, Shader*> m_Shaders;
+public:
+	typedef ResourcePool<Shader>::Handle Handle;
+
+	struct Stats {
+		uint32_t submitted;
+		uint32_t pending;
+		float	 batchMilliseconds; // First submit to the last program ready
+		uint32_t reloaded;
+		uint32_t reloadFailed; // Kept the old program
+	};
+
+private:
+	typedef void(APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+
+	// What a shader was built from, to rebuild it.
+	struct Build {
+		std::string				 vertexShaderPath;
+		std::string				 fragShaderPath;
+		std::vector<std::string> defines;
+		std::vector<std::string> dependencies; // Every file the sources pulled in
+	};
+
+	// A replacement compiling for a live shader.
+	struct PendingReload {
+		Shader* shader;
+		Shader* next;
+	};
+
+	struct Family {
+		std::string							  vertexShaderPath;
+		std::string							  fragShaderPath;
+		std::vector<std::string>			  features; // Define of each bit
+		std::unordered_map<uint64_t, Shader*> variants;
+	};
+
+	ResourcePool<Shader>					m_Shaders;
+	std::unordered_map<std::string, Handle> m_Names;
+	std::map<std::string, Build>			m_Builds; // By shader name
+	std::map<std::string, Family>			m_Families;
+	ShaderPreprocessor						m_Preprocessor;
+	std::vector<Shader*>					m_Pending;
+	std::vector<PendingReload>				m_Reloads; // Replacements are not pooled, they only live until swapped
+	ProgramCache							m_Cache;
+	bool									m_Parallel = false;
+
+	std::chrono::high_resolution_clock::time_point m_BatchStart;
+	Stats										   m_Stats = {};
+
+	Shader* Create(const std::string& name, const std::string& vertexShaderPath, const std::string& fragShaderPath, const std::vector<std::string>& defines);
+	void	AddPending(Shader* shader);
+	void	DropReload(Shader* shader);
+
+	std::vector<Shader::ShaderSource> Preprocess(const Build& build, std::vector<std::string>* dependencies);
 
 public:
+	// Sets up the binary cache and parallel compiling, both optional.
+	void Init(const std::string& cacheDirectory, GLADloadproc load);
+
+	ProgramCache& GetCache() { return m_Cache; }
+	bool		  IsParallel() const { return m_Parallel; }
+
 	Shader* Load(const std::string& name, const std::string& vertexShaderPath, const std::string& fragShaderPath);
+	Shader* Submit(const std::string& name, const std::string& vertexShaderPath, const std::string& fragShaderPath);
 	Shader* Get(const std::string& name);
 	void	Unload(const std::string& name);
 
+	// Handles go stale on Unload, Get then returns null instead of a deleted shader.
+	Handle	Find(const std::string& name) const;
+	Shader* Get(Handle handle) const { return m_Shaders.Get(handle); }
+
+	// Variants. Features are the defines for bits 0 and up, at most 64.
+	void	Register(const std::string& name, const std::string& vertexShaderPath, const std::string& fragShaderPath, const std::vector<std::string>& features);
+	Shader* GetVariant(const std::string& name, uint64_t features);
+
+	// Usage list of "name features" lines, written on exit and submitted early on the next launch.
+	bool Prewarm(const std::string& path);
+	bool SaveUsage(const std::string& path) const;
+
+	// Rebuilds every shader that pulled in one of the changed files. Each keeps drawing
+	// with its old program until the new one is ready, or for good if it fails to build.
+	// Returns how many shaders were resubmitted.
+	uint32_t Reload(const std::vector<std::string>& paths);
+
+	// Finishes the compiles that are done, reloads included, and returns how many first compiles are still pending.
+	uint32_t Update();
+	// Blocks until every submitted shader is ready.
+	void Finish();
+
+	const Stats& GetStats() const { return m_Stats; }
+
 	ShaderLoader() {}
 	~ShaderLoader() {
-		for (auto& p : m_Shaders) {
-			delete p.second;
+		for (PendingReload& reload : m_Reloads) {
+			delete reload.next;
 		}
+		m_Shaders.Clear();
 	}
 };
 
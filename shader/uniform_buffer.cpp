@@ -0,0 +1,108 @@
+#include "uniform_buffer.hpp"
+#include <glstate/glstate.hpp>
+#include <shader/generated/shader_reflection.hpp>
+
+#include <cstddef>
+#include <cstring>
+
+// The mirrors in uniform_buffer.hpp are written by hand, the generated blocks are what the GLSL declares.
+#define CHECK_MEMBER(shader, block, mirror, member)                                                                                        \
+	static_assert(offsetof(mirror, member) == offsetof(ShaderReflection::shader::block, member), #shader " " #block "." #member " moved"); \
+	static_assert(sizeof(mirror::member) == sizeof(ShaderReflection::shader::block::member), #shader " " #block "." #member " resized")
+
+#define CHECK_BLOCKS(shader)                                                                                                         \
+	static_assert(sizeof(FrameData) == sizeof(ShaderReflection::shader::FrameData), #shader " FrameData does not match the mirror"); \
+	CHECK_MEMBER(shader, FrameData, FrameData, view);                                                                                \
+	CHECK_MEMBER(shader, FrameData, FrameData, projection);                                                                          \
+	CHECK_MEMBER(shader, FrameData, FrameData, viewProj);                                                                            \
+	CHECK_MEMBER(shader, FrameData, FrameData, cameraPosition);                                                                      \
+	CHECK_MEMBER(shader, FrameData, FrameData, time);                                                                                \
+	CHECK_MEMBER(shader, FrameData, FrameData, lights);                                                                              \
+	CHECK_MEMBER(shader, FrameData, FrameData, lightCount);                                                                          \
+	CHECK_MEMBER(shader, Light, LightData, position);                                                                                \
+	CHECK_MEMBER(shader, Light, LightData, color);                                                                                   \
+	static_assert(sizeof(DrawData) == sizeof(ShaderReflection::shader::DrawData), #shader " DrawData does not match the mirror");    \
+	CHECK_MEMBER(shader, DrawData, DrawData, model);                                                                                 \
+	CHECK_MEMBER(shader, DrawData, DrawData, color)
+
+CHECK_BLOCKS(scene);
+CHECK_BLOCKS(fallback);
+
+#undef CHECK_BLOCKS
+#undef CHECK_MEMBER
+
+static const char* BLOCK_NAMES[UniformBlocks::COUNT] = { "FrameData", "MaterialData", "DrawData" };
+
+GLuint UniformBlocks::GetBinding(const std::string& name) {
+
+	for (GLuint binding = 0; binding < COUNT; binding++) {
+		if (name == BLOCK_NAMES[binding]) {
+			return binding;
+		}
+	}
+	return NONE;
+}
+
+const char* UniformBlocks::GetName(GLuint binding) {
+
+	return binding < COUNT ? BLOCK_NAMES[binding] : "";
+}
+
+GLsizeiptr UniformBlocks::GetSize(GLuint binding) {
+
+	switch (binding) {
+		case FRAME: return sizeof(FrameData);
+		case DRAW: return sizeof(DrawData);
+		default: return 0;
+	}
+}
+
+void UniformBuffer::Upload(const void* data, GLsizeiptr size) {
+
+	if (!m_Buffer) {
+		glGenBuffers(1, &m_Buffer);
+	}
+	GLState::BindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+	glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
+	m_Size = size;
+}
+
+void UniformBuffer::Bind(GLuint binding) const {
+
+	GLState::BindBufferBase(GL_UNIFORM_BUFFER, binding, m_Buffer);
+}
+
+UniformBuffer::~UniformBuffer() {
+
+	if (m_Buffer) {
+		GLState::DeleteBuffers(1, &m_Buffer);
+	}
+}
+
+void UniformRing::Begin() {
+
+	// Offset alignments are powers of two well below the ring's 64KB minimum, so segments start aligned.
+	if (!m_Alignment) {
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &m_Alignment);
+	}
+	m_Ring.Next();
+	m_Staging.clear();
+}
+
+GLintptr UniformRing::Allocate(const void* data, GLsizeiptr size) {
+
+	GLintptr offset = (m_Staging.size() + m_Alignment - 1) / m_Alignment * m_Alignment;
+	m_Staging.resize(offset + size);
+	std::memcpy(m_Staging.data() + offset, data, size);
+	return offset;
+}
+
+void UniformRing::Flush() {
+
+	m_Ring.Upload(m_Staging.data(), m_Staging.size());
+}
+
+void UniformRing::Bind(GLuint binding, GLintptr offset, GLsizeiptr size) const {
+
+	GLState::BindBufferRange(GL_UNIFORM_BUFFER, binding, m_Ring.GetBuffer(), m_Ring.GetBase() + offset, size);
+}
@@ -0,0 +1,103 @@
+
+#ifndef _UNIFORM_BUFFER_HPP
+#define _UNIFORM_BUFFER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glstate/stream_ring.hpp>
+
+/*
+ * Uniform Blocks
+ * Blocks any shader may declare, bound by name to fixed binding points on
+ * introspection. FrameData and DrawData have std140 mirrors here, checked
+ * against the generated reflection structs at compile time and the
+ * introspected block size at runtime; MaterialData is free form and is
+ * packed from the material's values using the introspected offsets.
+ */
+
+static const uint32_t MAX_LIGHTS = 4;
+
+struct LightData {
+	glm::vec4 position; // w = 0 for directional
+	glm::vec4 color;	// a is the intensity
+};
+
+struct FrameData {
+	glm::mat4  view;
+	glm::mat4  projection;
+	glm::mat4  viewProj;
+	glm::vec4  cameraPosition;
+	glm::vec4  time; // x elapsed, y delta
+	LightData  lights[MAX_LIGHTS];
+	glm::ivec4 lightCount;
+};
+
+struct DrawData {
+	glm::mat4 model;
+	glm::vec4 color;
+};
+
+class UniformBlocks {
+public:
+	static const GLuint FRAME	= 0;
+	static const GLuint MATERIAL = 1;
+	static const GLuint DRAW	 = 2;
+	static const GLuint COUNT	= 3;
+	static const GLuint NONE	 = ~0u;
+
+	static GLuint GetBinding(const std::string& name);
+	static const char* GetName(GLuint binding);
+	// Expected std140 size of the block, 0 when free form.
+	static GLsizeiptr GetSize(GLuint binding);
+};
+
+/*
+ * Uniform Buffer class
+ * A single uniform buffer, orphaned and refilled on every upload.
+ */
+
+class UniformBuffer {
+	GLuint	   m_Buffer = 0;
+	GLsizeiptr m_Size   = 0;
+
+public:
+	void Upload(const void* data, GLsizeiptr size);
+	void Bind(GLuint binding) const;
+
+	GLuint GetID() const { return m_Buffer; }
+
+	UniformBuffer() {}
+	UniformBuffer(const UniformBuffer&) = delete;
+	UniformBuffer& operator=(const UniformBuffer&) = delete;
+	~UniformBuffer();
+};
+
+/*
+ * Uniform Ring class
+ * Per draw uniform data for a whole frame. Blocks are staged on the CPU,
+ * uploaded in one go on Flush into the frame's segment of a StreamRing,
+ * then bound per draw with glBindBufferRange.
+ */
+
+class UniformRing {
+	StreamRing			 m_Ring{ GL_UNIFORM_BUFFER, GL_DYNAMIC_DRAW, 64 * 1024 };
+	GLint				 m_Alignment = 0;
+	std::vector<uint8_t> m_Staging;
+
+public:
+	// Fences the segment the last frame drew from and waits for the next one.
+	void Begin();
+	// Stages a block and returns its offset from GetBase, aligned for binding.
+	GLintptr Allocate(const void* data, GLsizeiptr size);
+	void	 Flush();
+
+	GLuint	 GetBuffer() const { return m_Ring.GetBuffer(); }
+	GLintptr GetBase() const { return m_Ring.GetBase(); }
+	void	 Bind(GLuint binding, GLintptr offset, GLsizeiptr size) const;
+};
+
+#endif /* _UNIFORM_BUFFER_HPP */
@@ -0,0 +1,74 @@
+
+#ifndef _UNIFORM_ID_HPP
+#define _UNIFORM_ID_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * Uniform Id class
+ * A uniform name reduced to its 32 bit FNV-1a hash. Built from a literal
+ * in a constexpr context it costs nothing at runtime:
+ *   static constexpr UniformId MODEL("model");
+ * Shaders look uniforms up by the hash and check for collisions between
+ * their own uniforms on introspection. Debug builds also carry a second,
+ * unrelated hash to catch a name colliding with one it is not, and the
+ * name itself when built from a literal, for error messages.
+ */
+
+class UniformId {
+	uint32_t m_Hash;
+#ifndef NDEBUG
+	uint32_t	m_Check;
+	const char* m_Name; // Literals only, a string's buffer may not outlive the id
+#endif
+
+	static constexpr uint32_t FNV_OFFSET = 2166136261u;
+	static constexpr uint32_t FNV_PRIME	 = 16777619u;
+
+public:
+	static constexpr uint32_t Hash(const char* name, size_t length) {
+		uint32_t hash = FNV_OFFSET;
+		for (size_t i = 0; i < length; i++) {
+			hash = (hash ^ (uint8_t)name[i]) * FNV_PRIME;
+		}
+		return hash;
+	}
+
+	// djb2, for the debug check only.
+	static constexpr uint32_t CheckHash(const char* name, size_t length) {
+		uint32_t hash = 5381;
+		for (size_t i = 0; i < length; i++) {
+			hash = hash * 33 + (uint8_t)name[i];
+		}
+		return hash;
+	}
+
+#ifndef NDEBUG
+	template <size_t N>
+	explicit constexpr UniformId(const char (&name)[N]) :
+			m_Hash(Hash(name, N - 1)), m_Check(CheckHash(name, N - 1)), m_Name(name) {
+	}
+	explicit UniformId(const std::string& name) :
+			m_Hash(Hash(name.data(), name.size())), m_Check(CheckHash(name.data(), name.size())), m_Name(nullptr) {
+	}
+
+	constexpr uint32_t GetCheck() const { return m_Check; }
+	std::string		   GetName() const { return m_Name ? std::string(m_Name) : "#" + std::to_string(m_Hash); }
+#else
+	template <size_t N>
+	explicit constexpr UniformId(const char (&name)[N]) :
+			m_Hash(Hash(name, N - 1)) {
+	}
+	explicit UniformId(const std::string& name) :
+			m_Hash(Hash(name.data(), name.size())) {
+	}
+#endif
+
+	constexpr uint32_t GetHash() const { return m_Hash; }
+	constexpr bool	   operator==(UniformId other) const { return m_Hash == other.m_Hash; }
+	constexpr bool	   operator!=(UniformId other) const { return m_Hash != other.m_Hash; }
+};
+
+#endif /* _UNIFORM_ID_HPP */
@@ -0,0 +1,267 @@
+#!/bin/python3
+
+# Generates typed C++ descriptors from the GLSL under assets/shaders.
+#
+# Every .vs/.fs pair sharing a name becomes a namespace in ShaderReflection
+# holding its vertex attributes, a ShaderUniform<T> or ShaderSampler per
+# uniform, and a struct per uniform block laid out to std140 with the
+# offsets checked by static_assert. All #if branches are taken, so a
+# namespace covers every variant of the shader.
+#
+# Used by the ShaderReflection builder in SConstruct, or standalone:
+#   python3 site_scons/shader_reflect.py out.hpp assets/shaders/*.vs assets/shaders/*.fs
+
+import os
+import re
+import sys
+
+# GLSL type: (setter type, block storage type, GL enum, std140 size, std140 alignment)
+TYPES = {
+	'float': ('float', 'float', 'GL_FLOAT', 4, 4),
+	'int': ('int', 'GLint', 'GL_INT', 4, 4),
+	'uint': (None, 'GLuint', 'GL_UNSIGNED_INT', 4, 4),
+	'bool': ('bool', 'GLint', 'GL_BOOL', 4, 4),
+	'vec2': ('glm::vec2', 'glm::vec2', 'GL_FLOAT_VEC2', 8, 8),
+	'vec3': ('glm::vec3', 'glm::vec3', 'GL_FLOAT_VEC3', 12, 16),
+	'vec4': ('glm::vec4', 'glm::vec4', 'GL_FLOAT_VEC4', 16, 16),
+	'ivec2': (None, 'glm::ivec2', 'GL_INT_VEC2', 8, 8),
+	'ivec3': (None, 'glm::ivec3', 'GL_INT_VEC3', 12, 16),
+	'ivec4': (None, 'glm::ivec4', 'GL_INT_VEC4', 16, 16),
+	# Matrix columns are padded to vec4 in std140.
+	'mat2': ('glm::mat2', 'glm::mat2x4', 'GL_FLOAT_MAT2', 32, 16),
+	'mat3': ('glm::mat3', 'glm::mat3x4', 'GL_FLOAT_MAT3', 48, 16),
+	'mat4': ('glm::mat4', 'glm::mat4', 'GL_FLOAT_MAT4', 64, 16),
+}
+
+SAMPLERS = {
+	'sampler2D': 'GL_SAMPLER_2D',
+	'sampler3D': 'GL_SAMPLER_3D',
+	'samplerCube': 'GL_SAMPLER_CUBE',
+}
+
+# Block whose members materials set one by one, see UniformBlocks.
+MATERIAL_BLOCK = 'MaterialData'
+
+INCLUDE = re.compile(r'^\s*#\s*include\s+"([^"]+)"', re.M)
+STRUCT = re.compile(r'\bstruct\s+(\w+)\s*\{([^}]*)\}\s*;')
+BLOCK = re.compile(r'(?:layout\s*\(([^)]*)\)\s*)?\buniform\s+(\w+)\s*\{([^}]*)\}\s*(\w+)?\s*;')
+UNIFORM = re.compile(r'(?:layout\s*\([^)]*\)\s*)?\buniform\s+(\w+)\s+(\w+)\s*(?:\[\s*(\d+)\s*\])?\s*;')
+ATTRIBUTE = re.compile(r'layout\s*\(\s*location\s*=\s*(\d+)\s*\)\s*in\s+(\w+)\s+(\w+)\s*;')
+MEMBER = re.compile(r'^(\w+)\s+(\w+)\s*(?:\[\s*(\d+)\s*\])?$')
+
+
+class ReflectError(Exception):
+	pass
+
+
+def round_up(value, alignment):
+	return (value + alignment - 1) // alignment * alignment
+
+
+def read(path, seen=None):
+	# Includes are spliced in once each, every #if branch is kept.
+	seen = seen if seen is not None else set()
+	path = os.path.normpath(path)
+	if path in seen:
+		return ''
+	seen.add(path)
+	with open(path) as f:
+		text = f.read()
+	directory = os.path.dirname(path)
+	return INCLUDE.sub(lambda m: read(os.path.join(directory, m.group(1)), seen), text)
+
+
+def strip(text):
+	text = re.sub(r'/\*.*?\*/', '', text, flags=re.S)
+	text = re.sub(r'//[^\n]*', '', text)
+	return '\n'.join(line for line in text.split('\n') if not line.strip().startswith('#'))
+
+
+def parse_members(body, where):
+	members = []
+	for statement in body.split(';'):
+		statement = ' '.join(statement.split())
+		if not statement:
+			continue
+		type, _, names = statement.partition(' ')
+		for name in names.split(','):
+			m = MEMBER.match(type + ' ' + name.strip())
+			if not m:
+				raise ReflectError('%s: cannot parse "%s"' % (where, statement))
+			members.append((m.group(1), m.group(2), int(m.group(3)) if m.group(3) else 0))
+	return members
+
+
+class Program:
+	def __init__(self, name, paths):
+		self.name = name
+		self.paths = paths
+		self.attributes = {}
+		self.uniforms = {}
+		self.structs = {}
+		self.blocks = {}
+
+	def add(self, table, key, value, path):
+		if key in table and table[key] != value:
+			raise ReflectError('%s: "%s" redeclared differently' % (path, key))
+		table[key] = value
+
+	def parse(self, path):
+		text = strip(read(path))
+		for m in STRUCT.finditer(text):
+			self.add(self.structs, m.group(1), parse_members(m.group(2), path), path)
+		for m in BLOCK.finditer(text):
+			if m.group(1) and 'std140' not in m.group(1):
+				raise ReflectError('%s: block %s is not std140' % (path, m.group(2)))
+			self.add(self.blocks, m.group(2), parse_members(m.group(3), path), path)
+		for m in UNIFORM.finditer(text):
+			self.add(self.uniforms, m.group(2), (m.group(1), int(m.group(3)) if m.group(3) else 0), path)
+		if path.endswith('.vs'):
+			for m in ATTRIBUTE.finditer(text):
+				self.add(self.attributes, m.group(3), (int(m.group(1)), m.group(2)), path)
+
+	# std140 (alignment, size) of a member type, structs included.
+	def measure(self, type, count):
+		if type in TYPES:
+			size, alignment = TYPES[type][3], TYPES[type][4]
+		elif type in self.structs:
+			alignment = 16
+			size = round_up(self.layout(self.structs[type])[1], 16)
+		else:
+			raise ReflectError('%s: unsupported type %s' % (self.name, type))
+		if count:
+			alignment = round_up(alignment, 16)
+			size = round_up(size, 16) * count
+		return alignment, size
+
+	# Offset of each member and the total size.
+	def layout(self, members):
+		offsets = []
+		offset = 0
+		for type, name, count in members:
+			alignment, size = self.measure(type, count)
+			offset = round_up(offset, alignment)
+			offsets.append(offset)
+			offset += size
+		return offsets, offset
+
+	def emit_struct(self, name, members, lines):
+		offsets, size = self.layout(members)
+		size = round_up(size, 16)
+
+		lines.append('\tstruct %s {' % name)
+		position = 0
+		pad = 0
+		for (type, member, count), offset in zip(members, offsets):
+			if offset > position:
+				lines.append('\t\tuint8_t pad%d[%d];' % (pad, offset - position))
+				pad += 1
+			storage = TYPES[type][1] if type in TYPES else type
+			if count:
+				element = TYPES[type][3] if type in TYPES else round_up(self.layout(self.structs[type])[1], 16)
+				if element % 16:
+					storage = 'Std140Element<%s>' % storage
+				lines.append('\t\t%s %s[%d];' % (storage, member, count))
+			else:
+				lines.append('\t\t%s %s;' % (storage, member))
+			position = offset + self.measure(type, count)[1]
+		if size > position:
+			lines.append('\t\tuint8_t pad%d[%d];' % (pad, size - position))
+		lines.append('\t};')
+		lines.append('\tstatic_assert(sizeof(%s) == %d, "std140 size of %s");' % (name, size, name))
+		for (type, member, count), offset in zip(members, offsets):
+			lines.append('\tstatic_assert(offsetof(%s, %s) == %d, "std140 offset of %s.%s");' % (name, member, offset, name, member))
+		lines.append('')
+
+	def emit(self):
+		lines = ['namespace %s {' % self.name, '\t// ' + ', '.join(self.paths), '']
+
+		if self.attributes:
+			for name, (location, type) in sorted(self.attributes.items(), key=lambda a: a[1][0]):
+				lines.append('\tstatic constexpr ShaderAttribute %s = { %d, %s, "%s" };' % (name, location, TYPES[type][2] if type in TYPES else 'GL_NONE', name))
+			lines.append('')
+
+		# Plain uniforms and the members of MaterialData, as material values see them.
+		# The engine fills the other blocks whole, through their structs.
+		descriptors = []
+		for name, (type, count) in sorted(self.uniforms.items()):
+			if type in SAMPLERS:
+				descriptors.append('\tstatic constexpr ShaderSampler %s = { UniformId("%s"), %s, "%s" };' % (name, name, SAMPLERS[type], name))
+			elif type in TYPES and TYPES[type][0] and not count:
+				descriptors.append('\tstatic constexpr ShaderUniform<%s> %s = { UniformId("%s"), %s, "%s" };' % (TYPES[type][0], name, name, TYPES[type][2], name))
+		for type, name, count in self.blocks.get(MATERIAL_BLOCK, []):
+			if type in TYPES and TYPES[type][0] and not count and name not in self.uniforms:
+				descriptors.append('\tstatic constexpr ShaderUniform<%s> %s = { UniformId("%s"), %s, "%s" }; // %s' % (TYPES[type][0], name, name, TYPES[type][2], name, MATERIAL_BLOCK))
+		if descriptors:
+			lines += descriptors + ['']
+
+		emitted = set()
+
+		def emit_structs(members):
+			for type, _, _ in members:
+				if type in self.structs and type not in emitted:
+					emit_structs(self.structs[type])
+					self.emit_struct(type, self.structs[type], lines)
+					emitted.add(type)
+
+		for block, members in sorted(self.blocks.items()):
+			emit_structs(members)
+			self.emit_struct(block, members, lines)
+
+		while lines[-1] == '':
+			lines.pop()
+		lines.append('} // namespace %s' % self.name)
+		return lines
+
+
+def generate(paths):
+	programs = {}
+	for path in sorted(paths):
+		stem, extension = os.path.splitext(os.path.basename(path))
+		if extension not in ('.vs', '.fs'):
+			continue
+		if stem not in programs:
+			programs[stem] = Program(stem, [])
+		programs[stem].paths.append(os.path.relpath(path))
+		programs[stem].parse(path)
+
+	lines = [
+		'// Generated by site_scons/shader_reflect.py from the GLSL sources, do not edit.',
+		'',
+		'#ifndef _SHADER_REFLECTION_HPP',
+		'#define _SHADER_REFLECTION_HPP',
+		'',
+		'#include <cstddef>',
+		'#include <shader/reflection.hpp>',
+		'',
+		'namespace ShaderReflection {',
+		'',
+	]
+	for name in sorted(programs):
+		lines += programs[name].emit() + ['']
+	lines += ['} // namespace ShaderReflection', '', '#endif /* _SHADER_REFLECTION_HPP */', '']
+	return '\n'.join(lines)
+
+
+# SCons builder action.
+def reflect_shaders(target, source, env):
+	try:
+		output = generate([str(s) for s in source])
+	except ReflectError as e:
+		print('shader_reflect: %s' % e)
+		return 1
+	with open(str(target[0]), 'w') as f:
+		f.write(output)
+	return 0
+
+
+if __name__ == '__main__':
+	if len(sys.argv) < 3:
+		print('usage: shader_reflect.py output.hpp shader...')
+		sys.exit(1)
+	output = generate(sys.argv[2:])
+	directory = os.path.dirname(sys.argv[1])
+	if directory and not os.path.isdir(directory):
+		os.makedirs(directory)
+	with open(sys.argv[1], 'w') as f:
+		f.write(output)
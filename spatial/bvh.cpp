@@ -0,0 +1,479 @@
+#include "bvh.hpp"
+#include <jobs/parallel.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+static const int BINS = 16;
+
+// Subtrees below this size are not worth a task of their own.
+static const uint32_t MIN_TASK_SIZE = 1024;
+
+bool IntersectTriangle(const glm::vec3& origin, const glm::vec3& dir, const glm::vec3* triangle, float& t) {
+
+	const float EPSILON = 1e-7f;
+
+	glm::vec3 e1 = triangle[1] - triangle[0];
+	glm::vec3 e2 = triangle[2] - triangle[0];
+	glm::vec3 h  = glm::cross(dir, e2);
+	float	 a  = glm::dot(e1, h);
+	if (std::abs(a) < EPSILON) {
+		return false;
+	}
+
+	float	 f = 1.0f / a;
+	glm::vec3 s = origin - triangle[0];
+	float	 u = f * glm::dot(s, h);
+	if (u < 0.0f || u > 1.0f) {
+		return false;
+	}
+
+	glm::vec3 q = glm::cross(s, e1);
+	float	 v = f * glm::dot(dir, q);
+	if (v < 0.0f || u + v > 1.0f) {
+		return false;
+	}
+
+	t = f * glm::dot(e2, q);
+	return t >= 0.0f;
+}
+
+static float SurfaceArea(const glm::vec3& lo, const glm::vec3& hi) {
+	glm::vec3 d = glm::max(hi - lo, glm::vec3(0.0f));
+	return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+bool BVH::Split(uint32_t first, uint32_t count, const glm::vec3& lo, const glm::vec3& hi, uint32_t& mid) {
+
+	glm::vec3 extent = hi - lo;
+	int		  axis   = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+	if (extent[axis] < 1e-12f) {
+		return false;
+	}
+
+	const float scale = BINS / extent[axis];
+	auto		binOf = [&](uint32_t prim) {
+		   return std::min(BINS - 1, (int)((m_Centroids[prim][axis] - lo[axis]) * scale));
+	};
+
+	uint32_t  counts[BINS] = {};
+	glm::vec3 binMin[BINS];
+	glm::vec3 binMax[BINS];
+	std::fill(binMin, binMin + BINS, glm::vec3(FLT_MAX));
+	std::fill(binMax, binMax + BINS, glm::vec3(-FLT_MAX));
+
+	for (uint32_t i = first; i < first + count; i++) {
+		uint32_t prim = m_Primitives[i];
+		int		 b	= binOf(prim);
+		counts[b]++;
+		binMin[b] = glm::min(binMin[b], m_Input[prim].min);
+		binMax[b] = glm::max(binMax[b], m_Input[prim].max);
+	}
+
+	// Sweep from the right, then from the left evaluating each split plane.
+	float	 rightArea[BINS];
+	uint32_t rightCount[BINS];
+	glm::vec3 accMin(FLT_MAX), accMax(-FLT_MAX);
+	uint32_t  acc = 0;
+	for (int b = BINS - 1; b > 0; b--) {
+		accMin		  = glm::min(accMin, binMin[b]);
+		accMax		  = glm::max(accMax, binMax[b]);
+		acc			  += counts[b];
+		rightArea[b]  = acc ? SurfaceArea(accMin, accMax) : 0.0f;
+		rightCount[b] = acc;
+	}
+
+	float bestCost = FLT_MAX;
+	int	  bestBin  = -1;
+	accMin		   = glm::vec3(FLT_MAX);
+	accMax		   = glm::vec3(-FLT_MAX);
+	acc			   = 0;
+	for (int b = 0; b < BINS - 1; b++) {
+		accMin = glm::min(accMin, binMin[b]);
+		accMax = glm::max(accMax, binMax[b]);
+		acc += counts[b];
+		if (!acc || !rightCount[b + 1]) {
+			continue;
+		}
+		float cost = acc * SurfaceArea(accMin, accMax) + rightCount[b + 1] * rightArea[b + 1];
+		if (cost < bestCost) {
+			bestCost = cost;
+			bestBin  = b;
+		}
+	}
+	if (bestBin < 0) {
+		return false;
+	}
+
+	uint32_t* begin = m_Primitives.data() + first;
+	uint32_t* split = std::partition(begin, begin + count, [&](uint32_t prim) { return binOf(prim) <= bestBin; });
+	mid				= first + (uint32_t)(split - begin);
+	return mid != first && mid != first + count;
+}
+
+int32_t BVH::BuildRecursive(std::vector<BuildNode>& nodes, uint32_t first, uint32_t count, uint32_t depth, std::vector<BuildTask>* tasks, uint32_t taskSize) {
+
+	glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+	glm::vec3 cLo(FLT_MAX), cHi(-FLT_MAX);
+	for (uint32_t i = first; i < first + count; i++) {
+		uint32_t prim = m_Primitives[i];
+		lo			  = glm::min(lo, m_Input[prim].min);
+		hi			  = glm::max(hi, m_Input[prim].max);
+		cLo			  = glm::min(cLo, m_Centroids[prim]);
+		cHi			  = glm::max(cHi, m_Centroids[prim]);
+	}
+
+	int32_t index = (int32_t)nodes.size();
+	nodes.push_back({ lo, hi, -1, -1, first, count, -1 });
+
+	if (count <= MAX_LEAF_SIZE) {
+		return index;
+	}
+
+	if (tasks && count <= taskSize) {
+		nodes[index].task = (int32_t)tasks->size();
+		tasks->push_back({ first, count, depth, index, {} });
+		return index;
+	}
+
+	// Coincident centroids, or a run of lopsided splits deep enough to threaten
+	// MAX_DEPTH, fall back to an even split.
+	uint32_t mid;
+	if (depth + 32 >= MAX_DEPTH || !Split(first, count, cLo, cHi, mid)) {
+		mid = first + count / 2;
+	}
+
+	int32_t left		= BuildRecursive(nodes, first, mid - first, depth + 1, tasks, taskSize);
+	int32_t right		= BuildRecursive(nodes, mid, first + count - mid, depth + 1, tasks, taskSize);
+	nodes[index].left  = left;
+	nodes[index].right = right;
+	return index;
+}
+
+int32_t BVH::Collapse(const std::vector<BuildNode>& nodes, int32_t index) {
+
+	const BuildNode& build = nodes[index];
+	if (build.left < 0) {
+		m_Leaves.push_back({ build.first, build.count });
+		return ~(int32_t)(m_Leaves.size() - 1);
+	}
+
+	// Pull grandchildren up, largest first, until the node is full.
+	int32_t children[WIDTH] = { build.left, build.right };
+	uint32_t count			= 2;
+	while (count < WIDTH) {
+		int	  best	 = -1;
+		float bestArea = -1.0f;
+		for (uint32_t c = 0; c < count; c++) {
+			const BuildNode& child = nodes[children[c]];
+			float			 area  = SurfaceArea(child.min, child.max);
+			if (child.left >= 0 && area > bestArea) {
+				best	 = c;
+				bestArea = area;
+			}
+		}
+		if (best < 0) {
+			break;
+		}
+		const BuildNode& expand = nodes[children[best]];
+		children[best]			= expand.left;
+		children[count++]		= expand.right;
+	}
+
+	int32_t nodeIndex = (int32_t)m_Nodes.size();
+	m_Nodes.push_back(Node());
+
+	Node& node = m_Nodes[nodeIndex];
+	for (uint32_t c = 0; c < WIDTH; c++) {
+		node.minX[c] = node.minY[c] = node.minZ[c] = FLT_MAX;
+		node.maxX[c] = node.maxY[c] = node.maxZ[c] = -FLT_MAX;
+		node.child[c]							   = 0;
+	}
+	node.count = count;
+
+	for (uint32_t c = 0; c < count; c++) {
+		const BuildNode& child = nodes[children[c]];
+		int32_t			 slot  = Collapse(nodes, children[c]);
+
+		Node& n	= m_Nodes[nodeIndex];
+		n.minX[c]  = child.min.x;
+		n.minY[c]  = child.min.y;
+		n.minZ[c]  = child.min.z;
+		n.maxX[c]  = child.max.x;
+		n.maxY[c]  = child.max.y;
+		n.maxZ[c]  = child.max.z;
+		n.child[c] = slot;
+	}
+	return nodeIndex;
+}
+
+void BVH::Build(const Bounds* primitives, uint32_t count) {
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	m_Nodes.clear();
+	m_Leaves.clear();
+	m_Primitives.resize(count);
+	std::iota(m_Primitives.begin(), m_Primitives.end(), 0);
+
+	if (count) {
+		m_Input = primitives;
+		m_Centroids.resize(count);
+		for (uint32_t i = 0; i < count; i++) {
+			m_Centroids[i] = (primitives[i].min + primitives[i].max) * 0.5f;
+		}
+
+		// Split the top serially until there is a handful of subtrees per worker.
+		std::vector<BuildNode> nodes;
+		std::vector<BuildTask> tasks;
+		uint32_t			   taskSize = std::max(MIN_TASK_SIZE, count / (GetWorkerCount() * 4));
+		BuildRecursive(nodes, 0, count, 0, &tasks, taskSize);
+
+		ParallelFor((uint32_t)tasks.size(), 1, [&](uint32_t begin, uint32_t end, uint32_t) {
+			for (uint32_t t = begin; t < end; t++) {
+				BuildRecursive(tasks[t].nodes, tasks[t].first, tasks[t].count, tasks[t].depth, nullptr, 0);
+			}
+		});
+
+		// Splice the subtrees in, the task root replaces its placeholder.
+		for (BuildTask& task : tasks) {
+			const int32_t offset = (int32_t)nodes.size() - 1;
+			auto		  remap  = [&](int32_t i) { return i < 0 ? i : (i == 0 ? task.placeholder : offset + i); };
+
+			for (size_t i = 0; i < task.nodes.size(); i++) {
+				BuildNode node = task.nodes[i];
+				node.left	  = remap(node.left);
+				node.right	 = remap(node.right);
+				if (i == 0) {
+					nodes[task.placeholder] = node;
+				} else {
+					nodes.push_back(node);
+				}
+			}
+		}
+
+		if (nodes[0].left < 0) {
+			// Few enough primitives for a single leaf, which still needs a root to hang from.
+			m_Nodes.push_back(Node());
+			Node& root = m_Nodes[0];
+			for (uint32_t c = 0; c < WIDTH; c++) {
+				root.minX[c] = root.minY[c] = root.minZ[c] = FLT_MAX;
+				root.maxX[c] = root.maxY[c] = root.maxZ[c] = -FLT_MAX;
+				root.child[c]							   = 0;
+			}
+			root.minX[0]  = nodes[0].min.x;
+			root.minY[0]  = nodes[0].min.y;
+			root.minZ[0]  = nodes[0].min.z;
+			root.maxX[0]  = nodes[0].max.x;
+			root.maxY[0]  = nodes[0].max.y;
+			root.maxZ[0]  = nodes[0].max.z;
+			root.child[0] = Collapse(nodes, 0);
+			root.count	  = 1;
+		} else {
+			Collapse(nodes, 0);
+		}
+
+		m_Input = nullptr;
+		m_Centroids.clear();
+		m_Centroids.shrink_to_fit();
+	}
+
+	auto stop = std::chrono::high_resolution_clock::now();
+
+	m_Stats.buildMilliseconds = std::chrono::duration<float, std::milli>(stop - start).count();
+	m_Stats.nodes			  = (uint32_t)m_Nodes.size();
+	m_Stats.leaves			  = (uint32_t)m_Leaves.size();
+	m_Stats.primitives		  = count;
+}
+
+void BVH::Build(const BoundsTable& table) {
+
+	std::vector<Bounds> primitives(table.GetCount());
+	for (uint32_t i = 0; i < table.GetCount(); i++) {
+		primitives[i] = table.Get(i);
+	}
+	Build(primitives.data(), (uint32_t)primitives.size());
+}
+
+void BVH::Refit(const Bounds* primitives) {
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// Children always come after their parent, so walk backwards.
+	for (size_t n = m_Nodes.size(); n-- > 0;) {
+		Node& node = m_Nodes[n];
+		for (uint32_t c = 0; c < node.count; c++) {
+			glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+			int32_t	  child = node.child[c];
+			if (child < 0) {
+				const Leaf& leaf = m_Leaves[~child];
+				for (uint32_t i = leaf.first; i < leaf.first + leaf.count; i++) {
+					lo = glm::min(lo, primitives[m_Primitives[i]].min);
+					hi = glm::max(hi, primitives[m_Primitives[i]].max);
+				}
+			} else {
+				const Node& sub = m_Nodes[child];
+				for (uint32_t s = 0; s < sub.count; s++) {
+					lo = glm::min(lo, glm::vec3(sub.minX[s], sub.minY[s], sub.minZ[s]));
+					hi = glm::max(hi, glm::vec3(sub.maxX[s], sub.maxY[s], sub.maxZ[s]));
+				}
+			}
+			node.minX[c] = lo.x;
+			node.minY[c] = lo.y;
+			node.minZ[c] = lo.z;
+			node.maxX[c] = hi.x;
+			node.maxY[c] = hi.y;
+			node.maxZ[c] = hi.z;
+		}
+	}
+
+	auto stop = std::chrono::high_resolution_clock::now();
+
+	m_Stats.refitMilliseconds = std::chrono::duration<float, std::milli>(stop - start).count();
+}
+
+void BVH::Refit(const BoundsTable& table) {
+
+	std::vector<Bounds> primitives(table.GetCount());
+	for (uint32_t i = 0; i < table.GetCount(); i++) {
+		primitives[i] = table.Get(i);
+	}
+	Refit(primitives.data());
+}
+
+glm::vec3 BVH::InverseDirection(const glm::vec3& dir) {
+
+	const float TINY = 1e-20f;
+
+	glm::vec3 safe;
+	for (int a = 0; a < 3; a++) {
+		safe[a] = std::abs(dir[a]) < TINY ? std::copysign(TINY, dir[a]) : dir[a];
+	}
+	return 1.0f / safe;
+}
+
+uint32_t BVH::IntersectNode(const Node& node, const glm::vec3& origin, const glm::vec3& invDir, float tMax, float* tNear) {
+
+#if defined(__SSE2__)
+	const __m128 ox = _mm_set1_ps(origin.x);
+	const __m128 oy = _mm_set1_ps(origin.y);
+	const __m128 oz = _mm_set1_ps(origin.z);
+	const __m128 ix = _mm_set1_ps(invDir.x);
+	const __m128 iy = _mm_set1_ps(invDir.y);
+	const __m128 iz = _mm_set1_ps(invDir.z);
+
+	__m128 t0x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minX), ox), ix);
+	__m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxX), ox), ix);
+	__m128 t0y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minY), oy), iy);
+	__m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxY), oy), iy);
+	__m128 t0z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minZ), oz), iz);
+	__m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxZ), oz), iz);
+
+	__m128 enter = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0x, t1x), _mm_min_ps(t0y, t1y)), _mm_max_ps(_mm_min_ps(t0z, t1z), _mm_setzero_ps()));
+	__m128 exit  = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0x, t1x), _mm_max_ps(t0y, t1y)), _mm_min_ps(_mm_max_ps(t0z, t1z), _mm_set1_ps(tMax)));
+
+	_mm_storeu_ps(tNear, enter);
+	return (uint32_t)_mm_movemask_ps(_mm_cmple_ps(enter, exit));
+#else
+	uint32_t mask = 0;
+	for (uint32_t c = 0; c < WIDTH; c++) {
+		glm::vec3 t0	= (glm::vec3(node.minX[c], node.minY[c], node.minZ[c]) - origin) * invDir;
+		glm::vec3 t1	= (glm::vec3(node.maxX[c], node.maxY[c], node.maxZ[c]) - origin) * invDir;
+		glm::vec3 lo	= glm::min(t0, t1);
+		glm::vec3 hi	= glm::max(t0, t1);
+		float	 enter = std::max(std::max(lo.x, lo.y), std::max(lo.z, 0.0f));
+		float	 exit  = std::min(std::min(hi.x, hi.y), std::min(hi.z, tMax));
+		tNear[c]		= enter;
+		mask |= (enter <= exit) << c;
+	}
+	return mask;
+#endif
+}
+
+void BVH::Query(const Frustum& frustum, std::vector<uint32_t>& primitives) const {
+
+	if (m_Nodes.empty()) {
+		return;
+	}
+
+	int32_t stack[STACK_SIZE];
+	int		top	= 0;
+	stack[top++] = 0;
+
+	while (top) {
+		int32_t index = stack[--top];
+		if (index < 0) {
+			const Leaf& leaf = m_Leaves[~index];
+			primitives.insert(primitives.end(), m_Primitives.begin() + leaf.first, m_Primitives.begin() + leaf.first + leaf.count);
+			continue;
+		}
+
+		const Node& node = m_Nodes[index];
+		uint32_t	mask = (1u << node.count) - 1;
+
+#if defined(__SSE2__)
+		// The farthest corner along a plane is max(n * min, n * max) per axis.
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (const glm::vec4& plane : frustum.planes) {
+			__m128 nx = _mm_set1_ps(plane.x);
+			__m128 ny = _mm_set1_ps(plane.y);
+			__m128 nz = _mm_set1_ps(plane.z);
+			__m128 d  = _mm_max_ps(_mm_mul_ps(nx, _mm_load_ps(node.minX)), _mm_mul_ps(nx, _mm_load_ps(node.maxX)));
+			d		  = _mm_add_ps(d, _mm_max_ps(_mm_mul_ps(ny, _mm_load_ps(node.minY)), _mm_mul_ps(ny, _mm_load_ps(node.maxY))));
+			d		  = _mm_add_ps(d, _mm_max_ps(_mm_mul_ps(nz, _mm_load_ps(node.minZ)), _mm_mul_ps(nz, _mm_load_ps(node.maxZ))));
+			d		  = _mm_add_ps(d, _mm_set1_ps(plane.w));
+			inside	= _mm_and_ps(inside, _mm_cmpge_ps(d, _mm_setzero_ps()));
+		}
+		mask &= (uint32_t)_mm_movemask_ps(inside);
+#else
+		for (uint32_t c = 0; c < node.count; c++) {
+			Bounds b = { glm::vec3(node.minX[c], node.minY[c], node.minZ[c]), glm::vec3(node.maxX[c], node.maxY[c], node.maxZ[c]) };
+			if (!frustum.Intersects(b)) {
+				mask &= ~(1u << c);
+			}
+		}
+#endif
+
+		for (uint32_t c = 0; c < node.count; c++) {
+			if (mask & (1 << c)) {
+				stack[top++] = node.child[c];
+			}
+		}
+	}
+}
+
+void BVH::Query(const Bounds& bounds, std::vector<uint32_t>& primitives) const {
+
+	if (m_Nodes.empty()) {
+		return;
+	}
+
+	int32_t stack[STACK_SIZE];
+	int		top	= 0;
+	stack[top++] = 0;
+
+	while (top) {
+		int32_t index = stack[--top];
+		if (index < 0) {
+			const Leaf& leaf = m_Leaves[~index];
+			primitives.insert(primitives.end(), m_Primitives.begin() + leaf.first, m_Primitives.begin() + leaf.first + leaf.count);
+			continue;
+		}
+
+		const Node& node = m_Nodes[index];
+		for (uint32_t c = 0; c < node.count; c++) {
+			if (node.minX[c] <= bounds.max.x && node.maxX[c] >= bounds.min.x &&
+					node.minY[c] <= bounds.max.y && node.maxY[c] >= bounds.min.y &&
+					node.minZ[c] <= bounds.max.z && node.maxZ[c] >= bounds.min.z) {
+				stack[top++] = node.child[c];
+			}
+		}
+	}
+}
@@ -0,0 +1,208 @@
+
+#ifndef _BVH_HPP
+#define _BVH_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <culling/frustum.hpp>
+#include <glm/glm.hpp>
+#include <model/bounds.hpp>
+
+// Moller-Trumbore, returns true and the distance along dir when the ray hits.
+bool IntersectTriangle(const glm::vec3& origin, const glm::vec3& dir, const glm::vec3* triangle, float& t);
+
+/*
+ * Bounding Volume Hierarchy class
+ * Four wide BVH over primitive bounds (objects or triangles), built with a
+ * binned SAH on a binary tree whose top is split serially and whose
+ * subtrees are built in parallel, then collapsed into 4 wide nodes that
+ * are tested with SSE. Topology is kept on Refit, which only recomputes
+ * boxes, for primitives that move.
+ * Ray queries take a functor test(primitive, origin, dir, tMax) returning
+ * the hit distance or a negative value, so the same tree serves triangles,
+ * boxes or anything else with bounds.
+ */
+
+class BVH {
+public:
+	static const uint32_t WIDTH = 4;
+
+	struct alignas(16) Node {
+		float	minX[WIDTH], minY[WIDTH], minZ[WIDTH];
+		float	maxX[WIDTH], maxY[WIDTH], maxZ[WIDTH];
+		int32_t  child[WIDTH]; // >= 0 inner node, < 0 leaf ~index
+		uint32_t count;
+	};
+
+	struct Leaf {
+		uint32_t first; // Into the primitive order
+		uint32_t count;
+	};
+
+	struct Stats {
+		float	buildMilliseconds;
+		float	refitMilliseconds;
+		uint32_t nodes;
+		uint32_t leaves;
+		uint32_t primitives;
+	};
+
+private:
+	struct BuildNode {
+		glm::vec3 min, max;
+		int32_t   left, right; // -1 for leaves
+		uint32_t  first, count;
+		int32_t   task; // Subtree built in parallel, -1 if none
+	};
+
+	struct BuildTask {
+		uint32_t			   first, count;
+		uint32_t			   depth;
+		int32_t				   placeholder;
+		std::vector<BuildNode> nodes;
+	};
+
+	// Levels of the binary tree at most. SAH splits stop 32 levels short, even splits
+	// of the rest always fit. Collapsing never deepens the tree, so a traversal
+	// stack holds at most WIDTH - 1 siblings per level plus the node popped.
+	static const uint32_t MAX_DEPTH	 = 64;
+	static const uint32_t STACK_SIZE = (WIDTH - 1) * MAX_DEPTH + 1;
+
+	std::vector<Node>	 m_Nodes;
+	std::vector<Leaf>	 m_Leaves;
+	std::vector<uint32_t> m_Primitives;
+	Stats				  m_Stats = {};
+
+	// Build scratch
+	const Bounds*		  m_Input = nullptr;
+	std::vector<glm::vec3> m_Centroids;
+
+	int32_t BuildRecursive(std::vector<BuildNode>& nodes, uint32_t first, uint32_t count, uint32_t depth, std::vector<BuildTask>* tasks, uint32_t taskSize);
+	bool	Split(uint32_t first, uint32_t count, const glm::vec3& lo, const glm::vec3& hi, uint32_t& mid);
+	int32_t Collapse(const std::vector<BuildNode>& nodes, int32_t index);
+
+	// Zero direction components become tiny ones, so the slab test never multiplies 0 by infinity.
+	static glm::vec3 InverseDirection(const glm::vec3& dir);
+
+	// Slab test of a ray against the 4 boxes of a node, returns a hit mask.
+	static uint32_t IntersectNode(const Node& node, const glm::vec3& origin, const glm::vec3& invDir, float tMax, float* tNear);
+
+public:
+	static const uint32_t MAX_LEAF_SIZE = 4;
+
+	void Build(const Bounds* primitives, uint32_t count);
+	void Build(const BoundsTable& table);
+	void Refit(const Bounds* primitives);
+	void Refit(const BoundsTable& table);
+
+	// Nearest hit, tMax is shortened to the hit distance.
+	template <typename TestFunc>
+	bool Intersect(const glm::vec3& origin, const glm::vec3& dir, float& tMax, uint32_t& primitive, TestFunc test) const;
+
+	// True on the first hit closer than tMax, for shadow and visibility rays.
+	template <typename TestFunc>
+	bool Occluded(const glm::vec3& origin, const glm::vec3& dir, float tMax, TestFunc test) const;
+
+	void Query(const Frustum& frustum, std::vector<uint32_t>& primitives) const;
+	void Query(const Bounds& bounds, std::vector<uint32_t>& primitives) const;
+
+	bool		 IsBuilt() const { return !m_Nodes.empty(); }
+	const Stats& GetStats() const { return m_Stats; }
+};
+
+template <typename TestFunc>
+bool BVH::Intersect(const glm::vec3& origin, const glm::vec3& dir, float& tMax, uint32_t& primitive, TestFunc test) const {
+
+	if (m_Nodes.empty()) {
+		return false;
+	}
+
+	const glm::vec3 invDir = InverseDirection(dir);
+	bool			hit	= false;
+
+	int32_t stack[STACK_SIZE];
+	int		top	= 0;
+	stack[top++] = 0;
+
+	while (top) {
+		int32_t index = stack[--top];
+
+		if (index < 0) {
+			const Leaf& leaf = m_Leaves[~index];
+			for (uint32_t i = leaf.first; i < leaf.first + leaf.count; i++) {
+				float t = test(m_Primitives[i], origin, dir, tMax);
+				if (t >= 0.0f && t < tMax) {
+					tMax	  = t;
+					primitive = m_Primitives[i];
+					hit		  = true;
+				}
+			}
+			continue;
+		}
+
+		const Node& node = m_Nodes[index];
+		float		tNear[WIDTH];
+		uint32_t	mask = IntersectNode(node, origin, invDir, tMax, tNear);
+
+		// Push farthest first so the nearest child is visited next.
+		int32_t order[WIDTH];
+		int		n = 0;
+		for (uint32_t c = 0; c < node.count; c++) {
+			if (!(mask & (1 << c))) {
+				continue;
+			}
+			int k = n++;
+			while (k > 0 && tNear[order[k - 1]] < tNear[c]) {
+				order[k] = order[k - 1];
+				k--;
+			}
+			order[k] = c;
+		}
+		for (int k = 0; k < n; k++) {
+			stack[top++] = node.child[order[k]];
+		}
+	}
+	return hit;
+}
+
+template <typename TestFunc>
+bool BVH::Occluded(const glm::vec3& origin, const glm::vec3& dir, float tMax, TestFunc test) const {
+
+	if (m_Nodes.empty()) {
+		return false;
+	}
+
+	const glm::vec3 invDir = InverseDirection(dir);
+
+	int32_t stack[STACK_SIZE];
+	int		top	= 0;
+	stack[top++] = 0;
+
+	while (top) {
+		int32_t index = stack[--top];
+
+		if (index < 0) {
+			const Leaf& leaf = m_Leaves[~index];
+			for (uint32_t i = leaf.first; i < leaf.first + leaf.count; i++) {
+				float t = test(m_Primitives[i], origin, dir, tMax);
+				if (t >= 0.0f && t < tMax) {
+					return true;
+				}
+			}
+			continue;
+		}
+
+		const Node& node = m_Nodes[index];
+		float		tNear[WIDTH];
+		uint32_t	mask = IntersectNode(node, origin, invDir, tMax, tNear);
+		for (uint32_t c = 0; c < node.count; c++) {
+			if (mask & (1 << c)) {
+				stack[top++] = node.child[c];
+			}
+		}
+	}
+	return false;
+}
+
+#endif /* _BVH_HPP */
@@ -2,73 +2,181 @@
 #include "texture.hpp"
 #include <glad/glad.h>
 
+#include <memory>
 #include <stbi/stb_image.h>
 #include <stdexcept>
 
+bool TextureLoader::Decode(const std::string& filename, Image& image) {
+
+	image.data = stbi_load(filename.c_str(), &image.width, &image.height, &image.channels, 0);
+	return image.data != nullptr;
+}
+
+void TextureLoader::Free(Image& image) {
+
+	stbi_image_free(image.data);
+	image.data = nullptr;
+}
+
+// Specifies the bound texture from the image, the format follows the channel count.
+void TextureLoader::Upload(const Image& image, Params& params) {
+
+	params.dataType = GL_UNSIGNED_BYTE;
+
+	switch (image.channels) {
+		case 1: {
+			params.format = params.internalFormat = GL_RED;
+		}; break;
+		case 3: {
+			params.format = params.internalFormat = GL_RGB;
+		}; break;
+		case 4: {
+			params.format = params.internalFormat = GL_RGBA;
+		}; break;
+	}
+
+	glTexImage2D(GL_TEXTURE_2D, 0, params.internalFormat, image.width, image.height, 0, params.format, params.dataType, image.data);
+	if (params.mipmapped) {
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+}
+
 Texture* TextureLoader::Load(const std::string& name, const std::string& filename, Params params) {
 
 #ifndef NDEBUG
-	if (m_Textures.count(name)) {
+	if (m_Names.count(name)) {
 		throw std::runtime_error("TEX_LOAD::" + name + "_NOT_UNIQUE");
 	}
 #endif
 
-	params.dataType = GL_UNSIGNED_BYTE;
+	Image image;
+	if (!Decode(filename, image)) {
+		throw std::runtime_error("TEX::IMAGE_" + name + "_NOT_FOUND");
+	}
+
+	const Params requested = params;
 
 	uint32_t textureID;
 	glGenTextures(1, &textureID);
-	glBindTexture(GL_TEXTURE_2D, textureID);
-
-	int32_t  width;
-	int32_t  height;
-	int32_t  nrChannels;
-	uint8_t* data;
-
-	data = stbi_load(filename.c_str(), &width, &height, &nrChannels, 0);
-
-	if (data) {
-
-		switch (nrChannels) {
-			case 1: {
-				params.format = params.internalFormat = GL_RED;
-			}; break;
-			case 3: {
-				params.format = params.internalFormat = GL_RGB;
-			}; break;
-			case 4: {
-				params.format = params.internalFormat = GL_RGBA;
-			}; break;
-		}
+	GLState::BindTexture(0, GL_TEXTURE_2D, textureID);
 
-		glTexImage2D(GL_TEXTURE_2D, 0, params.internalFormat, width, height, 0, params.format, params.dataType, data);
-		if (params.mipmapped) {
-			glGenerateMipmap(GL_TEXTURE_2D);
-		}
-		stbi_image_free(data);
-	} else {
-		stbi_image_free(data);
-		throw std::runtime_error("TEX::IMAGE_" + name + "_NOT_FOUND");
-	}
+	Upload(image, params);
+	Free(image);
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, params.minFilter);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, params.magFilter);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, params.wrapS);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, params.wrapT);
 
-	return m_Textures[name] = new Texture{
+	Handle handle = m_Names[name] = m_Textures.Create(
 		textureID,
-		width, height, GL_TEXTURE_2D,
+		image.width, image.height, (GLenum)GL_TEXTURE_2D,
 		params.format, params.internalFormat,
 		params.magFilter, params.minFilter,
 		params.wrapS, params.wrapT,
-		params.mipmapped
+		(GLboolean)params.mipmapped);
+	m_Files[filename] = { handle, requested };
+	return m_Textures.Get(handle);
+}
+
+Texture* TextureLoader::LoadAsync(const std::string& name, const std::string& filename, Params params, UploadThread& uploads) {
+
+	if (!uploads.IsRunning()) {
+		return Load(name, filename, params);
+	}
+
+#ifndef NDEBUG
+	if (m_Names.count(name)) {
+		throw std::runtime_error("TEX_LOAD::" + name + "_NOT_UNIQUE");
+	}
+#endif
+
+	// Names are shared, the object itself is created by the first bind on the upload context.
+	uint32_t textureID;
+	glGenTextures(1, &textureID);
+
+	Handle handle = m_Names[name] = m_Textures.Create(
+		textureID,
+		0, 0, (GLenum)GL_TEXTURE_2D,
+		params.format, params.internalFormat,
+		params.magFilter, params.minFilter,
+		params.wrapS, params.wrapT,
+		(GLboolean)params.mipmapped,
+		false);
+	m_Files[filename] = { handle, params };
+
+	// Written by the upload, read by the completion once the fence says the upload is done.
+	struct Result {
+		Image  image;
+		Params params;
+		bool   decoded;
 	};
+	std::shared_ptr<Result> result = std::make_shared<Result>();
+	result->params				   = params;
+
+	uploads.Submit(
+		[result, filename, textureID]() {
+			result->decoded = Decode(filename, result->image);
+			if (!result->decoded) {
+				return;
+			}
+			Params& params = result->params;
+			GLState::BindTexture(0, GL_TEXTURE_2D, textureID);
+			Upload(result->image, params);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, params.minFilter);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, params.magFilter);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, params.wrapS);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, params.wrapT);
+			Free(result->image);
+		},
+		[this, result, handle, name, textureID]() {
+			// Unloaded meanwhile, the name was left for us since the upload could still be using it.
+			Texture* texture = m_Textures.Get(handle);
+			if (!texture) {
+				GLState::DeleteTextures(1, &textureID);
+				return;
+			}
+			if (!result->decoded) {
+				throw std::runtime_error("TEX::IMAGE_" + name + "_NOT_FOUND");
+			}
+			texture->width			= result->image.width;
+			texture->height			= result->image.height;
+			texture->internalFormat = result->params.internalFormat;
+			texture->format			= result->params.format;
+			texture->ready			= true;
+		});
+	return m_Textures.Get(handle);
+}
+
+bool TextureLoader::Reload(const std::string& filename, const Image& image) {
+
+	auto it = m_Files.find(filename);
+	if (it == m_Files.end()) {
+		return false;
+	}
+
+	Texture* texture = m_Textures.Get(it->second.texture);
+	Params	 params	 = it->second.params;
+	if (!texture->ready) {
+		// Still being uploaded on another context.
+		return false;
+	}
+
+	// Same id, so materials and anything else holding the texture pick it up.
+	GLState::BindTexture(0, texture->target, texture->id);
+	Upload(image, params);
+
+	texture->width			= image.width;
+	texture->height			= image.height;
+	texture->internalFormat = params.internalFormat;
+	texture->format			= params.format;
+	return true;
 }
 
 Texture* TextureLoader::Generate(const std::string& name, int height, int width, Params params) {
 
 #ifndef NDEBUG
-	if (m_Textures.count(name)) {
+	if (m_Names.count(name)) {
 		throw std::runtime_error("TEX_LOAD::" + name + "_NOT_UNIQUE");
 	}
 #endif
@@ -77,7 +185,7 @@ Texture* TextureLoader::Generate(const std::string& name, int height, int width,
 
 	uint32_t textureID;
 	glGenTextures(1, &textureID);
-	glBindTexture(GL_TEXTURE_2D, textureID);
+	GLState::BindTexture(0, GL_TEXTURE_2D, textureID);
 
 	glTexImage2D(GL_TEXTURE_2D, 0, params.internalFormat, width, height, 0, params.format, params.dataType, nullptr);
 
@@ -86,32 +194,60 @@ Texture* TextureLoader::Generate(const std::string& name, int height, int width,
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, params.wrapS);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, params.wrapT);
 
-	return m_Textures[name] = new Texture{
+	Handle handle = m_Names[name] = m_Textures.Create(
 		textureID,
-		width, height, GL_TEXTURE_2D,
+		(GLsizei)width, (GLsizei)height, (GLenum)GL_TEXTURE_2D,
 		params.format, params.internalFormat,
 		params.magFilter, params.minFilter,
 		params.wrapS, params.wrapT,
-		params.mipmapped
-	};
+		(GLboolean)params.mipmapped);
+	return m_Textures.Get(handle);
 }
 
-void TextureLoader::Delete(Texture* pTexture) {
+// A texture still uploading keeps its name, LoadAsync's completion deletes it.
+void TextureLoader::Delete(Handle handle) {
 
-	glDeleteTextures(1, &pTexture->id);
-	delete pTexture;
+	Texture* texture = m_Textures.Get(handle);
+	if (texture->ready) {
+		GLState::DeleteTextures(1, &texture->id);
+	}
+	m_Textures.Release(handle);
 }
 
 void TextureLoader::Unload(const std::string& name) {
 
-	Delete(m_Textures[name]);
-	m_Textures.erase(name);
+	auto it = m_Names.find(name);
+#ifndef NDEBUG
+	if (it == m_Names.end()) {
+		throw std::runtime_error("TEX::" + name + "_NOT_LOADED");
+	}
+	if (!m_Textures.Get(it->second)->ready) {
+		throw std::runtime_error("TEX::" + name + "_UNLOADED_UPLOADING");
+	}
+#endif
+
+	for (auto file = m_Files.begin(); file != m_Files.end(); ++file) {
+		if (file->second.texture == it->second) {
+			m_Files.erase(file);
+			break;
+		}
+	}
+	Delete(it->second);
+	m_Names.erase(it);
+}
+
+TextureLoader::Handle TextureLoader::Find(const std::string& name) const {
+
+	auto it = m_Names.find(name);
+	return it != m_Names.end() ? it->second : Handle();
 }
 
 TextureLoader::~TextureLoader() {
 
-	for (auto& p : m_Textures) {
-		Delete(p.second);
-	}
-	m_Textures.clear();
-}
\ No newline at end of file
+	m_Textures.ForEach([](Texture& texture) {
+		GLState::DeleteTextures(1, &texture.id);
+	});
+	m_Textures.Clear();
+	m_Names.clear();
+	m_Files.clear();
+}
@@ -2,19 +2,39 @@
 #ifndef _TEXTURE_HPP
 #define _TEXTURE_HPP
 
+#include <cstdint>
 #include <map>
 #include <string>
+#include <unordered_map>
 
 #include <glad/glad.h>
+#include <glstate/glstate.hpp>
+#include <resource/resource_pool.hpp>
+#include <upload/upload_thread.hpp>
 
-struct Texture;
-
-class TextureLoader {
-	std::map<std::string, Texture*> m_Textures;
+struct Texture {
+	const GLuint	id;
+	GLsizei			width; // Size and formats change on reload
+	GLsizei			height;
+	const GLenum	target;
+	GLint			internalFormat;
+	GLint			format;
+	const GLint		magFilter;
+	const GLint		minFilter;
+	const GLint		wrapS;
+	const GLint		wrapT;
+	const GLboolean mipmapped;
+	bool			ready = true; // False while uploading on another context
 
-	void Delete(Texture* pTexture);
+	void Bind(int unit = 0) {
+		GLState::BindTexture(unit, target, ready ? id : 0);
+	}
+};
 
+class TextureLoader {
 public:
+	typedef ResourcePool<Texture>::Handle Handle;
+
 	struct Params {
 		GLint internalFormat = GL_RGBA;
 		GLint format		 = GL_RGBA;
@@ -26,29 +46,48 @@ public:
 		bool  mipmapped		 = true;
 	};
 
+	// Decoded pixels. Decoding touches no GL state, so it may run on any thread.
+	struct Image {
+		int32_t	 width;
+		int32_t	 height;
+		int32_t	 channels;
+		uint8_t* data;
+	};
+
+private:
+	// A texture loaded from a file, by filename.
+	struct Source {
+		Handle texture;
+		Params params;
+	};
+
+	ResourcePool<Texture>					m_Textures;
+	std::unordered_map<std::string, Handle> m_Names;
+	std::map<std::string, Source>			m_Files;
+
+	static void Upload(const Image& image, Params& params);
+	void		Delete(Handle handle);
+
+public:
+	static bool Decode(const std::string& filename, Image& image);
+	static void Free(Image& image);
+
 	Texture* Load(const std::string& name, const std::string& filename, Params params);
+	// Decodes and uploads on the upload thread. The texture binds as 0 until its upload finished,
+	// see UploadThread::Update. Loads right away when the upload thread is not running.
+	Texture* LoadAsync(const std::string& name, const std::string& filename, Params params, UploadThread& uploads);
 	Texture* Generate(const std::string& name, int height, int width, Params params);
 	void	 Unload(const std::string& name);
-	~TextureLoader();
-};
 
-struct Texture {
-	const GLuint	id;
-	const GLsizei   width;
-	const GLsizei   height;
-	const GLenum	target;
-	const GLint		internalFormat;
-	const GLint		format;
-	const GLint		magFilter;
-	const GLint		minFilter;
-	const GLint		wrapS;
-	const GLint		wrapT;
-	const GLboolean mipmapped;
+	// Handles go stale on Unload, Get then returns null instead of a deleted texture.
+	Handle	 Find(const std::string& name) const;
+	Texture* Get(Handle handle) const { return m_Textures.Get(handle); }
 
-	void Bind(int unit = 0) {
-		glActiveTexture(GL_TEXTURE0 + unit);
-		glBindTexture(target, id);
-	}
+	// Respecifies the texture loaded from filename with a new decode of it, keeping the Texture and its id.
+	// False when nothing was loaded from the file.
+	bool Reload(const std::string& filename, const Image& image);
+
+	~TextureLoader();
 };
 
 #endif /* _TEXTURE_HPP */
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "upload_thread.hpp"
+#include <glstate/glstate.hpp>
+
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+
+void UploadThread::Main(Command init, Command exit) {
+
+	init();
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	while (true) {
+		m_Wake.wait(lock, [&] { return !m_Queue.empty() || m_Quit; });
+		if (m_Queue.empty()) {
+			break;
+		}
+
+		Pending pending = std::move(m_Queue.front());
+		m_Queue.pop_front();
+		lock.unlock();
+
+		// An upload that throws hands its error to the completion, to surface on the drawing thread.
+		auto start = std::chrono::high_resolution_clock::now();
+		try {
+			pending.upload();
+		} catch (...) {
+			std::exception_ptr error = std::current_exception();
+			pending.done			 = [error]() { std::rethrow_exception(error); };
+		}
+
+		// Names this context bound may be deleted on the drawing thread and handed out again,
+		// the shadow would then skip binding the new object. Rebind everything next time.
+		GLState::Invalidate();
+
+		// Flushed, or the fence might never reach the GPU from a context that draws nothing.
+		GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+		auto stop = std::chrono::high_resolution_clock::now();
+
+		lock.lock();
+		m_Fenced.push_back({ fence, std::move(pending.done) });
+		m_Stats.uploadMilliseconds += std::chrono::duration<float, std::milli>(stop - start).count();
+	}
+	lock.unlock();
+
+	exit();
+}
+
+void UploadThread::Start(Command init, Command exit) {
+
+#ifndef NDEBUG
+	if (IsRunning()) {
+		throw std::runtime_error("UPLD::RUNNING");
+	}
+#endif
+
+	m_Quit	 = false;
+	m_Thread = std::thread(&UploadThread::Main, this, std::move(init), std::move(exit));
+}
+
+void UploadThread::Stop() {
+
+	if (!IsRunning()) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Quit = true;
+	}
+	m_Wake.notify_one();
+	m_Thread.join();
+}
+
+void UploadThread::Submit(Command upload, Command done) {
+
+#ifndef NDEBUG
+	if (!IsRunning()) {
+		throw std::runtime_error("UPLD::NOT_RUNNING");
+	}
+#endif
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Queue.push_back({ std::move(upload), std::move(done) });
+		m_Stats.submitted++;
+	}
+	m_Wake.notify_one();
+}
+
+// Fences signal in order on one context, so the first one still pending ends the scan.
+uint32_t UploadThread::Update() {
+
+	uint32_t completed = 0;
+	while (true) {
+		Fenced fenced;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (m_Fenced.empty()) {
+				break;
+			}
+			GLenum status = glClientWaitSync(m_Fenced.front().fence, 0, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+				break;
+			}
+			fenced = std::move(m_Fenced.front());
+			m_Fenced.pop_front();
+			m_Stats.completed++;
+		}
+
+		glDeleteSync(fenced.fence);
+		if (fenced.done) {
+			fenced.done();
+		}
+		completed++;
+	}
+	return completed;
+}
+
+void UploadThread::Finish() {
+
+#ifndef NDEBUG
+	if (IsRunning()) {
+		throw std::runtime_error("UPLD::FINISH_WHILE_RUNNING");
+	}
+#endif
+
+	while (!m_Fenced.empty()) {
+		Fenced fenced = std::move(m_Fenced.front());
+		m_Fenced.pop_front();
+		m_Stats.completed++;
+
+		glClientWaitSync(fenced.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		glDeleteSync(fenced.fence);
+		if (fenced.done) {
+			fenced.done();
+		}
+	}
+}
+
+UploadThread::Stats UploadThread::GetStats() {
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Stats;
+}
+
+UploadThread::~UploadThread() {
+
+	Stop();
+}
@@ -0,0 +1,85 @@
+
+#ifndef _UPLOAD_THREAD_HPP
+#define _UPLOAD_THREAD_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include <glad/glad.h>
+
+/*
+ * Upload Thread class
+ * Creates and fills GPU resources on a thread of its own, current on a
+ * second context sharing objects with the one drawing. Each upload is
+ * followed by a fence; Update, called on the drawing thread, runs the
+ * upload's completion once its fence has signaled, so resources only
+ * become visible to draws after the GPU has them. Nothing on the
+ * drawing thread ever waits on an upload.
+ * Only objects shared between contexts may be touched by uploads:
+ * textures, buffers and programs, not vertex arrays. An upload that
+ * throws has its completion rethrow instead.
+ */
+
+class UploadThread {
+public:
+	using Command = std::function<void()>;
+
+	struct Stats {
+		uint32_t submitted;
+		uint32_t completed;		   // Fence signaled and completion run
+		float	 uploadMilliseconds; // Spent in uploads on the loader thread
+	};
+
+private:
+	struct Pending {
+		Command upload;
+		Command done;
+	};
+
+	struct Fenced {
+		GLsync	fence;
+		Command done;
+	};
+
+	std::thread m_Thread;
+	bool		m_Quit = false;
+
+	std::mutex				m_Mutex;
+	std::condition_variable m_Wake;
+	std::deque<Pending>		m_Queue;  // Waiting for the loader thread
+	std::deque<Fenced>		m_Fenced; // Uploaded, waiting for the GPU
+
+	Stats m_Stats = {};
+
+	void Main(Command init, Command exit);
+
+public:
+	// Runs init first thing on the new thread, making the shared context current, and exit last.
+	void Start(Command init, Command exit);
+
+	// Finishes the queued uploads, then joins the thread. Completions are left to Update or Finish.
+	void Stop();
+
+	bool IsRunning() const { return m_Thread.joinable(); }
+
+	// Runs upload on the loader thread, then done on the drawing thread once the GPU has the upload.
+	void Submit(Command upload, Command done);
+
+	// Drawing thread, once a frame. Runs the completions of uploads the GPU finished, in order.
+	uint32_t Update();
+	// Drawing thread, after Stop. Waits for every fence and runs the completions left.
+	void Finish();
+
+	Stats GetStats();
+
+	UploadThread() {}
+	UploadThread(const UploadThread&) = delete;
+	UploadThread& operator=(const UploadThread&) = delete;
+	~UploadThread();
+};
+
+#endif /* _UPLOAD_THREAD_HPP */
@@ -0,0 +1,80 @@
+#include "asset_reloader.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+static bool HasExtension(const std::string& path, const char* const* extensions) {
+
+	size_t dot = path.find_last_of('.');
+	if (dot == std::string::npos) {
+		return false;
+	}
+	for (; *extensions; extensions++) {
+		if (!std::strcmp(path.c_str() + dot, *extensions)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static const char* const SHADER_EXTENSIONS[] = { ".vs", ".fs", ".gs", ".glsl", nullptr };
+static const char* const IMAGE_EXTENSIONS[]	 = { ".png", ".jpg", ".jpeg", ".bmp", ".tga", nullptr };
+
+bool AssetReloader::Start(const std::string& root) {
+
+	return m_Watcher.Start(root, [this](const std::string& path) { OnChange(path); });
+}
+
+void AssetReloader::Stop() {
+
+	m_Watcher.Stop();
+}
+
+// Watcher thread. Images are decoded here whether or not they are loaded, Update sorts that out.
+void AssetReloader::OnChange(const std::string& path) {
+
+	if (HasExtension(path, SHADER_EXTENSIONS)) {
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (std::find(m_Sources.begin(), m_Sources.end(), path) == m_Sources.end()) {
+			m_Sources.push_back(path);
+		}
+	} else if (HasExtension(path, IMAGE_EXTENSIONS)) {
+		Decoded decoded = { path, {} };
+		if (TextureLoader::Decode(path, decoded.image)) {
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Images.push_back(std::move(decoded));
+		}
+	}
+}
+
+void AssetReloader::Update(ShaderLoader& shaders, TextureLoader& textures) {
+
+	std::vector<std::string> sources;
+	std::vector<Decoded>	 images;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_Sources.empty() && m_Images.empty()) {
+			return;
+		}
+		sources.swap(m_Sources);
+		images.swap(m_Images);
+	}
+
+	if (!sources.empty()) {
+		m_Stats.shaders += shaders.Reload(sources);
+	}
+	for (Decoded& decoded : images) {
+		if (textures.Reload(decoded.path, decoded.image)) {
+			m_Stats.textures++;
+		}
+		TextureLoader::Free(decoded.image);
+	}
+}
+
+AssetReloader::~AssetReloader() {
+
+	Stop();
+	for (Decoded& decoded : m_Images) {
+		TextureLoader::Free(decoded.image);
+	}
+}
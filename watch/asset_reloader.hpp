@@ -0,0 +1,59 @@
+
+#ifndef _ASSET_RELOADER_HPP
+#define _ASSET_RELOADER_HPP
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <shader/shader.hpp>
+#include <texture/texture.hpp>
+#include <watch/file_watcher.hpp>
+
+/*
+ * Asset Reloader class
+ * Hot reload of the shaders and textures under a directory. Changed
+ * images are decoded right away on the file watcher's thread, changed
+ * shader sources are only queued. Update hands both to the loaders and
+ * must be called between frames: textures are respecified in place and
+ * shaders are resubmitted, to replace their programs once linked, see
+ * ShaderLoader::Reload. Everything holding a Texture* or Shader* picks
+ * up the new version, and nothing waits on a compile.
+ */
+
+class AssetReloader {
+public:
+	struct Stats {
+		uint32_t shaders;  // Shaders resubmitted
+		uint32_t textures; // Textures respecified
+	};
+
+private:
+	struct Decoded {
+		std::string			 path;
+		TextureLoader::Image image;
+	};
+
+	FileWatcher m_Watcher;
+	Stats		m_Stats = {};
+
+	// Filled by the watcher thread.
+	std::mutex				 m_Mutex;
+	std::vector<std::string> m_Sources;
+	std::vector<Decoded>	 m_Images;
+
+	void OnChange(const std::string& path);
+
+public:
+	bool Start(const std::string& root);
+	void Stop();
+
+	void Update(ShaderLoader& shaders, TextureLoader& textures);
+
+	const Stats& GetStats() const { return m_Stats; }
+
+	~AssetReloader();
+};
+
+#endif /* _ASSET_RELOADER_HPP */
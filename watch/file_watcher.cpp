@@ -0,0 +1,142 @@
+#include "file_watcher.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include <dirent.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Writes, saves through a rename, and new directories.
+static const uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+
+bool FileWatcher::Start(const std::string& root, const Handler& handler, uint32_t settleMilliseconds) {
+
+	Stop();
+
+	m_Inotify = inotify_init1(IN_CLOEXEC);
+	m_Wake	  = eventfd(0, EFD_CLOEXEC);
+	if (m_Inotify < 0 || m_Wake < 0) {
+		Stop();
+		return false;
+	}
+
+	Watch(root);
+	if (m_Directories.empty()) {
+		Stop();
+		return false;
+	}
+
+	m_Handler			 = handler;
+	m_SettleMilliseconds = settleMilliseconds;
+	m_Thread			 = std::thread(&FileWatcher::Run, this);
+	return true;
+}
+
+void FileWatcher::Stop() {
+
+	if (m_Thread.joinable()) {
+		// An eventfd write only fails on counter overflow.
+		uint64_t one	 = 1;
+		ssize_t	 written = write(m_Wake, &one, sizeof(one));
+		(void)written;
+		m_Thread.join();
+	}
+	if (m_Inotify >= 0) {
+		close(m_Inotify);
+	}
+	if (m_Wake >= 0) {
+		close(m_Wake);
+	}
+	m_Inotify = -1;
+	m_Wake	  = -1;
+	m_Directories.clear();
+}
+
+// Adds the directory and everything below it.
+void FileWatcher::Watch(const std::string& directory) {
+
+	int wd = inotify_add_watch(m_Inotify, directory.c_str(), WATCH_MASK);
+	if (wd < 0) {
+		return;
+	}
+	m_Directories[wd] = directory;
+
+	DIR* dir = opendir(directory.c_str());
+	if (!dir) {
+		return;
+	}
+	while (dirent* entry = readdir(dir)) {
+		if (!std::strcmp(entry->d_name, ".") || !std::strcmp(entry->d_name, "..")) {
+			continue;
+		}
+		std::string path = directory + "/" + entry->d_name;
+		struct stat info;
+		if (!stat(path.c_str(), &info) && S_ISDIR(info.st_mode)) {
+			Watch(path);
+		}
+	}
+	closedir(dir);
+}
+
+void FileWatcher::Run() {
+
+	using clock = std::chrono::steady_clock;
+
+	const auto settle = std::chrono::milliseconds(m_SettleMilliseconds);
+
+	std::unordered_map<std::string, clock::time_point> changed; // Path to its last write
+	alignas(inotify_event) char						   buffer[4096];
+	pollfd											   fds[2] = { { m_Inotify, POLLIN, 0 }, { m_Wake, POLLIN, 0 } };
+
+	for (;;) {
+		// Sleeps until something happens, or until a pending file may have settled.
+		int timeout = changed.empty() ? -1 : (int)m_SettleMilliseconds;
+		if (poll(fds, 2, timeout) < 0 && errno != EINTR) {
+			return;
+		}
+		if (fds[1].revents & POLLIN) {
+			return;
+		}
+
+		if (fds[0].revents & POLLIN) {
+			ssize_t length = read(m_Inotify, buffer, sizeof(buffer));
+			for (char* p = buffer; length > 0 && p < buffer + length;) {
+				const inotify_event* event = (const inotify_event*)p;
+				p += sizeof(inotify_event) + event->len;
+
+				auto directory = m_Directories.find(event->wd);
+				if (event->mask & IN_IGNORED) {
+					if (directory != m_Directories.end()) {
+						m_Directories.erase(directory);
+					}
+					continue;
+				}
+				if (directory == m_Directories.end() || !event->len) {
+					continue;
+				}
+
+				std::string path = directory->second + "/" + event->name;
+				if (event->mask & IN_ISDIR) {
+					Watch(path);
+				} else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+					changed[path] = clock::now();
+				}
+			}
+		}
+
+		auto now = clock::now();
+		for (auto it = changed.begin(); it != changed.end();) {
+			if (now - it->second >= settle) {
+				m_Handler(it->first);
+				it = changed.erase(it);
+			} else {
+				++it;
+			}
+		}
+	}
+}
@@ -0,0 +1,49 @@
+
+#ifndef _FILE_WATCHER_HPP
+#define _FILE_WATCHER_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+/*
+ * File Watcher class
+ * Watches a directory tree with inotify on a background thread. A file
+ * is reported once writes to it have settled for a while, so editors
+ * saving in several writes, or through a temporary file and a rename,
+ * report it once. Directories created later are watched as well.
+ * The handler runs on the watcher thread, with the file's path under
+ * the root as given to Start.
+ */
+
+class FileWatcher {
+public:
+	using Handler = std::function<void(const std::string& path)>;
+
+private:
+	int			m_Inotify = -1;
+	int			m_Wake	  = -1; // eventfd, written to stop the thread
+	std::thread m_Thread;
+	Handler		m_Handler;
+	uint32_t	m_SettleMilliseconds = 0;
+
+	// Watch descriptor to directory path, only touched by the thread once started.
+	std::unordered_map<int, std::string> m_Directories;
+
+	void Watch(const std::string& directory);
+	void Run();
+
+public:
+	bool Start(const std::string& root, const Handler& handler, uint32_t settleMilliseconds = 100);
+	void Stop();
+	bool IsRunning() const { return m_Thread.joinable(); }
+
+	FileWatcher() {}
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+	~FileWatcher() { Stop(); }
+};
+
+#endif /* _FILE_WATCHER_HPP */